@@ -6,6 +6,7 @@
 #include "dynarray.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*--------------------------------------------------------------------*/
 
@@ -30,6 +31,9 @@ struct DynArray
 
    /* The array that underlies the DynArray. */
    const void **ppvArray;
+
+   /* The source of the DynArray's memory, or NULL for the C heap. */
+   const struct DynArrayAllocator *psAllocator;
 };
 
 /*--------------------------------------------------------------------*/
@@ -51,6 +55,35 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Return a block of uSize bytes from psAllocator, or from the C heap
+   if psAllocator is NULL.  Return NULL if insufficient memory is
+   available. */
+
+static void *DynArray_alloc(const struct DynArrayAllocator *psAllocator,
+                            size_t uSize)
+{
+   if (psAllocator == NULL)
+      return malloc(uSize);
+   return (*psAllocator->pfAlloc)(psAllocator->pvPool, uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give back pvBlock, of uSize bytes, to psAllocator, or to the C heap
+   if psAllocator is NULL. */
+
+static void DynArray_release(
+   const struct DynArrayAllocator *psAllocator,
+   void *pvBlock, size_t uSize)
+{
+   if (psAllocator == NULL)
+      free(pvBlock);
+   else
+      (*psAllocator->pfFree)(psAllocator->pvPool, pvBlock, uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Increase the physical length of oDynArray.  Return 1 (TRUE) if
    successful and 0 (FALSE) if insufficient memory is available. */
 
@@ -65,10 +98,27 @@ static int DynArray_grow(DynArray_T oDynArray)
 
    uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
 
-   ppvNewArray = (const void**)
-      realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
-   if (ppvNewArray == NULL)
-      return 0;
+   if (oDynArray->psAllocator == NULL)
+   {
+      ppvNewArray = (const void**)
+         realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
+      if (ppvNewArray == NULL)
+         return 0;
+   }
+   else
+   {
+      /* An allocator has no realloc, so move the elements. */
+      ppvNewArray = (const void**)
+         DynArray_alloc(oDynArray->psAllocator,
+                        sizeof(void*) * uNewLength);
+      if (ppvNewArray == NULL)
+         return 0;
+      memcpy((void*)ppvNewArray, (void*)oDynArray->ppvArray,
+             sizeof(void*) * oDynArray->uLength);
+      DynArray_release(oDynArray->psAllocator,
+                       (void*)oDynArray->ppvArray,
+                       sizeof(void*) * oDynArray->uPhysLength);
+   }
 
    oDynArray->uPhysLength = uNewLength;
    oDynArray->ppvArray = ppvNewArray;
@@ -78,26 +128,40 @@ static int DynArray_grow(DynArray_T oDynArray)
 /*--------------------------------------------------------------------*/
 
 DynArray_T DynArray_new(size_t uLength)
+{
+   return DynArray_newWith(uLength, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+DynArray_T DynArray_newWith(size_t uLength,
+                            const struct DynArrayAllocator *psAllocator)
 {
    DynArray_T oDynArray;
 
-   oDynArray = (struct DynArray*)malloc(sizeof(struct DynArray));
+   oDynArray = (struct DynArray*)
+      DynArray_alloc(psAllocator, sizeof(struct DynArray));
    if (oDynArray == NULL)
       return NULL;
 
+   oDynArray->psAllocator = psAllocator;
    oDynArray->uLength = uLength;
    if (uLength > MIN_PHYS_LENGTH)
       oDynArray->uPhysLength = uLength;
    else
       oDynArray->uPhysLength = MIN_PHYS_LENGTH;
 
-   oDynArray->ppvArray =
-      (const void**)calloc(oDynArray->uPhysLength, sizeof(void*));
+   oDynArray->ppvArray = (const void**)
+      DynArray_alloc(psAllocator,
+                     sizeof(void*) * oDynArray->uPhysLength);
    if (oDynArray->ppvArray == NULL)
    {
-      free(oDynArray);
+      DynArray_release(psAllocator, oDynArray,
+                       sizeof(struct DynArray));
       return NULL;
    }
+   memset((void*)oDynArray->ppvArray, 0,
+          sizeof(void*) * oDynArray->uPhysLength);
 
    return oDynArray;
 }
@@ -109,8 +173,11 @@ void DynArray_free(DynArray_T oDynArray)
    assert(oDynArray != NULL);
    assert(DynArray_isValid(oDynArray));
 
-   free(oDynArray->ppvArray);
-   free(oDynArray);
+   DynArray_release(oDynArray->psAllocator,
+                    (void*)oDynArray->ppvArray,
+                    sizeof(void*) * oDynArray->uPhysLength);
+   DynArray_release(oDynArray->psAllocator, oDynArray,
+                    sizeof(struct DynArray));
 }
 
 /*--------------------------------------------------------------------*/
@@ -177,8 +244,6 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement)
 int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
                    const void *pvElement)
 {
-   size_t u;
-
    assert(oDynArray != NULL);
    assert(uIndex <= oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
@@ -187,8 +252,10 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
       if (! DynArray_grow(oDynArray))
          return 0;
 
-   for (u = oDynArray->uLength; u > uIndex; u--)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u-1];
+   /* Shift the later elements up as one block. */
+   memmove(&oDynArray->ppvArray[uIndex + 1],
+           &oDynArray->ppvArray[uIndex],
+           (oDynArray->uLength - uIndex) * sizeof(const void *));
 
    oDynArray->ppvArray[uIndex] = pvElement;
    oDynArray->uLength++;
@@ -203,7 +270,6 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
 void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 {
    const void *pvOldElement;
-   size_t u;
 
    assert(oDynArray != NULL);
    assert(uIndex < oDynArray->uLength);
@@ -213,8 +279,10 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
    oDynArray->uLength--;
 
-   for (u = uIndex; u < oDynArray->uLength; u++)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u+1];
+   /* Shift the later elements down as one block. */
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + 1],
+           (oDynArray->uLength - uIndex) * sizeof(const void *));
 
    assert(DynArray_isValid(oDynArray));
 
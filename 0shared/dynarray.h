@@ -13,6 +13,19 @@
 
 typedef struct DynArray *DynArray_T;
 
+/* A DynArrayAllocator is a source of memory for DynArray_T objects
+   other than the C heap.  (*pfAlloc)(pvPool, uSize) must return a
+   block of at least uSize bytes, or NULL if insufficient memory is
+   available.  (*pfFree)(pvPool, pvBlock, uSize) must give back a
+   block that (*pfAlloc) returned for that same uSize. */
+
+struct DynArrayAllocator
+{
+   void *(*pfAlloc)(void *pvPool, size_t uSize);
+   void (*pfFree)(void *pvPool, void *pvBlock, size_t uSize);
+   void *pvPool;
+};
+
 /*--------------------------------------------------------------------*/
 
 /* Return a new DynArray_T object whose length is uLength, or
@@ -22,6 +35,16 @@ DynArray_T DynArray_new(size_t uLength);
 
 /*--------------------------------------------------------------------*/
 
+/* Return a new DynArray_T object whose length is uLength, or
+   NULL if insufficient memory is available.  The object and its
+   underlying array are obtained from, and eventually given back to,
+   *psAllocator, which must outlive the object. */
+
+DynArray_T DynArray_newWith(size_t uLength,
+                            const struct DynArrayAllocator *psAllocator);
+
+/*--------------------------------------------------------------------*/
+
 /* Free oDynArray. */
 
 void DynArray_free(DynArray_T oDynArray);
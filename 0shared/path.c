@@ -7,158 +7,179 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "dynarray.h"
 #include "path.h"
 
-/* An absolute path */
-struct path {
-   /* The string representation of the path,
-      which uses '/' as the component delimiter */
-   const char *pcPath;
-   /* The string length of pcPath */
-   size_t ulLength;
-   /* The ordered collection of component strings in the path */
-   DynArray_T oDComponents;
-};
-
-/*
-  Frees pcStr. This wrapper is used to match the requirements of the
-  callback function pointer passed to DynArray_map. pvExtra is unused.
-*/
-static void Path_freeString(char *pcStr, void *pvExtra) {
-   /* pcStr may be NULL, as this is a no-op to free.
-      pvExtra may be NULL, as it is unused. */
-   free(pcStr);
-}
-
 /*
-  Sets *poDComponents to be an ordered collection of component strings
-  in pcPath, or NULL if an error occurs.
+  Validates the ulLength characters of pcPath as a pathname and counts
+  its components into *pulDepth. If psComponents is not NULL, also
+  records the offset and length of each component in it, in order.
   Returns one of the following statuses:
   * SUCCESS if no error occurrs
   * BAD_PATH if pcPath is the empty string,
              or begins or ends with a '/',
-             or contains consecutive '/' delimiters
-  * MEMORY_ERROR if memory could not be allocated to complete request
+             or contains consecutive '/' delimiters,
+             or contains a '\0' within its ulLength characters
 */
-static int Path_split(const char *pcPath, DynArray_T *poDComponents) {
-   const char *pcStart = pcPath;
-   const char *pcEnd = pcPath;
-   char *pcCopy;
-   DynArray_T oDSubstrings;
+static int Path_split(const char *pcPath, size_t ulLength,
+                      struct pathComponent *psComponents,
+                      size_t *pulDepth) {
+   size_t ulStart = 0;
+   size_t ulEnd;
+   size_t ulDepth = 0;
 
    assert(pcPath != NULL);
-   assert(poDComponents != NULL);
+   assert(pulDepth != NULL);
 
    /* path cannot be empty string */
-   if(*pcPath == '\0') {
-      *poDComponents = NULL;
+   if(ulLength == 0)
       return BAD_PATH;
-   }
-
-   oDSubstrings = DynArray_new(0);
-   if(oDSubstrings == NULL) {
-      *poDComponents = NULL;
-      return MEMORY_ERROR;
-   }
 
    /* validate and split pcPath */
-   while(*pcEnd != '\0') {
-      pcEnd = pcStart;
-      /* component can't start with delimiter */
-      if(*pcEnd == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
-      }
-
-      /* advance pcEnd to end of next token */
-      while(*pcEnd != '/' && *pcEnd != '\0')
-         pcEnd++;
-
-      /* final component can't end with slash */
-      if(*pcEnd == '\0' && *(pcEnd-1) == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
+   while(ulStart <= ulLength) {
+      /* component can't start with delimiter (or be empty at the end,
+         which means the path ended with a slash) */
+      if(ulStart == ulLength || pcPath[ulStart] == '/')
          return BAD_PATH;
-      }
 
-      pcCopy = calloc((size_t)(pcEnd-pcStart+1), sizeof(char));
-      if(pcCopy == NULL) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
+      /* advance ulEnd to end of next token */
+      ulEnd = ulStart;
+      while(ulEnd < ulLength && pcPath[ulEnd] != '/') {
+         if(pcPath[ulEnd] == '\0')
+            return BAD_PATH;
+         ulEnd++;
       }
 
-      if( DynArray_add(oDSubstrings, pcCopy) == 0) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
+      if(psComponents != NULL) {
+         psComponents[ulDepth].ulOffset = ulStart;
+         psComponents[ulDepth].ulLength = ulEnd - ulStart;
       }
+      ulDepth++;
 
-      while(pcStart != pcEnd) {
-         *pcCopy = *pcStart;
-         pcCopy++;
-         pcStart++;
-      }
-
-      pcStart++;
+      ulStart = ulEnd + 1;
    }
 
-   *poDComponents = oDSubstrings;
+   *pulDepth = ulDepth;
    return SUCCESS;
 }
 
+/*
+  Allocates a path with room for ulDepth components and a pathname of
+  ulLength characters, and points its members into that allocation.
+  Returns the new path with ulLength and ulDepth set, or NULL if
+  memory could not be allocated.
+*/
+static struct path *Path_alloc(size_t ulLength, size_t ulDepth) {
+   struct path *psNew;
 
-int Path_new(const char *pcPath, Path_T *poPResult) {
+   psNew = malloc(sizeof(struct path)
+                  + ulDepth * sizeof(struct pathComponent)
+                  + 2 * (ulLength + 1));
+   if(psNew == NULL)
+      return NULL;
+
+   psNew->ulLength = ulLength;
+   psNew->ulDepth = ulDepth;
+   psNew->psComponents = (struct pathComponent *) (psNew + 1);
+   psNew->pcPath = (const char *) (psNew->psComponents + ulDepth);
+   psNew->pcComponents = psNew->pcPath + ulLength + 1;
+   return psNew;
+}
+
+/*
+  Fills the pathname and component strings of psPath from the first
+  psPath->ulLength characters of pcPath.
+*/
+static void Path_fillStrings(struct path *psPath, const char *pcPath) {
+   char *pcComponents = (char *) psPath->pcComponents;
+   size_t ulIndex;
+
+   assert(psPath != NULL);
+   assert(pcPath != NULL);
+
+   memcpy((char *) psPath->pcPath, pcPath, psPath->ulLength);
+   ((char *) psPath->pcPath)[psPath->ulLength] = '\0';
+
+   memcpy(pcComponents, pcPath, psPath->ulLength + 1);
+   for(ulIndex = 0; ulIndex < psPath->ulDepth; ulIndex++) {
+      const struct pathComponent *psComp =
+         &psPath->psComponents[ulIndex];
+      pcComponents[psComp->ulOffset + psComp->ulLength] = '\0';
+   }
+}
+
+int Path_newFromBuffer(const char *pcBuf, size_t ulLength,
+                       Path_T *poPResult) {
    struct path *psNew;
+   size_t ulDepth;
    int iSplitResult;
 
-   assert(pcPath != NULL);
+   assert(pcBuf != NULL);
    assert(poPResult != NULL);
 
-   psNew = calloc(1, sizeof(struct path));
+   /* validate and count the components */
+   iSplitResult = Path_split(pcBuf, ulLength, NULL, &ulDepth);
+   if(iSplitResult != SUCCESS) {
+      *poPResult = NULL;
+      return iSplitResult;
+   }
+
+   psNew = Path_alloc(ulLength, ulDepth);
    if(psNew == NULL) {
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
 
-   /* instantiate and fill list of components */
-   iSplitResult = Path_split(pcPath, &psNew->oDComponents);
+   /* record the components, which cannot fail a second time */
+   (void) Path_split(pcBuf, ulLength,
+                     (struct pathComponent *) psNew->psComponents,
+                     &ulDepth);
+   Path_fillStrings(psNew, pcBuf);
+
+   *poPResult = psNew;
+   return SUCCESS;
+}
+
+int Path_new(const char *pcPath, Path_T *poPResult) {
+   assert(pcPath != NULL);
+   assert(poPResult != NULL);
+
+   return Path_newFromBuffer(pcPath, strlen(pcPath), poPResult);
+}
+
+int Path_initBorrowed(struct pathView *psView, const char *pcBuf,
+                      size_t ulLength, Path_T *poPResult) {
+   size_t ulDepth;
+   int iSplitResult;
+
+   assert(psView != NULL);
+   assert(pcBuf != NULL);
+   assert(poPResult != NULL);
+
+   /* validate and count before writing anything into the view */
+   iSplitResult = Path_split(pcBuf, ulLength, NULL, &ulDepth);
    if(iSplitResult != SUCCESS) {
-      Path_free(psNew);
       *poPResult = NULL;
       return iSplitResult;
    }
-
-   psNew->ulLength = strlen(pcPath);
-   psNew->pcPath = malloc(psNew->ulLength+1);
-   if(psNew->pcPath == NULL) {
-      Path_free(psNew);
+   if(ulDepth > PATH_VIEW_MAX_DEPTH) {
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
-   strcpy((char *)psNew->pcPath, pcPath);
 
-   *poPResult = psNew;
+   (void) Path_split(pcBuf, ulLength, psView->asComponents, &ulDepth);
+   psView->sPath.pcPath = pcBuf;
+   psView->sPath.ulLength = ulLength;
+   psView->sPath.ulDepth = ulDepth;
+   psView->sPath.psComponents = psView->asComponents;
+   psView->sPath.pcComponents = NULL;
+
+   *poPResult = &psView->sPath;
    return SUCCESS;
 }
 
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
    struct path *psNew;
-   size_t ulIndex, ulLength, ulSum;
-   const char *pcComponent;
-   char *pcCopy;
-   char *pcBuild;
-   char *pcInsert;
+   const struct pathComponent *psLast;
 
    assert(oPPath != NULL);
    assert(poPResult != NULL);
@@ -175,60 +196,18 @@ int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
       return NO_SUCH_PATH;
    }
 
-   psNew = calloc(1, sizeof(struct path));
+   /* the prefix's pathname ends where its last component does */
+   psLast = &oPPath->psComponents[ulDepth - 1];
+   psNew = Path_alloc(psLast->ulOffset + psLast->ulLength, ulDepth);
    if(psNew == NULL) {
       *poPResult = NULL;
       return MEMORY_ERROR;
    }
 
-   psNew->oDComponents = DynArray_new(ulDepth);
-   if(psNew->oDComponents == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   pcBuild = calloc(Path_getStrLength(oPPath)+1, sizeof(char));
-   if(pcBuild == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   pcInsert = pcBuild;
-   ulSum = 0;
-
-   for(ulIndex = 0; ulIndex < ulDepth; ulIndex++) {
-      /* deep copy each component to new DynArray */
-      pcComponent = Path_getComponent(oPPath, ulIndex);
-      ulLength = strlen(pcComponent);
-      pcCopy = calloc(ulLength + 1, sizeof(char));
-      if(pcCopy == NULL) {
-         free(pcBuild);
-         Path_free(psNew);
-         *poPResult = NULL;
-         return MEMORY_ERROR;
-      }
-      strcpy(pcCopy, pcComponent);
-      (void) DynArray_set(psNew->oDComponents, ulIndex, pcCopy);
-      /* construct prefix's pathname string */
-      strcpy(pcInsert, pcComponent);
-      pcInsert[ulLength] = '/';
-      ulSum += ulLength + 1;
-      pcInsert += ulLength + 1;
-   }
-   pcBuild[ulSum-1] = '\0';
-
-   /* shrink allocation to fit prefix's pathname string if needed */
-   pcInsert = realloc(pcBuild, ulSum);
-   if(pcInsert == NULL) {
-      free(pcBuild);
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-   psNew->ulLength = ulSum-1;
-   psNew->pcPath = pcInsert;
+   memcpy((struct pathComponent *) psNew->psComponents,
+          oPPath->psComponents,
+          ulDepth * sizeof(struct pathComponent));
+   Path_fillStrings(psNew, oPPath->pcPath);
 
    *poPResult = psNew;
    return SUCCESS;
@@ -242,15 +221,11 @@ int Path_dup(Path_T oPPath, Path_T *poPResult) {
 }
 
 void Path_free(Path_T oPPath) {
-   if(oPPath != NULL) {
-      free((char *)oPPath->pcPath);
+   /* a borrowed path owns no memory */
+   if(oPPath != NULL && oPPath->pcComponents == NULL)
+      return;
 
-      if(oPPath->oDComponents != NULL) {
-         DynArray_map(oPPath->oDComponents,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oPPath->oDComponents);
-      }
-   }
+   /* the whole path, including its strings, is one allocation */
    free((struct path*) oPPath);
 }
 
@@ -266,28 +241,60 @@ size_t Path_getStrLength(Path_T oPPath) {
    return oPPath->ulLength;
 }
 
+/*
+  Compares the ulLength1 characters at pc1 with the ulLength2
+  characters at pc2 lexicographically, as strcmp would compare them
+  if each were '\0'-terminated.
+  Returns <0, 0, or >0 if pc1 is "less than", "equal to", or
+  "greater than" pc2, respectively.
+*/
+static int Path_compareBytes(const char *pc1, size_t ulLength1,
+                             const char *pc2, size_t ulLength2) {
+   int iCompare;
+
+   assert(pc1 != NULL);
+   assert(pc2 != NULL);
+
+   if(ulLength1 < ulLength2)
+      iCompare = memcmp(pc1, pc2, ulLength1);
+   else
+      iCompare = memcmp(pc1, pc2, ulLength2);
+   if(iCompare != 0)
+      return iCompare;
+
+   if(ulLength1 < ulLength2)
+      return -1;
+   if(ulLength1 > ulLength2)
+      return 1;
+   return 0;
+}
+
 int Path_comparePath(Path_T oPPath1, Path_T oPPath2) {
    assert(oPPath1 != NULL);
    assert(oPPath2 != NULL);
 
-   return strcmp(oPPath1->pcPath, oPPath2->pcPath);
+   return Path_compareBytes(oPPath1->pcPath, oPPath1->ulLength,
+                            oPPath2->pcPath, oPPath2->ulLength);
 }
 
 int Path_compareString(Path_T oPPath, const char *pcStr) {
    assert(oPPath != NULL);
    assert(pcStr != NULL);
 
-   return strcmp(oPPath->pcPath, pcStr);
+   return Path_compareBytes(oPPath->pcPath, oPPath->ulLength,
+                            pcStr, strlen(pcStr));
 }
 
 size_t Path_getDepth(Path_T oPPath) {
    assert(oPPath != NULL);
 
-   return DynArray_getLength(oPPath->oDComponents);
+   return oPPath->ulDepth;
 }
 
 size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
    size_t ulDepth1, ulDepth2, ulMin, i;
+   const struct pathComponent *psComp1;
+   const struct pathComponent *psComp2;
 
    assert(oPPath1 != NULL);
    assert(oPPath2 != NULL);
@@ -299,8 +306,12 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
    else
       ulMin = ulDepth2;
    for(i = 0; i < ulMin; i++) {
-      if(strcmp(Path_getComponent(oPPath1, i),
-                Path_getComponent(oPPath2, i)))
+      psComp1 = &oPPath1->psComponents[i];
+      psComp2 = &oPPath2->psComponents[i];
+      if(psComp1->ulLength != psComp2->ulLength
+         || memcmp(oPPath1->pcPath + psComp1->ulOffset,
+                   oPPath2->pcPath + psComp2->ulOffset,
+                   psComp1->ulLength))
          return i;
    }
    return ulMin;
@@ -309,8 +320,20 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
 const char *Path_getComponent(Path_T oPPath, size_t ulLevel) {
    assert(oPPath != NULL);
 
+   if(ulLevel >= Path_getDepth(oPPath) || oPPath->pcComponents == NULL)
+      return NULL;
+
+   return oPPath->pcComponents + oPPath->psComponents[ulLevel].ulOffset;
+}
+
+const char *Path_getComponentSpan(Path_T oPPath, size_t ulLevel,
+                                  size_t *pulLength) {
+   assert(oPPath != NULL);
+   assert(pulLength != NULL);
+
    if(ulLevel >= Path_getDepth(oPPath))
       return NULL;
 
-   return DynArray_get(oPPath->oDComponents, ulLevel);
+   *pulLength = oPPath->psComponents[ulLevel].ulLength;
+   return oPPath->pcPath + oPPath->psComponents[ulLevel].ulOffset;
 }
@@ -12,6 +12,58 @@
 /* An object representing an absolute path in a tree */
 typedef const struct path * Path_T;
 
+/* The maximum depth of a path that a borrowed view can represent */
+enum { PATH_VIEW_MAX_DEPTH = 64 };
+
+/*
+  The types below are laid out here only so that a struct pathView can
+  be declared with room for a path: their members are private to the
+  path module, and clients use a path only through Path_T and the
+  functions below.
+*/
+
+/* The position of one component within a path's pathname */
+struct pathComponent {
+   /* The index of the component's first character in the pathname */
+   size_t ulOffset;
+   /* The number of characters in the component */
+   size_t ulLength;
+};
+
+/*
+  An absolute path. Every owned path lives in a single allocation laid
+  out as the struct itself, then ulDepth struct pathComponents, then
+  the pathname, then a second copy of the pathname whose '/' delimiters
+  are replaced by '\0' so that each component is a string in place.
+  A borrowed path instead lives in a caller's struct pathView, points
+  pcPath at the caller's buffer and has no component strings.
+*/
+struct path {
+   /* The string representation of the path,
+      which uses '/' as the component delimiter */
+   const char *pcPath;
+   /* The string length of pcPath */
+   size_t ulLength;
+   /* The number of components in the path */
+   size_t ulDepth;
+   /* The ordered offsets and lengths of the components in pcPath */
+   const struct pathComponent *psComponents;
+   /* The components, each '\0'-terminated at the same offsets,
+      or NULL if the path is borrowed */
+   const char *pcComponents;
+};
+
+/*
+  Caller-provided storage for a borrowed path view (see
+  Path_initBorrowed): the path and its components. Its members are
+  private to the path module: declare one, usually as a local variable,
+  and only ever pass its address to Path_initBorrowed.
+*/
+struct pathView {
+   struct path sPath;
+   struct pathComponent asComponents[PATH_VIEW_MAX_DEPTH];
+};
+
 /*
   Creates a new path object representing the absolute path in pcPath.
   Returns an int SUCCESS status and sets *poPResult to be the new path
@@ -23,6 +75,31 @@ typedef const struct path * Path_T;
 */
 int Path_new(const char *pcPath, Path_T *poPResult);
 
+/*
+  Like Path_new, but the pathname is the first ulLength characters of
+  pcBuf, which need not be '\0'-terminated. Additionally returns
+  BAD_PATH if those characters include a '\0'.
+*/
+int Path_newFromBuffer(const char *pcBuf, size_t ulLength,
+                       Path_T *poPResult);
+
+/*
+  Validates and tokenizes the first ulLength characters of pcBuf
+  (which need not be '\0'-terminated) in place, without copying them
+  and without allocating memory. The resulting path borrows both pcBuf
+  and *psView, so it is only valid while both are; it never needs to
+  be freed, and passing it to Path_free does nothing.
+  Returns an int SUCCESS status and sets *poPResult to be the borrowed
+  path if successful. Otherwise, sets *poPResult to NULL and returns
+  status:
+  * BAD_PATH if the characters are not a well-formatted path (as for
+             Path_new) or include a '\0'
+  * MEMORY_ERROR if the path is deeper than PATH_VIEW_MAX_DEPTH, so
+                 *psView has no room for its components
+*/
+int Path_initBorrowed(struct pathView *psView, const char *pcBuf,
+                      size_t ulLength, Path_T *poPResult);
+
 /*
   Creates a "deep copy" of oPPath, duplicating all its contents.
   Returns an int SUCCESS status and sets *poPResult to be the new path
@@ -46,7 +123,11 @@ int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult);
 /* Destroys and frees all memory allocated for oPPath. */
 void Path_free(Path_T oPPath);
 
-/* Returns the string representation of the absolute path oPPath. */
+/*
+  Returns the string representation of the absolute path oPPath.
+  For a borrowed path this is the caller's buffer, which is not
+  necessarily '\0'-terminated: use Path_getStrLength to bound it.
+*/
 const char *Path_getPathname(Path_T oPPath);
 
 /*
@@ -89,8 +170,20 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2);
   Returns the string version of the component of oPPath at level
   ulLevel. This count is from 0, so with level 0 the root of oPPath
   would be returned.
-  Returns NULL if ulLevel is greater than oPPath's maxium level.
+  Returns NULL if ulLevel is greater than oPPath's maxium level,
+  or if oPPath is borrowed (use Path_getComponentSpan instead).
 */
 const char *Path_getComponent(Path_T oPPath, size_t ulLevel);
 
+/*
+  Returns a pointer to the first character of the component of oPPath
+  at level ulLevel, counting from 0 as for Path_getComponent, and
+  stores the component's length in *pulLength. The component is not
+  '\0'-terminated, but this works for borrowed paths too.
+  Returns NULL and leaves *pulLength unchanged if ulLevel is greater
+  than oPPath's maximum level.
+*/
+const char *Path_getComponentSpan(Path_T oPPath, size_t ulLevel,
+                                  size_t *pulLength);
+
 #endif
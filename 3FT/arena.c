@@ -0,0 +1,343 @@
+/*--------------------------------------------------------------------*/
+/* arena.c                                                            */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Every block size is rounded up to a multiple of this alignment */
+enum { ARENA_ALIGNMENT = 16 };
+
+/* Blocks of up to this many bytes are carved from slabs; larger ones
+   come straight from the C heap */
+enum { ARENA_MAX_SMALL = 256 };
+
+/* The number of size classes of small blocks */
+enum { ARENA_NUM_CLASSES = ARENA_MAX_SMALL / ARENA_ALIGNMENT };
+
+/* The number of bytes in a slab, including its header */
+enum { ARENA_SLAB_SIZE = 64 * 1024 };
+
+/* A released small block, linked into its size class's free list */
+struct FreeBlock {
+    /* the next released block of the same size class */
+    struct FreeBlock *psNext;
+};
+
+/*
+   The header of a slab or of a large block. Slabs are kept in a singly
+   linked list; large blocks, which may be released individually, in a
+   circular doubly linked list through a header in the arena itself, so
+   that unlinking one never needs to know its arena. The union pads the
+   header to ARENA_ALIGNMENT.
+*/
+union ChunkHeader {
+    struct {
+        /* the previous chunk in the list */
+        union ChunkHeader *puPrev;
+        /* the next chunk in the list */
+        union ChunkHeader *puNext;
+    } sLinks;
+    /* padding that keeps the memory after the header aligned */
+    char acAlign[ARENA_ALIGNMENT];
+};
+
+/* An arena of slabs, free lists and large blocks */
+struct Arena {
+    /* the released blocks of each size class, ready for reuse */
+    struct FreeBlock *apsFree[ARENA_NUM_CLASSES];
+    /* the list of slabs, most recent first */
+    union ChunkHeader *puSlabs;
+    /* the next unused byte in the most recent slab */
+    char *pcBump;
+    /* one past the last byte of the most recent slab */
+    char *pcBumpEnd;
+    /* the head of the ring of live large blocks */
+    union ChunkHeader uLarge;
+    /* the allocator handed out by Arena_getDynArrayAllocator */
+    struct DynArrayAllocator sDynArrayAllocator;
+    /* whether the arena may be used by several threads at once */
+    int iShared;
+    /* the mutex serializing those threads, if iShared */
+    pthread_mutex_t sMutex;
+    /* the arenas this one has adopted, linked through psNextAdopted */
+    struct Arena *psAdopted;
+    struct Arena *psNextAdopted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/** HELPER FUNCTIONS **/
+
+/*
+   Returns the size class of a small block of ulSize bytes; class c
+   holds blocks of (c + 1) * ARENA_ALIGNMENT bytes.
+*/
+static size_t Arena_getClass(size_t ulSize) {
+    assert(ulSize <= ARENA_MAX_SMALL);
+
+    if (ulSize == 0)
+        return 0;
+    return (ulSize - 1) / ARENA_ALIGNMENT;
+}
+
+/*
+   Carves a block of size class ulClass out of oArena's current slab,
+   starting a new slab if the current one is full.
+
+   Returns the block, or NULL if memory could not be allocated.
+*/
+static void *Arena_carve(Arena_T oArena, size_t ulClass) {
+    size_t ulBlockSize = (ulClass + 1) * ARENA_ALIGNMENT;
+    union ChunkHeader *puSlab;
+    void *pvBlock;
+
+    assert(oArena != NULL);
+
+    /* the tail of a full slab is abandoned until Arena_free */
+    if ((size_t) (oArena->pcBumpEnd - oArena->pcBump) < ulBlockSize) {
+        puSlab = malloc(ARENA_SLAB_SIZE);
+        if (puSlab == NULL)
+            return NULL;
+        puSlab->sLinks.puPrev = NULL;
+        puSlab->sLinks.puNext = oArena->puSlabs;
+        oArena->puSlabs = puSlab;
+        oArena->pcBump = (char *) (puSlab + 1);
+        oArena->pcBumpEnd = (char *) puSlab + ARENA_SLAB_SIZE;
+    }
+
+    pvBlock = oArena->pcBump;
+    oArena->pcBump += ulBlockSize;
+    return pvBlock;
+}
+
+/*
+   Adapts Arena_alloc to the DynArrayAllocator interface, whose pool
+   pvPool is an untyped pointer to the arena.
+*/
+static void *Arena_dynArrayAlloc(void *pvPool, size_t ulSize) {
+    return Arena_alloc((Arena_T) pvPool, ulSize);
+}
+
+/*
+   Adapts Arena_release to the DynArrayAllocator interface, whose pool
+   pvPool is an untyped pointer to the arena.
+*/
+static void Arena_dynArrayFree(void *pvPool, void *pvBlock,
+                               size_t ulSize) {
+    Arena_release((Arena_T) pvPool, pvBlock, ulSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+   Does the work of Arena_alloc, for an arena held by the calling
+   thread alone.
+*/
+static void *Arena_allocLocked(Arena_T oArena, size_t ulSize) {
+    union ChunkHeader *puLarge;
+    struct FreeBlock *psBlock;
+    size_t ulClass;
+
+    assert(oArena != NULL);
+
+    /* large blocks get a chunk of their own */
+    if (ulSize > ARENA_MAX_SMALL) {
+        puLarge = malloc(sizeof(union ChunkHeader) + ulSize);
+        if (puLarge == NULL)
+            return NULL;
+        puLarge->sLinks.puPrev = &oArena->uLarge;
+        puLarge->sLinks.puNext = oArena->uLarge.sLinks.puNext;
+        puLarge->sLinks.puNext->sLinks.puPrev = puLarge;
+        oArena->uLarge.sLinks.puNext = puLarge;
+        return puLarge + 1;
+    }
+
+    /* reuse a released block of the same class if there is one */
+    ulClass = Arena_getClass(ulSize);
+    psBlock = oArena->apsFree[ulClass];
+    if (psBlock != NULL) {
+        oArena->apsFree[ulClass] = psBlock->psNext;
+        return psBlock;
+    }
+
+    return Arena_carve(oArena, ulClass);
+}
+
+/*
+   Does the work of Arena_release, for an arena held by the calling
+   thread alone.
+*/
+static void Arena_releaseLocked(Arena_T oArena, void *pvBlock,
+                                size_t ulSize) {
+    union ChunkHeader *puLarge;
+    struct FreeBlock *psBlock;
+    size_t ulClass;
+
+    assert(oArena != NULL);
+    assert(pvBlock != NULL);
+
+    /* unlink a large block and give it back to the C heap */
+    if (ulSize > ARENA_MAX_SMALL) {
+        puLarge = (union ChunkHeader *) pvBlock - 1;
+        puLarge->sLinks.puPrev->sLinks.puNext = puLarge->sLinks.puNext;
+        puLarge->sLinks.puNext->sLinks.puPrev = puLarge->sLinks.puPrev;
+        free(puLarge);
+        return;
+    }
+
+    /* push a small block onto its class's free list */
+    ulClass = Arena_getClass(ulSize);
+    psBlock = pvBlock;
+    psBlock->psNext = oArena->apsFree[ulClass];
+    oArena->apsFree[ulClass] = psBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+Arena_T Arena_new(void) {
+    struct Arena *psNew;
+    size_t ulClass;
+
+    psNew = malloc(sizeof(struct Arena));
+    if (psNew == NULL)
+        return NULL;
+
+    for (ulClass = 0; ulClass < ARENA_NUM_CLASSES; ulClass++)
+        psNew->apsFree[ulClass] = NULL;
+    psNew->puSlabs = NULL;
+    psNew->pcBump = NULL;
+    psNew->pcBumpEnd = NULL;
+    psNew->uLarge.sLinks.puPrev = &psNew->uLarge;
+    psNew->uLarge.sLinks.puNext = &psNew->uLarge;
+    psNew->sDynArrayAllocator.pfAlloc = Arena_dynArrayAlloc;
+    psNew->sDynArrayAllocator.pfFree = Arena_dynArrayFree;
+    psNew->sDynArrayAllocator.pvPool = psNew;
+    psNew->iShared = 0;
+    psNew->psAdopted = NULL;
+    psNew->psNextAdopted = NULL;
+
+    return psNew;
+}
+
+Arena_T Arena_newShared(void) {
+    Arena_T oArena;
+
+    oArena = Arena_new();
+    if (oArena == NULL)
+        return NULL;
+
+    if (pthread_mutex_init(&oArena->sMutex, NULL) != 0) {
+        free(oArena);
+        return NULL;
+    }
+    oArena->iShared = 1;
+
+    return oArena;
+}
+
+void Arena_free(Arena_T oArena) {
+    union ChunkHeader *puChunk;
+    union ChunkHeader *puNext;
+    struct Arena *psAdopted;
+
+    assert(oArena != NULL);
+
+    while (oArena->psAdopted != NULL) {
+        psAdopted = oArena->psAdopted;
+        oArena->psAdopted = psAdopted->psNextAdopted;
+        Arena_free(psAdopted);
+    }
+    for (puChunk = oArena->puSlabs; puChunk != NULL; puChunk = puNext) {
+        puNext = puChunk->sLinks.puNext;
+        free(puChunk);
+    }
+    for (puChunk = oArena->uLarge.sLinks.puNext;
+         puChunk != &oArena->uLarge; puChunk = puNext) {
+        puNext = puChunk->sLinks.puNext;
+        free(puChunk);
+    }
+    if (oArena->iShared)
+        (void) pthread_mutex_destroy(&oArena->sMutex);
+    free(oArena);
+}
+
+void Arena_adopt(Arena_T oArena, Arena_T oOther) {
+    union ChunkHeader *puSlab;
+    union ChunkHeader *puLarge;
+
+    assert(oArena != NULL);
+    assert(oOther != NULL);
+    assert(oArena != oOther);
+    assert(oOther->psNextAdopted == NULL);
+
+    /* splice oOther's slabs onto oArena's, and let oOther start a slab
+       of its own next time */
+    if (oOther->puSlabs != NULL) {
+        for (puSlab = oOther->puSlabs; puSlab->sLinks.puNext != NULL;
+             puSlab = puSlab->sLinks.puNext)
+            ;
+        puSlab->sLinks.puNext = oArena->puSlabs;
+        oArena->puSlabs = oOther->puSlabs;
+        oOther->puSlabs = NULL;
+        oOther->pcBump = NULL;
+        oOther->pcBumpEnd = NULL;
+    }
+
+    /* splice oOther's ring of large blocks into oArena's */
+    if (oOther->uLarge.sLinks.puNext != &oOther->uLarge) {
+        puLarge = oOther->uLarge.sLinks.puNext;
+        puLarge->sLinks.puPrev = &oArena->uLarge;
+        puLarge = oOther->uLarge.sLinks.puPrev;
+        puLarge->sLinks.puNext = oArena->uLarge.sLinks.puNext;
+        puLarge->sLinks.puNext->sLinks.puPrev = puLarge;
+        oArena->uLarge.sLinks.puNext = oOther->uLarge.sLinks.puNext;
+        oOther->uLarge.sLinks.puPrev = &oOther->uLarge;
+        oOther->uLarge.sLinks.puNext = &oOther->uLarge;
+    }
+
+    oOther->psNextAdopted = oArena->psAdopted;
+    oArena->psAdopted = oOther;
+}
+
+void *Arena_alloc(Arena_T oArena, size_t ulSize) {
+    void *pvBlock;
+
+    assert(oArena != NULL);
+
+    if (!oArena->iShared)
+        return Arena_allocLocked(oArena, ulSize);
+
+    (void) pthread_mutex_lock(&oArena->sMutex);
+    pvBlock = Arena_allocLocked(oArena, ulSize);
+    (void) pthread_mutex_unlock(&oArena->sMutex);
+    return pvBlock;
+}
+
+void Arena_release(Arena_T oArena, void *pvBlock, size_t ulSize) {
+    assert(oArena != NULL);
+
+    if (pvBlock == NULL)
+        return;
+
+    if (!oArena->iShared) {
+        Arena_releaseLocked(oArena, pvBlock, ulSize);
+        return;
+    }
+
+    (void) pthread_mutex_lock(&oArena->sMutex);
+    Arena_releaseLocked(oArena, pvBlock, ulSize);
+    (void) pthread_mutex_unlock(&oArena->sMutex);
+}
+
+const struct DynArrayAllocator *Arena_getDynArrayAllocator(
+        Arena_T oArena) {
+    assert(oArena != NULL);
+
+    return &oArena->sDynArrayAllocator;
+}
@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------*/
+/* arena.h                                                            */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <stddef.h>
+#include "dynarray.h"
+
+/*
+   An Arena_T is a slab allocator for the many small, fixed-size
+   blocks a File Tree is made of (nodes with their names, DynArray
+   headers and their underlying arrays). Blocks are carved from large
+   slabs, and each block size class keeps its own free list of released
+   blocks for reuse. Everything allocated from an arena is released at
+   once when the arena itself is freed.
+*/
+typedef struct Arena *Arena_T;
+
+/*
+   Returns a new, empty arena, or NULL if memory could not be
+   allocated.
+*/
+Arena_T Arena_new(void);
+
+/*
+   Like Arena_new, but returns an arena that several threads may
+   allocate from and release to at once. Each call then takes a mutex,
+   so prefer Arena_new for an arena one thread uses at a time.
+*/
+Arena_T Arena_newShared(void);
+
+/*
+   Frees oArena together with every block ever allocated from it,
+   whether or not the block was released. Costs time proportional to
+   the number of slabs, not blocks.
+
+   Precondition:
+   * oArena cannot be NULL
+*/
+void Arena_free(Arena_T oArena);
+
+/*
+   Makes oArena the owner of oOther and of every block allocated from
+   it so far: from then on each such block may be released to either
+   arena, and freeing oArena frees oOther too. oOther may still be
+   allocated from until then, but must not be freed itself. Lets
+   threads fill arenas of their own without contention and hand the
+   results to one. Costs time proportional to the number of oOther's
+   slabs.
+
+   Precondition:
+   * oArena and oOther cannot be NULL, and must differ
+   * oOther has not been adopted before
+   * no other thread may be using either arena
+*/
+void Arena_adopt(Arena_T oArena, Arena_T oOther);
+
+/*
+   Returns a block of at least ulSize bytes from oArena, suitably
+   aligned for any type, or NULL if memory could not be allocated.
+
+   Precondition:
+   * oArena cannot be NULL
+*/
+void *Arena_alloc(Arena_T oArena, size_t ulSize);
+
+/*
+   Gives pvBlock back to oArena for reuse. ulSize must be the size that
+   was passed to Arena_alloc for pvBlock. Does nothing if pvBlock is
+   NULL.
+
+   Precondition:
+   * oArena cannot be NULL
+*/
+void Arena_release(Arena_T oArena, void *pvBlock, size_t ulSize);
+
+/*
+   Returns an allocator that draws DynArray_T objects from oArena, for
+   use with DynArray_newWith. It lives exactly as long as oArena.
+
+   Precondition:
+   * oArena cannot be NULL
+*/
+const struct DynArrayAllocator *Arena_getDynArrayAllocator(
+        Arena_T oArena);
+
+#endif
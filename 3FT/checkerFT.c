@@ -5,9 +5,9 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "checkerFT.h"
 #include "dynarray.h"
-#include "path.h"
 
 /*--------------------------------------------------------------------*/
 
@@ -15,13 +15,14 @@
 
 /*
    Returns a combined DynArray_T of the child FILES and DIRECTORIES
-   nodes under oNNode.
+   nodes under oNNode, in the order of its child index.
 
    ** Returned DynArray_T must be freed by the caller! **
 */
 static DynArray_T CheckerFT_combineChildren(NodeFT_T oNNode) {
     DynArray_T oDChildren;
-    size_t ulIndex1, ulIndex2;
+    size_t ulIndex;
+    size_t ulNumChildren;
     NodeFT_T oNTempNode = NULL;
 
     assert(oNNode != NULL);
@@ -30,22 +31,14 @@ static DynArray_T CheckerFT_combineChildren(NodeFT_T oNNode) {
         return DynArray_new(0);
     }
 
-    oDChildren = DynArray_new(NodeFT_getNumChildren(oNNode, FALSE) +
-                              NodeFT_getNumChildren(oNNode, TRUE));
-
-    /* add Files */
-    for (ulIndex1 = 0;
-         ulIndex1 < NodeFT_getNumChildren(oNNode, TRUE); ulIndex1++) {
-        NodeFT_getChild(oNNode, ulIndex1, TRUE, &oNTempNode);
-        (void) DynArray_set(oDChildren, ulIndex1, oNTempNode);
-    }
+    ulNumChildren = NodeFT_getNumChildren(oNNode, FALSE) +
+                    NodeFT_getNumChildren(oNNode, TRUE);
+    oDChildren = DynArray_new(ulNumChildren);
 
-    /* add Directories */
-    for (ulIndex2 = 0;
-         ulIndex2 < NodeFT_getNumChildren(oNNode, FALSE); ulIndex2++) {
-        NodeFT_getChild(oNNode, ulIndex2, FALSE, &oNTempNode);
-        (void) DynArray_set(oDChildren, ulIndex1 + ulIndex2,
-                            oNTempNode);
+    /* Files and Directories share one index */
+    for (ulIndex = 0; ulIndex < ulNumChildren; ulIndex++) {
+        NodeFT_getChildAt(oNNode, ulIndex, &oNTempNode);
+        (void) DynArray_set(oDChildren, ulIndex, oNTempNode);
     }
 
     return oDChildren;
@@ -63,24 +56,22 @@ CheckerFT_sortedSiblings(NodeFT_T oNPrevChild, NodeFT_T oNChild) {
     assert(oNChild != NULL);
 
     /* not in lexicographic order */
-    if (Path_compareString(NodeFT_getPath(oNChild),
-                           Path_getPathname(NodeFT_getPath(
-                                   oNPrevChild))) < 0) {
+    if (strcmp(NodeFT_getName(oNChild),
+               NodeFT_getName(oNPrevChild)) < 0) {
         fprintf(stderr,
                 "Children are not in lexicographic order: (%s) (%s)\n",
-                Path_getPathname(NodeFT_getPath(oNPrevChild)),
-                Path_getPathname(NodeFT_getPath(oNChild)));
+                NodeFT_getName(oNPrevChild),
+                NodeFT_getName(oNChild));
         return FALSE;
     }
 
     /* duplicate children */
-    if (Path_compareString(NodeFT_getPath(oNChild),
-                           Path_getPathname(NodeFT_getPath(
-                                   oNPrevChild))) == 0) {
+    if (strcmp(NodeFT_getName(oNChild),
+               NodeFT_getName(oNPrevChild)) == 0) {
         fprintf(stderr,
-                "Siblings have non-unique paths: (%s) (%s)\n",
-                Path_getPathname(NodeFT_getPath(oNPrevChild)),
-                Path_getPathname(NodeFT_getPath(oNChild)));
+                "Siblings have non-unique names: (%s) (%s)\n",
+                NodeFT_getName(oNPrevChild),
+                NodeFT_getName(oNChild));
         return FALSE;
     }
 
@@ -98,6 +89,7 @@ CheckerFT_sortedSiblings(NodeFT_T oNPrevChild, NodeFT_T oNChild) {
 */
 static boolean CheckerFT_treeCheck(NodeFT_T oNNode) {
     size_t ulIndex;
+    struct NodeFTTotals sSum, sKept;
     DynArray_T oDChildren;
 
     if (oNNode == NULL) {
@@ -109,6 +101,12 @@ static boolean CheckerFT_treeCheck(NodeFT_T oNNode) {
     if (!CheckerFT_Node_isValid(oNNode))
         return FALSE;
 
+    /* the totals over the subtree start with oNNode itself */
+    sSum.ulFiles = (size_t) NodeFT_isFile(oNNode);
+    sSum.ulDirs = (size_t) !NodeFT_isFile(oNNode);
+    sSum.ulBytes = NodeFT_isFile(oNNode) ? NodeFT_getFileSize(oNNode)
+                                         : 0;
+
     /* Recur on every child of oNNode */
     oDChildren = CheckerFT_combineChildren(oNNode);
     for (ulIndex = 0;
@@ -137,8 +135,7 @@ static boolean CheckerFT_treeCheck(NodeFT_T oNNode) {
                 return FALSE;
             }
 
-            if (NodeFT_isFile(oNPrevChild) == NodeFT_isFile(oNChild) &&
-                !CheckerFT_sortedSiblings(oNPrevChild, oNChild)) {
+            if (!CheckerFT_sortedSiblings(oNPrevChild, oNChild)) {
                 DynArray_free(oDChildren);
                 return FALSE;
             }
@@ -150,9 +147,32 @@ static boolean CheckerFT_treeCheck(NodeFT_T oNNode) {
             DynArray_free(oDChildren);
             return FALSE;
         }
+        NodeFT_getTotals(oNChild, &sKept);
+        sSum.ulFiles += sKept.ulFiles;
+        sSum.ulDirs += sKept.ulDirs;
+        sSum.ulBytes += sKept.ulBytes;
     }
     DynArray_free(oDChildren);
 
+    /* a node's totals add it to its children's totals, unless it is
+       a directory with a lock, which keeps none */
+    NodeFT_getTotals(oNNode, &sKept);
+    if (NodeFT_getLock(oNNode) == NULL
+        && (sKept.ulFiles != sSum.ulFiles
+            || sKept.ulDirs != sSum.ulDirs
+            || sKept.ulBytes != sSum.ulBytes)) {
+        fprintf(stderr,
+                "Subtree totals (%lu files, %lu dirs, %lu bytes) do "
+                "not match the actual ones (%lu, %lu, %lu): (%s)\n",
+                (unsigned long) sKept.ulFiles,
+                (unsigned long) sKept.ulDirs,
+                (unsigned long) sKept.ulBytes,
+                (unsigned long) sSum.ulFiles,
+                (unsigned long) sSum.ulDirs,
+                (unsigned long) sSum.ulBytes, NodeFT_getName(oNNode));
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -187,8 +207,9 @@ static size_t CheckerFT_countNodes(NodeFT_T oNNode) {
 boolean CheckerFT_Node_isValid(NodeFT_T oNNode) {
     NodeFT_T oNParent = NULL;
     NodeFT_T oNChild = NULL;
-    Path_T oPNPath, oPPPath, oSPath;
+    const char *pcName;
     size_t ulIndex;
+    boolean bIsAmongChildren = FALSE;
     DynArray_T oDChildren;
 
     /* A NULL pointer is not a valid node */
@@ -197,28 +218,29 @@ boolean CheckerFT_Node_isValid(NodeFT_T oNNode) {
         return FALSE;
     }
 
+    /* A name is a single, non-empty path component */
+    pcName = NodeFT_getName(oNNode);
+    if (*pcName == '\0' || strchr(pcName, '/') != NULL) {
+        fprintf(stderr, "Node has a malformed name: (%s)\n", pcName);
+        return FALSE;
+    }
+
     /* Node is root, so cannot check parent or sibling invariants */
     oNParent = NodeFT_getParent(oNNode);
     if (oNParent == NULL) {
         return TRUE;
     }
 
-    oPNPath = NodeFT_getPath(oNNode);
-    oPPPath = NodeFT_getPath(oNParent);
-
-    /* Parent's path must be the longest possible proper prefix of the
-       node's path */
-    if (Path_getSharedPrefixDepth(oPNPath, oPPPath) !=
-        Path_getDepth(oPNPath) - 1) {
-        fprintf(stderr,
-                "P-C nodes don't have P-C paths: (%s) (%s)\n",
-                Path_getPathname(oPPPath),
-                Path_getPathname(oPNPath));
+    /* Only a directory can be a parent */
+    if (NodeFT_isFile(oNParent)) {
+        fprintf(stderr, "A file has a child: (%s) (%s)\n",
+                NodeFT_getName(oNParent), pcName);
         return FALSE;
     }
 
     oDChildren = CheckerFT_combineChildren(oNParent);
-    /* Check if siblings have unique paths */
+    /* Node must be among its parent's children, and siblings must
+       have unique names */
     for (ulIndex = 0;
          ulIndex < DynArray_getLength(oDChildren); ulIndex++) {
         if ((oNChild = DynArray_get(oDChildren, ulIndex)) == NULL) {
@@ -228,19 +250,28 @@ boolean CheckerFT_Node_isValid(NodeFT_T oNNode) {
             return FALSE;
         }
 
-        /* Compare path of the current sibling with oNNode */
-        if (oNChild != oNNode
-            && !Path_comparePath(oSPath = NodeFT_getPath(oNChild),
-                                 oPNPath)) {
+        if (oNChild == oNNode) {
+            bIsAmongChildren = TRUE;
+            continue;
+        }
+
+        /* Compare name of the current sibling with oNNode */
+        if (!strcmp(NodeFT_getName(oNChild), pcName)) {
             fprintf(stderr,
-                    "Siblings have non-unique paths: "
+                    "Siblings have non-unique names: "
                     "(%s) (%s)\n",
-                    Path_getPathname(oPNPath),
-                    Path_getPathname(oSPath));
+                    pcName, NodeFT_getName(oNChild));
             DynArray_free(oDChildren);
             return FALSE;
         }
     }
+    if (!bIsAmongChildren) {
+        fprintf(stderr,
+                "Node is not among its parent's children: (%s) (%s)\n",
+                NodeFT_getName(oNParent), pcName);
+        DynArray_free(oDChildren);
+        return FALSE;
+    }
     DynArray_free(oDChildren);
 
     return TRUE;
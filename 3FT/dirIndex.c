@@ -0,0 +1,1527 @@
+/*--------------------------------------------------------------------*/
+/* dirIndex.c                                                         */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "dynarray.h"
+#include "dirIndex.h"
+
+/*--------------------------------------------------------------------*/
+
+/* An index with this many entries switches from a sorted array to a
+   hash table and a B+-tree */
+enum { DIRINDEX_HASH_THRESHOLD = 64 };
+
+/* The size of a cache line, which B+-tree nodes are sized to fill */
+enum { DIRINDEX_CACHE_LINE = 64 };
+
+/* The most entries a leaf holds: a leaf fills two cache lines */
+enum { DIRINDEX_LEAF_MAX =
+       2 * DIRINDEX_CACHE_LINE / sizeof(void *) - 2 };
+
+/* The most children a branch holds: a branch fills four cache lines,
+   and each child takes four words */
+enum { DIRINDEX_BRANCH_MAX =
+       (4 * DIRINDEX_CACHE_LINE / sizeof(void *) - 2) / 4 };
+
+/* The fewest entries a leaf other than the root holds */
+enum { DIRINDEX_LEAF_MIN = DIRINDEX_LEAF_MAX / 2 };
+
+/* The fewest children a branch other than the root holds */
+enum { DIRINDEX_BRANCH_MIN = DIRINDEX_BRANCH_MAX / 2 };
+
+/* A slot of the hash table: an entry and the hash of its name */
+struct DirIndexSlot {
+    /* the hash of the entry's name */
+    size_t ulHash;
+    /* the entry, or NULL if the slot is empty */
+    const void *pvEntry;
+};
+
+/* A leaf of the B+-tree */
+struct DirIndexLeaf {
+    /* the number of entries in the leaf */
+    size_t ulCount;
+    /* the next leaf in name order, NULL for the last */
+    struct DirIndexLeaf *psNext;
+    /* the entries, in name order */
+    const void *apvEntries[DIRINDEX_LEAF_MAX];
+};
+
+/* What a branch of the B+-tree records about each of its children */
+struct DirIndexChild {
+    /* the child: a leaf, or a branch one level further down */
+    void *pvNode;
+    /* the child's first entry in name order */
+    const void *pvMin;
+    /* the number of entries in the child's subtree */
+    size_t ulSize;
+    /* how many of those entries are files */
+    size_t ulFiles;
+};
+
+/* A branch (internal node) of the B+-tree */
+struct DirIndexBranch {
+    /* the number of children of the branch */
+    size_t ulCount;
+    /* the next spare branch while the branch is unused */
+    struct DirIndexBranch *psNextSpare;
+    /* the children, in name order */
+    struct DirIndexChild asChildren[DIRINDEX_BRANCH_MAX];
+};
+
+/*
+   The index of one directory. While psSlots is NULL the index is a
+   plain sorted array, oDEntries. Once the index is hashed, oDEntries
+   is NULL, psSlots finds entries by name and the B+-tree at pvRoot
+   keeps them in name order. A split can reach from a leaf to the root,
+   so enough spare nodes for one are kept in hand before an insertion
+   starts: it then cannot fail halfway.
+*/
+struct DirIndex {
+    /* the arena everything is allocated from */
+    Arena_T oArena;
+    /* returns the name of an entry */
+    const char *(*pfGetName)(const void *pvEntry);
+    /* orders two entries by name */
+    int (*pfCompare)(const void *pvEntry1, const void *pvEntry2);
+    /* tells whether an entry is a file */
+    boolean (*pfIsFile)(const void *pvEntry);
+    /* the entries in name order, NULL once hashed */
+    DynArray_T oDEntries;
+    /* the hash table, NULL while the index is a sorted array */
+    struct DirIndexSlot *psSlots;
+    /* the number of slots, a power of two; 0 while not hashed */
+    size_t ulCapacity;
+    /* the number of entries once hashed */
+    size_t ulLength;
+    /* the root of the B+-tree, NULL while not hashed */
+    void *pvRoot;
+    /* the number of branch levels above the leaves */
+    size_t ulHeight;
+    /* a spare leaf, or NULL */
+    struct DirIndexLeaf *psSpareLeaf;
+    /* the spare branches */
+    struct DirIndexBranch *psSpareBranches;
+    /* the number of spare branches */
+    size_t ulNumSpareBranches;
+};
+
+/* A name to look up, which is not necessarily '\0'-terminated */
+struct DirIndexKey {
+    /* returns the name of an entry */
+    const char *(*pfGetName)(const void *pvEntry);
+    /* the first character of the name */
+    const char *pcName;
+    /* the number of characters in the name */
+    size_t ulLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/** HELPER FUNCTIONS **/
+
+/*
+   Compares the name of entry pvEntry with the name *psKey, in the
+   order strcmp would give were *psKey '\0'-terminated.
+
+   Returns <0, 0 or >0 if pvEntry's name is less than, equal to or
+   greater than *psKey.
+*/
+static int DirIndex_compareKey(const void *pvEntry,
+                               const struct DirIndexKey *psKey) {
+    const char *pcName;
+    int iCompare;
+
+    assert(pvEntry != NULL);
+    assert(psKey != NULL);
+
+    pcName = psKey->pfGetName(pvEntry);
+    iCompare = strncmp(pcName, psKey->pcName, psKey->ulLength);
+    if (iCompare != 0)
+        return iCompare;
+
+    /* equal up to the key's length: a longer name sorts after */
+    return (pcName[psKey->ulLength] != '\0');
+}
+
+/*
+   Returns the FNV-1a hash of the ulLength characters at pcName.
+*/
+static size_t DirIndex_hash(const char *pcName, size_t ulLength) {
+    unsigned long ulHash = 2166136261UL;
+    size_t i;
+
+    assert(pcName != NULL);
+
+    for (i = 0; i < ulLength; i++) {
+        ulHash ^= (unsigned char) pcName[i];
+        ulHash *= 16777619UL;
+    }
+    return (size_t) ulHash;
+}
+
+/*
+   Places pvEntry, whose name hashes to ulHash, in the first empty slot
+   of psSlots, which has ulCapacity slots, at or after its home slot.
+*/
+static void DirIndex_place(struct DirIndexSlot *psSlots,
+                           size_t ulCapacity, size_t ulHash,
+                           const void *pvEntry) {
+    size_t ulSlot;
+
+    assert(psSlots != NULL);
+    assert(pvEntry != NULL);
+
+    ulSlot = ulHash & (ulCapacity - 1);
+    while (psSlots[ulSlot].pvEntry != NULL)
+        ulSlot = (ulSlot + 1) & (ulCapacity - 1);
+    psSlots[ulSlot].ulHash = ulHash;
+    psSlots[ulSlot].pvEntry = pvEntry;
+}
+
+/*
+   Moves the entries of oIndex into a new hash table of ulCapacity
+   slots, which must exceed twice the number of entries. The entries
+   come from the old table if there is one, or else from the sorted
+   array.
+
+   Returns SUCCESS, or MEMORY_ERROR (leaving oIndex unchanged) if
+   memory could not be allocated.
+*/
+static int DirIndex_rehash(DirIndex_T oIndex, size_t ulCapacity) {
+    struct DirIndexSlot *psSlots;
+    const char *pcName;
+    const void *pvEntry;
+    size_t i;
+
+    assert(oIndex != NULL);
+
+    psSlots = Arena_alloc(oIndex->oArena,
+                          ulCapacity * sizeof(struct DirIndexSlot));
+    if (psSlots == NULL)
+        return MEMORY_ERROR;
+    memset(psSlots, 0, ulCapacity * sizeof(struct DirIndexSlot));
+
+    if (oIndex->psSlots != NULL) {
+        assert(ulCapacity > 2 * oIndex->ulLength);
+        for (i = 0; i < oIndex->ulCapacity; i++)
+            if (oIndex->psSlots[i].pvEntry != NULL)
+                DirIndex_place(psSlots, ulCapacity,
+                               oIndex->psSlots[i].ulHash,
+                               oIndex->psSlots[i].pvEntry);
+        Arena_release(oIndex->oArena, oIndex->psSlots,
+                      oIndex->ulCapacity * sizeof(struct DirIndexSlot));
+    } else {
+        assert(ulCapacity > 2 * DynArray_getLength(oIndex->oDEntries));
+        for (i = 0; i < DynArray_getLength(oIndex->oDEntries); i++) {
+            pvEntry = DynArray_get(oIndex->oDEntries, i);
+            pcName = oIndex->pfGetName(pvEntry);
+            DirIndex_place(psSlots, ulCapacity,
+                           DirIndex_hash(pcName, strlen(pcName)),
+                           pvEntry);
+        }
+    }
+
+    oIndex->psSlots = psSlots;
+    oIndex->ulCapacity = ulCapacity;
+    return SUCCESS;
+}
+
+/*
+   Returns the slot of hashed index oIndex that holds the entry named
+   by the ulNameLength characters at pcName, whose hash is ulHash, or
+   the empty slot where probing for it stopped.
+*/
+static size_t DirIndex_probe(DirIndex_T oIndex, const char *pcName,
+                             size_t ulNameLength, size_t ulHash) {
+    struct DirIndexKey sKey;
+    size_t ulSlot;
+
+    assert(oIndex != NULL);
+    assert(oIndex->psSlots != NULL);
+    assert(pcName != NULL);
+
+    sKey.pfGetName = oIndex->pfGetName;
+    sKey.pcName = pcName;
+    sKey.ulLength = ulNameLength;
+
+    ulSlot = ulHash & (oIndex->ulCapacity - 1);
+    while (oIndex->psSlots[ulSlot].pvEntry != NULL) {
+        if (oIndex->psSlots[ulSlot].ulHash == ulHash
+            && DirIndex_compareKey(oIndex->psSlots[ulSlot].pvEntry,
+                                   &sKey) == 0)
+            break;
+        ulSlot = (ulSlot + 1) & (oIndex->ulCapacity - 1);
+    }
+    return ulSlot;
+}
+
+/*
+   Returns the number of entries of leaf, or children of branch,
+   pvNode. (Both kinds of node begin with their count.)
+*/
+static size_t DirIndex_getCount(const void *pvNode) {
+    assert(pvNode != NULL);
+
+    return *(const size_t *) pvNode;
+}
+
+/*
+   Returns the first entry in name order under pvNode, a leaf if
+   ulLevel is 0 and a branch otherwise.
+*/
+static const void *DirIndex_getMin(const void *pvNode, size_t ulLevel) {
+    assert(pvNode != NULL);
+    assert(DirIndex_getCount(pvNode) > 0);
+
+    if (ulLevel == 0)
+        return ((const struct DirIndexLeaf *) pvNode)->apvEntries[0];
+    return ((const struct DirIndexBranch *) pvNode)->asChildren[0].pvMin;
+}
+
+/*
+   Fills in *psChild to describe pvNode, a leaf if ulLevel is 0 and a
+   branch otherwise, as its parent records it.
+*/
+static void DirIndex_describe(DirIndex_T oIndex, void *pvNode,
+                              size_t ulLevel,
+                              struct DirIndexChild *psChild) {
+    const struct DirIndexLeaf *psLeaf;
+    const struct DirIndexBranch *psBranch;
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(pvNode != NULL);
+    assert(psChild != NULL);
+
+    psChild->pvNode = pvNode;
+    psChild->pvMin = DirIndex_getMin(pvNode, ulLevel);
+    psChild->ulSize = 0;
+    psChild->ulFiles = 0;
+    if (ulLevel == 0) {
+        psLeaf = pvNode;
+        psChild->ulSize = psLeaf->ulCount;
+        for (i = 0; i < psLeaf->ulCount; i++)
+            if (oIndex->pfIsFile(psLeaf->apvEntries[i]))
+                psChild->ulFiles++;
+    } else {
+        psBranch = pvNode;
+        for (i = 0; i < psBranch->ulCount; i++) {
+            psChild->ulSize += psBranch->asChildren[i].ulSize;
+            psChild->ulFiles += psBranch->asChildren[i].ulFiles;
+        }
+    }
+}
+
+/*
+   Returns the position of the first entry of psLeaf that *pfCompare
+   does not find less than pvKey, or psLeaf's count if there is none.
+*/
+static size_t DirIndex_lowerBound(const struct DirIndexLeaf *psLeaf,
+                                  int (*pfCompare)(const void *pvEntry,
+                                                   const void *pvKey),
+                                  const void *pvKey) {
+    size_t ulLow = 0;
+    size_t ulHigh;
+    size_t ulMid;
+
+    assert(psLeaf != NULL);
+    assert(pfCompare != NULL);
+
+    ulHigh = psLeaf->ulCount;
+    while (ulLow < ulHigh) {
+        ulMid = ulLow + (ulHigh - ulLow) / 2;
+        if ((*pfCompare)(psLeaf->apvEntries[ulMid], pvKey) < 0)
+            ulLow = ulMid + 1;
+        else
+            ulHigh = ulMid;
+    }
+    return ulLow;
+}
+
+/*
+   Returns the position of the child of psBranch under which pvKey
+   belongs: the last child whose first entry *pfCompare does not find
+   greater than pvKey, or the first child if there is none.
+*/
+static size_t DirIndex_childFor(const struct DirIndexBranch *psBranch,
+                                int (*pfCompare)(const void *pvEntry,
+                                                 const void *pvKey),
+                                const void *pvKey) {
+    size_t i;
+
+    assert(psBranch != NULL);
+    assert(psBranch->ulCount > 0);
+    assert(pfCompare != NULL);
+
+    i = psBranch->ulCount - 1;
+    while (i > 0 && (*pfCompare)(psBranch->asChildren[i].pvMin,
+                                 pvKey) > 0)
+        i--;
+    return i;
+}
+
+/*
+   Inserts the ulSize-byte item *pvItem at position ulSlot of the full
+   array pcItems of ulMax items, then splits the ulMax + 1 items:
+   pcItems keeps the first (ulMax + 1) / 2 and pcNewItems receives the
+   rest.
+*/
+static void DirIndex_splitInsert(char *pcItems, char *pcNewItems,
+                                 size_t ulMax, size_t ulSlot,
+                                 const void *pvItem, size_t ulSize) {
+    size_t ulLeft = (ulMax + 1) / 2;
+
+    assert(pcItems != NULL);
+    assert(pcNewItems != NULL);
+    assert(ulSlot <= ulMax);
+
+    if (ulSlot < ulLeft) {
+        /* the item stays left, pushing the last left item over */
+        memcpy(pcNewItems, pcItems + (ulLeft - 1) * ulSize,
+               (ulMax - ulLeft + 1) * ulSize);
+        memmove(pcItems + (ulSlot + 1) * ulSize,
+                pcItems + ulSlot * ulSize,
+                (ulLeft - 1 - ulSlot) * ulSize);
+        memcpy(pcItems + ulSlot * ulSize, pvItem, ulSize);
+    } else {
+        /* the item goes right, between the items around it */
+        memcpy(pcNewItems, pcItems + ulLeft * ulSize,
+               (ulSlot - ulLeft) * ulSize);
+        memcpy(pcNewItems + (ulSlot - ulLeft) * ulSize, pvItem, ulSize);
+        memcpy(pcNewItems + (ulSlot - ulLeft + 1) * ulSize,
+               pcItems + ulSlot * ulSize, (ulMax - ulSlot) * ulSize);
+    }
+}
+
+/*
+   Makes sure oIndex has spare nodes enough for a split from a leaf up
+   through a new root.
+
+   Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated.
+*/
+static int DirIndex_reserve(DirIndex_T oIndex) {
+    struct DirIndexBranch *psBranch;
+
+    assert(oIndex != NULL);
+
+    if (oIndex->psSpareLeaf == NULL) {
+        oIndex->psSpareLeaf = Arena_alloc(oIndex->oArena,
+                                          sizeof(struct DirIndexLeaf));
+        if (oIndex->psSpareLeaf == NULL)
+            return MEMORY_ERROR;
+    }
+    while (oIndex->ulNumSpareBranches < oIndex->ulHeight + 1) {
+        psBranch = Arena_alloc(oIndex->oArena,
+                               sizeof(struct DirIndexBranch));
+        if (psBranch == NULL)
+            return MEMORY_ERROR;
+        psBranch->psNextSpare = oIndex->psSpareBranches;
+        oIndex->psSpareBranches = psBranch;
+        oIndex->ulNumSpareBranches++;
+    }
+    return SUCCESS;
+}
+
+/*
+   Returns a spare branch of oIndex, which must have one.
+*/
+static struct DirIndexBranch *DirIndex_takeBranch(DirIndex_T oIndex) {
+    struct DirIndexBranch *psBranch;
+
+    assert(oIndex != NULL);
+    assert(oIndex->psSpareBranches != NULL);
+
+    psBranch = oIndex->psSpareBranches;
+    oIndex->psSpareBranches = psBranch->psNextSpare;
+    oIndex->ulNumSpareBranches--;
+    psBranch->psNextSpare = NULL;
+    return psBranch;
+}
+
+/*
+   Inserts pvEntry into the subtree of oIndex's B+-tree at pvNode, a
+   leaf if ulLevel is 0 and a branch otherwise. If pvNode has to split,
+   returns its new right sibling, which the caller must link into the
+   tree; otherwise returns NULL. Draws any new node from the spares.
+*/
+static void *DirIndex_insertBelow(DirIndex_T oIndex, void *pvNode,
+                                  size_t ulLevel, const void *pvEntry) {
+    struct DirIndexLeaf *psLeaf;
+    struct DirIndexLeaf *psNewLeaf;
+    struct DirIndexBranch *psBranch;
+    struct DirIndexBranch *psNewBranch;
+    struct DirIndexChild *psChild;
+    struct DirIndexChild sNew;
+    void *pvSplit;
+    size_t ulSlot;
+
+    assert(oIndex != NULL);
+    assert(pvNode != NULL);
+    assert(pvEntry != NULL);
+
+    if (ulLevel == 0) {
+        psLeaf = pvNode;
+        ulSlot = DirIndex_lowerBound(psLeaf, oIndex->pfCompare, pvEntry);
+        if (psLeaf->ulCount < DIRINDEX_LEAF_MAX) {
+            memmove(&psLeaf->apvEntries[ulSlot + 1],
+                    &psLeaf->apvEntries[ulSlot],
+                    (psLeaf->ulCount - ulSlot) * sizeof(const void *));
+            psLeaf->apvEntries[ulSlot] = pvEntry;
+            psLeaf->ulCount++;
+            return NULL;
+        }
+
+        /* split the full leaf, linking the new one in after it */
+        psNewLeaf = oIndex->psSpareLeaf;
+        oIndex->psSpareLeaf = NULL;
+        assert(psNewLeaf != NULL);
+        DirIndex_splitInsert((char *) psLeaf->apvEntries,
+                             (char *) psNewLeaf->apvEntries,
+                             DIRINDEX_LEAF_MAX, ulSlot, &pvEntry,
+                             sizeof(const void *));
+        psLeaf->ulCount = (DIRINDEX_LEAF_MAX + 1) / 2;
+        psNewLeaf->ulCount = DIRINDEX_LEAF_MAX + 1 - psLeaf->ulCount;
+        psNewLeaf->psNext = psLeaf->psNext;
+        psLeaf->psNext = psNewLeaf;
+        return psNewLeaf;
+    }
+
+    psBranch = pvNode;
+    ulSlot = DirIndex_childFor(psBranch, oIndex->pfCompare, pvEntry);
+    psChild = &psBranch->asChildren[ulSlot];
+    pvSplit = DirIndex_insertBelow(oIndex, psChild->pvNode, ulLevel - 1,
+                                   pvEntry);
+    if (pvSplit == NULL) {
+        psChild->ulSize++;
+        if (oIndex->pfIsFile(pvEntry))
+            psChild->ulFiles++;
+        if (oIndex->pfCompare(pvEntry, psChild->pvMin) < 0)
+            psChild->pvMin = pvEntry;
+        return NULL;
+    }
+
+    /* the child split: record both halves */
+    DirIndex_describe(oIndex, psChild->pvNode, ulLevel - 1, psChild);
+    DirIndex_describe(oIndex, pvSplit, ulLevel - 1, &sNew);
+    ulSlot++;
+    if (psBranch->ulCount < DIRINDEX_BRANCH_MAX) {
+        memmove(&psBranch->asChildren[ulSlot + 1],
+                &psBranch->asChildren[ulSlot],
+                (psBranch->ulCount - ulSlot)
+                * sizeof(struct DirIndexChild));
+        psBranch->asChildren[ulSlot] = sNew;
+        psBranch->ulCount++;
+        return NULL;
+    }
+
+    /* split the full branch too */
+    psNewBranch = DirIndex_takeBranch(oIndex);
+    DirIndex_splitInsert((char *) psBranch->asChildren,
+                         (char *) psNewBranch->asChildren,
+                         DIRINDEX_BRANCH_MAX, ulSlot, &sNew,
+                         sizeof(struct DirIndexChild));
+    psBranch->ulCount = (DIRINDEX_BRANCH_MAX + 1) / 2;
+    psNewBranch->ulCount = DIRINDEX_BRANCH_MAX + 1 - psBranch->ulCount;
+    return psNewBranch;
+}
+
+/*
+   Inserts pvEntry into the B+-tree of oIndex, growing a new root if the
+   old one splits. oIndex must hold the spares DirIndex_reserve keeps.
+*/
+static void DirIndex_treeInsert(DirIndex_T oIndex, const void *pvEntry) {
+    struct DirIndexBranch *psRoot;
+    void *pvSplit;
+
+    assert(oIndex != NULL);
+    assert(oIndex->pvRoot != NULL);
+
+    pvSplit = DirIndex_insertBelow(oIndex, oIndex->pvRoot,
+                                   oIndex->ulHeight, pvEntry);
+    if (pvSplit == NULL)
+        return;
+
+    psRoot = DirIndex_takeBranch(oIndex);
+    DirIndex_describe(oIndex, oIndex->pvRoot, oIndex->ulHeight,
+                      &psRoot->asChildren[0]);
+    DirIndex_describe(oIndex, pvSplit, oIndex->ulHeight,
+                      &psRoot->asChildren[1]);
+    psRoot->ulCount = 2;
+    oIndex->pvRoot = psRoot;
+    oIndex->ulHeight++;
+}
+
+/*
+   Restores the minimum fill of child ulSlot of psBranch, a node at
+   level ulLevel, after a removal left it short: merges it with a
+   neighbouring sibling if the two fit in one node, or else moves one
+   item over from that sibling.
+*/
+static void DirIndex_rebalance(DirIndex_T oIndex,
+                               struct DirIndexBranch *psBranch,
+                               size_t ulSlot, size_t ulLevel) {
+    struct DirIndexChild *psLeft;
+    struct DirIndexChild *psRight;
+    struct DirIndexLeaf *psLeftLeaf;
+    struct DirIndexLeaf *psRightLeaf;
+    struct DirIndexBranch *psLeftBranch;
+    struct DirIndexBranch *psRightBranch;
+    size_t ulLeftCount;
+    size_t ulRightCount;
+    size_t ulMax;
+
+    assert(oIndex != NULL);
+    assert(psBranch != NULL);
+    assert(psBranch->ulCount >= 2);
+
+    if (ulSlot > 0)
+        ulSlot--;
+    psLeft = &psBranch->asChildren[ulSlot];
+    psRight = &psBranch->asChildren[ulSlot + 1];
+    ulLeftCount = DirIndex_getCount(psLeft->pvNode);
+    ulRightCount = DirIndex_getCount(psRight->pvNode);
+    ulMax = (ulLevel == 0) ? DIRINDEX_LEAF_MAX : DIRINDEX_BRANCH_MAX;
+
+    if (ulLevel == 0) {
+        psLeftLeaf = psLeft->pvNode;
+        psRightLeaf = psRight->pvNode;
+        if (ulLeftCount + ulRightCount <= ulMax) {
+            memcpy(&psLeftLeaf->apvEntries[ulLeftCount],
+                   psRightLeaf->apvEntries,
+                   ulRightCount * sizeof(const void *));
+            psLeftLeaf->ulCount += ulRightCount;
+            psLeftLeaf->psNext = psRightLeaf->psNext;
+            Arena_release(oIndex->oArena, psRightLeaf,
+                          sizeof(struct DirIndexLeaf));
+        } else if (ulLeftCount < ulRightCount) {
+            psLeftLeaf->apvEntries[psLeftLeaf->ulCount++] =
+                    psRightLeaf->apvEntries[0];
+            psRightLeaf->ulCount--;
+            memmove(&psRightLeaf->apvEntries[0],
+                    &psRightLeaf->apvEntries[1],
+                    psRightLeaf->ulCount * sizeof(const void *));
+        } else {
+            memmove(&psRightLeaf->apvEntries[1],
+                    &psRightLeaf->apvEntries[0],
+                    psRightLeaf->ulCount * sizeof(const void *));
+            psRightLeaf->apvEntries[0] =
+                    psLeftLeaf->apvEntries[--psLeftLeaf->ulCount];
+            psRightLeaf->ulCount++;
+        }
+    } else {
+        psLeftBranch = psLeft->pvNode;
+        psRightBranch = psRight->pvNode;
+        if (ulLeftCount + ulRightCount <= ulMax) {
+            memcpy(&psLeftBranch->asChildren[ulLeftCount],
+                   psRightBranch->asChildren,
+                   ulRightCount * sizeof(struct DirIndexChild));
+            psLeftBranch->ulCount += ulRightCount;
+            Arena_release(oIndex->oArena, psRightBranch,
+                          sizeof(struct DirIndexBranch));
+        } else if (ulLeftCount < ulRightCount) {
+            psLeftBranch->asChildren[psLeftBranch->ulCount++] =
+                    psRightBranch->asChildren[0];
+            psRightBranch->ulCount--;
+            memmove(&psRightBranch->asChildren[0],
+                    &psRightBranch->asChildren[1],
+                    psRightBranch->ulCount
+                    * sizeof(struct DirIndexChild));
+        } else {
+            memmove(&psRightBranch->asChildren[1],
+                    &psRightBranch->asChildren[0],
+                    psRightBranch->ulCount
+                    * sizeof(struct DirIndexChild));
+            psRightBranch->asChildren[0] =
+                    psLeftBranch->asChildren[--psLeftBranch->ulCount];
+            psRightBranch->ulCount++;
+        }
+    }
+
+    if (ulLeftCount + ulRightCount <= ulMax) {
+        /* the right sibling was merged away */
+        DirIndex_describe(oIndex, psLeft->pvNode, ulLevel, psLeft);
+        psBranch->ulCount--;
+        memmove(psRight, psRight + 1,
+                (psBranch->ulCount - ulSlot - 1)
+                * sizeof(struct DirIndexChild));
+    } else {
+        DirIndex_describe(oIndex, psLeft->pvNode, ulLevel, psLeft);
+        DirIndex_describe(oIndex, psRight->pvNode, ulLevel, psRight);
+    }
+}
+
+/*
+   Removes pvEntry from the subtree of oIndex's B+-tree at pvNode, a
+   leaf if ulLevel is 0 and a branch otherwise. pvNode may be left
+   short of its minimum fill, for its parent to restore.
+
+   Returns TRUE if pvEntry was found, and FALSE otherwise.
+*/
+static boolean DirIndex_removeBelow(DirIndex_T oIndex, void *pvNode,
+                                    size_t ulLevel,
+                                    const void *pvEntry) {
+    struct DirIndexLeaf *psLeaf;
+    struct DirIndexBranch *psBranch;
+    struct DirIndexChild *psChild;
+    size_t ulSlot;
+    size_t ulMin;
+
+    assert(oIndex != NULL);
+    assert(pvNode != NULL);
+    assert(pvEntry != NULL);
+
+    if (ulLevel == 0) {
+        psLeaf = pvNode;
+        ulSlot = DirIndex_lowerBound(psLeaf, oIndex->pfCompare, pvEntry);
+        if (ulSlot == psLeaf->ulCount
+            || psLeaf->apvEntries[ulSlot] != pvEntry)
+            return FALSE;
+        psLeaf->ulCount--;
+        memmove(&psLeaf->apvEntries[ulSlot],
+                &psLeaf->apvEntries[ulSlot + 1],
+                (psLeaf->ulCount - ulSlot) * sizeof(const void *));
+        return TRUE;
+    }
+
+    psBranch = pvNode;
+    ulSlot = DirIndex_childFor(psBranch, oIndex->pfCompare, pvEntry);
+    psChild = &psBranch->asChildren[ulSlot];
+    if (!DirIndex_removeBelow(oIndex, psChild->pvNode, ulLevel - 1,
+                              pvEntry))
+        return FALSE;
+
+    ulMin = (ulLevel == 1) ? DIRINDEX_LEAF_MIN : DIRINDEX_BRANCH_MIN;
+    if (DirIndex_getCount(psChild->pvNode) < ulMin) {
+        DirIndex_rebalance(oIndex, psBranch, ulSlot, ulLevel - 1);
+        return TRUE;
+    }
+
+    psChild->ulSize--;
+    if (oIndex->pfIsFile(pvEntry))
+        psChild->ulFiles--;
+    if (psChild->pvMin == pvEntry)
+        psChild->pvMin = DirIndex_getMin(psChild->pvNode, ulLevel - 1);
+    return TRUE;
+}
+
+/*
+   Removes pvEntry from the B+-tree of oIndex, dropping any root left
+   with a single child.
+
+   Returns TRUE if pvEntry was found, and FALSE otherwise.
+*/
+static boolean DirIndex_treeRemove(DirIndex_T oIndex,
+                                   const void *pvEntry) {
+    struct DirIndexBranch *psRoot;
+
+    assert(oIndex != NULL);
+    assert(oIndex->pvRoot != NULL);
+
+    if (!DirIndex_removeBelow(oIndex, oIndex->pvRoot, oIndex->ulHeight,
+                              pvEntry))
+        return FALSE;
+
+    while (oIndex->ulHeight > 0
+           && DirIndex_getCount(oIndex->pvRoot) == 1) {
+        psRoot = oIndex->pvRoot;
+        oIndex->pvRoot = psRoot->asChildren[0].pvNode;
+        oIndex->ulHeight--;
+        Arena_release(oIndex->oArena, psRoot,
+                      sizeof(struct DirIndexBranch));
+    }
+    return TRUE;
+}
+
+/*
+   Releases pvNode, a leaf if ulLevel is 0 and a branch otherwise, and
+   every node below it to oIndex's arena.
+*/
+static void DirIndex_freeNode(DirIndex_T oIndex, void *pvNode,
+                              size_t ulLevel) {
+    struct DirIndexBranch *psBranch;
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(pvNode != NULL);
+
+    if (ulLevel == 0) {
+        Arena_release(oIndex->oArena, pvNode,
+                      sizeof(struct DirIndexLeaf));
+        return;
+    }
+
+    psBranch = pvNode;
+    for (i = 0; i < psBranch->ulCount; i++)
+        DirIndex_freeNode(oIndex, psBranch->asChildren[i].pvNode,
+                          ulLevel - 1);
+    Arena_release(oIndex->oArena, psBranch,
+                  sizeof(struct DirIndexBranch));
+}
+
+/*
+   Releases the B+-tree of oIndex, if it has one, and its spare nodes.
+*/
+static void DirIndex_freeTree(DirIndex_T oIndex) {
+    assert(oIndex != NULL);
+
+    if (oIndex->pvRoot != NULL)
+        DirIndex_freeNode(oIndex, oIndex->pvRoot, oIndex->ulHeight);
+    oIndex->pvRoot = NULL;
+    oIndex->ulHeight = 0;
+
+    if (oIndex->psSpareLeaf != NULL)
+        Arena_release(oIndex->oArena, oIndex->psSpareLeaf,
+                      sizeof(struct DirIndexLeaf));
+    oIndex->psSpareLeaf = NULL;
+    while (oIndex->psSpareBranches != NULL)
+        Arena_release(oIndex->oArena, DirIndex_takeBranch(oIndex),
+                      sizeof(struct DirIndexBranch));
+}
+
+/*
+   Converts oIndex from a sorted array to a hash table and a B+-tree.
+
+   Returns SUCCESS, or MEMORY_ERROR (leaving oIndex unchanged) if
+   memory could not be allocated.
+*/
+static int DirIndex_convert(DirIndex_T oIndex) {
+    struct DirIndexLeaf *psLeaf;
+    size_t ulLength;
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(oIndex->psSlots == NULL);
+
+    ulLength = DynArray_getLength(oIndex->oDEntries);
+
+    psLeaf = Arena_alloc(oIndex->oArena, sizeof(struct DirIndexLeaf));
+    if (psLeaf == NULL)
+        return MEMORY_ERROR;
+    psLeaf->ulCount = 0;
+    psLeaf->psNext = NULL;
+    oIndex->pvRoot = psLeaf;
+    oIndex->ulHeight = 0;
+
+    for (i = 0; i < ulLength; i++) {
+        if (DirIndex_reserve(oIndex) != SUCCESS) {
+            DirIndex_freeTree(oIndex);
+            return MEMORY_ERROR;
+        }
+        DirIndex_treeInsert(oIndex,
+                            DynArray_get(oIndex->oDEntries, i));
+    }
+
+    if (DirIndex_rehash(oIndex, 4 * DIRINDEX_HASH_THRESHOLD)
+        != SUCCESS) {
+        DirIndex_freeTree(oIndex);
+        return MEMORY_ERROR;
+    }
+
+    oIndex->ulLength = ulLength;
+    DynArray_free(oIndex->oDEntries);
+    oIndex->oDEntries = NULL;
+    return SUCCESS;
+}
+
+/*
+   Returns the number of nodes it takes to hold ulItems items, at most
+   ulMax to a node.
+*/
+static size_t DirIndex_countNodes(size_t ulItems, size_t ulMax) {
+    assert(ulMax > 0);
+
+    return (ulItems + ulMax - 1) / ulMax;
+}
+
+/*
+   Builds the B+-tree of oIndex bottom up from the ulLength entries at
+   ppvEntries, which are in name order: spreads them evenly over the
+   ulLeaves leaves, then the leaves evenly over as few branches as will
+   hold them, and so on up to a single root, so that every node is as
+   full as the fill of the others allows. The leaves are in
+   psLevel[i].pvNode, and the branches needed are oIndex's spares;
+   psLevel is then overwritten with each level's records in turn.
+*/
+static void DirIndex_build(DirIndex_T oIndex, void **ppvEntries,
+                           size_t ulLength,
+                           struct DirIndexChild *psLevel,
+                           size_t ulLeaves) {
+    struct DirIndexLeaf *psLeaf;
+    struct DirIndexBranch *psBranch;
+    size_t ulNodes, ulBranches;
+    size_t ulLevel = 0;
+    size_t ulNext = 0;
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(ppvEntries != NULL);
+    assert(psLevel != NULL);
+    assert(ulLeaves > 0);
+
+    for (i = 0; i < ulLeaves; i++) {
+        psLeaf = psLevel[i].pvNode;
+        psLeaf->ulCount = (ulLength - ulNext) / (ulLeaves - i);
+        memcpy(psLeaf->apvEntries, ppvEntries + ulNext,
+               psLeaf->ulCount * sizeof(const void *));
+        psLeaf->psNext = (i + 1 < ulLeaves)
+                         ? psLevel[i + 1].pvNode : NULL;
+        ulNext += psLeaf->ulCount;
+        DirIndex_describe(oIndex, psLeaf, 0, &psLevel[i]);
+    }
+
+    /* each branch's records are read before any is written over, as
+       every branch takes at least one */
+    for (ulNodes = ulLeaves; ulNodes > 1; ulNodes = ulBranches) {
+        ulBranches = DirIndex_countNodes(ulNodes, DIRINDEX_BRANCH_MAX);
+        ulNext = 0;
+        for (i = 0; i < ulBranches; i++) {
+            psBranch = DirIndex_takeBranch(oIndex);
+            psBranch->ulCount = (ulNodes - ulNext) / (ulBranches - i);
+            memcpy(psBranch->asChildren, &psLevel[ulNext],
+                   psBranch->ulCount * sizeof(struct DirIndexChild));
+            ulNext += psBranch->ulCount;
+            DirIndex_describe(oIndex, psBranch, ulLevel + 1,
+                              &psLevel[i]);
+        }
+        ulLevel++;
+    }
+
+    oIndex->pvRoot = psLevel[0].pvNode;
+    oIndex->ulHeight = ulLevel;
+}
+
+#ifndef NDEBUG
+
+/*
+   Checks the subtree of oIndex's B+-tree at pvNode, a leaf if ulLevel
+   is 0 and a branch otherwise: its fill, and that its parent's record
+   of each of its children is accurate.
+
+   Returns 1 (TRUE) iff the subtree is valid.
+*/
+static int DirIndex_nodeIsValid(DirIndex_T oIndex, void *pvNode,
+                                size_t ulLevel, boolean bIsRoot) {
+    const struct DirIndexBranch *psBranch;
+    struct DirIndexChild sActual;
+    size_t ulCount;
+    size_t i;
+
+    ulCount = DirIndex_getCount(pvNode);
+    if (ulLevel == 0) {
+        if (ulCount > DIRINDEX_LEAF_MAX) return 0;
+        return (bIsRoot || ulCount >= DIRINDEX_LEAF_MIN);
+    }
+
+    if (ulCount > DIRINDEX_BRANCH_MAX) return 0;
+    if (ulCount < (bIsRoot ? 2 : DIRINDEX_BRANCH_MIN)) return 0;
+
+    psBranch = pvNode;
+    for (i = 0; i < ulCount; i++) {
+        DirIndex_describe(oIndex, psBranch->asChildren[i].pvNode,
+                          ulLevel - 1, &sActual);
+        if (sActual.pvMin != psBranch->asChildren[i].pvMin
+            || sActual.ulSize != psBranch->asChildren[i].ulSize
+            || sActual.ulFiles != psBranch->asChildren[i].ulFiles)
+            return 0;
+        if (!DirIndex_nodeIsValid(oIndex,
+                                  psBranch->asChildren[i].pvNode,
+                                  ulLevel - 1, FALSE))
+            return 0;
+    }
+    return 1;
+}
+
+/*
+   Checks the invariants of oIndex. For a hashed index this walks the
+   whole B+-tree.
+
+   Returns 1 (TRUE) iff oIndex is in a valid state.
+*/
+static int DirIndex_isValid(DirIndex_T oIndex) {
+    const struct DirIndexLeaf *psLeaf;
+    const void *pvNode;
+    const void *pvPrev = NULL;
+    size_t ulLevel;
+    size_t ulLength = 0;
+    size_t i;
+
+    if (oIndex == NULL) return 0;
+
+    if (oIndex->psSlots == NULL)
+        return (oIndex->oDEntries != NULL && oIndex->pvRoot == NULL);
+    if (oIndex->oDEntries != NULL || oIndex->pvRoot == NULL) return 0;
+
+    /* the linked leaves hold every entry, in strictly increasing
+       name order */
+    pvNode = oIndex->pvRoot;
+    for (ulLevel = oIndex->ulHeight; ulLevel > 0; ulLevel--)
+        pvNode = ((const struct DirIndexBranch *) pvNode)
+                ->asChildren[0].pvNode;
+    for (psLeaf = pvNode; psLeaf != NULL; psLeaf = psLeaf->psNext) {
+        for (i = 0; i < psLeaf->ulCount; i++) {
+            if (pvPrev != NULL
+                && oIndex->pfCompare(pvPrev,
+                                     psLeaf->apvEntries[i]) >= 0)
+                return 0;
+            pvPrev = psLeaf->apvEntries[i];
+            ulLength++;
+        }
+    }
+    if (ulLength != oIndex->ulLength) return 0;
+
+    return DirIndex_nodeIsValid(oIndex, oIndex->pvRoot,
+                                oIndex->ulHeight, TRUE);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+DirIndex_T DirIndex_new(Arena_T oArena,
+                        const char *(*pfGetName)(const void *pvEntry),
+                        int (*pfCompare)(const void *pvEntry1,
+                                         const void *pvEntry2),
+                        boolean (*pfIsFile)(const void *pvEntry)) {
+    DirIndex_T oIndex;
+
+    assert(oArena != NULL);
+    assert(pfGetName != NULL);
+    assert(pfCompare != NULL);
+    assert(pfIsFile != NULL);
+
+    oIndex = Arena_alloc(oArena, sizeof(struct DirIndex));
+    if (oIndex == NULL)
+        return NULL;
+
+    oIndex->oDEntries =
+            DynArray_newWith(0, Arena_getDynArrayAllocator(oArena));
+    if (oIndex->oDEntries == NULL) {
+        Arena_release(oArena, oIndex, sizeof(struct DirIndex));
+        return NULL;
+    }
+
+    oIndex->oArena = oArena;
+    oIndex->pfGetName = pfGetName;
+    oIndex->pfCompare = pfCompare;
+    oIndex->pfIsFile = pfIsFile;
+    oIndex->psSlots = NULL;
+    oIndex->ulCapacity = 0;
+    oIndex->ulLength = 0;
+    oIndex->pvRoot = NULL;
+    oIndex->ulHeight = 0;
+    oIndex->psSpareLeaf = NULL;
+    oIndex->psSpareBranches = NULL;
+    oIndex->ulNumSpareBranches = 0;
+    return oIndex;
+}
+
+void DirIndex_free(DirIndex_T oIndex) {
+    assert(oIndex != NULL);
+
+    if (oIndex->psSlots != NULL)
+        Arena_release(oIndex->oArena, oIndex->psSlots,
+                      oIndex->ulCapacity * sizeof(struct DirIndexSlot));
+    if (oIndex->oDEntries != NULL)
+        DynArray_free(oIndex->oDEntries);
+    DirIndex_freeTree(oIndex);
+    Arena_release(oIndex->oArena, oIndex, sizeof(struct DirIndex));
+}
+
+size_t DirIndex_getLength(DirIndex_T oIndex) {
+    assert(oIndex != NULL);
+
+    if (oIndex->psSlots != NULL)
+        return oIndex->ulLength;
+    return DynArray_getLength(oIndex->oDEntries);
+}
+
+void *DirIndex_find(DirIndex_T oIndex, const char *pcName,
+                    size_t ulNameLength) {
+    size_t ulIndex = 0;
+
+    assert(oIndex != NULL);
+    assert(pcName != NULL);
+
+    if (oIndex->psSlots != NULL)
+        return (void *) oIndex->psSlots[
+                DirIndex_probe(oIndex, pcName, ulNameLength,
+                               DirIndex_hash(pcName, ulNameLength))
+                ].pvEntry;
+
+    if (!DirIndex_search(oIndex, pcName, ulNameLength, &ulIndex))
+        return NULL;
+    return DynArray_get(oIndex->oDEntries, ulIndex);
+}
+
+boolean DirIndex_search(DirIndex_T oIndex, const char *pcName,
+                        size_t ulNameLength, size_t *pulIndex) {
+    struct DirIndexKey sKey;
+    struct DirIndexCursor sCursor;
+    const struct DirIndexLeaf *psLeaf;
+
+    assert(oIndex != NULL);
+    assert(pcName != NULL);
+    assert(pulIndex != NULL);
+
+    sKey.pfGetName = oIndex->pfGetName;
+    sKey.pcName = pcName;
+    sKey.ulLength = ulNameLength;
+
+    if (oIndex->psSlots == NULL)
+        return (boolean) DynArray_bsearch(
+                oIndex->oDEntries, &sKey, pulIndex,
+                (int (*)(const void *, const void *)) DirIndex_compareKey);
+
+    DirIndex_seek(oIndex, pcName, ulNameLength, &sCursor);
+    *pulIndex = sCursor.ulRank;
+    psLeaf = sCursor.pvLeaf;
+    return (boolean) (sCursor.ulSlot < psLeaf->ulCount
+                      && DirIndex_compareKey(
+                              psLeaf->apvEntries[sCursor.ulSlot],
+                              &sKey) == 0);
+}
+
+int DirIndex_insert(DirIndex_T oIndex, void *pvEntry) {
+    const char *pcName;
+    size_t ulNameLength;
+    size_t ulHash;
+    size_t ulSlot;
+    size_t ulIndex = 0;
+
+    assert(oIndex != NULL);
+    assert(pvEntry != NULL);
+    assert(DirIndex_isValid(oIndex));
+
+    pcName = oIndex->pfGetName(pvEntry);
+    ulNameLength = strlen(pcName);
+
+    /* a sorted array: insert in place, converting it once it is wide */
+    if (oIndex->psSlots == NULL) {
+        if (DirIndex_search(oIndex, pcName, ulNameLength, &ulIndex))
+            return ALREADY_IN_TREE;
+        if (DynArray_getLength(oIndex->oDEntries) + 1
+            < DIRINDEX_HASH_THRESHOLD
+            || DirIndex_convert(oIndex) != SUCCESS) {
+            /* (if the conversion fails, stay an array) */
+            if (!DynArray_addAt(oIndex->oDEntries, ulIndex, pvEntry))
+                return MEMORY_ERROR;
+            return SUCCESS;
+        }
+    }
+
+    ulHash = DirIndex_hash(pcName, ulNameLength);
+    ulSlot = DirIndex_probe(oIndex, pcName, ulNameLength, ulHash);
+    if (oIndex->psSlots[ulSlot].pvEntry != NULL)
+        return ALREADY_IN_TREE;
+
+    /* keep the load factor at most one half */
+    if (2 * (oIndex->ulLength + 1) >= oIndex->ulCapacity) {
+        if (DirIndex_rehash(oIndex, 2 * oIndex->ulCapacity) != SUCCESS)
+            return MEMORY_ERROR;
+        ulSlot = DirIndex_probe(oIndex, pcName, ulNameLength, ulHash);
+    }
+    if (DirIndex_reserve(oIndex) != SUCCESS)
+        return MEMORY_ERROR;
+
+    /* nothing can fail from here on */
+    DirIndex_treeInsert(oIndex, pvEntry);
+    oIndex->psSlots[ulSlot].ulHash = ulHash;
+    oIndex->psSlots[ulSlot].pvEntry = pvEntry;
+    oIndex->ulLength++;
+
+    assert(DirIndex_isValid(oIndex));
+    return SUCCESS;
+}
+
+int DirIndex_fill(DirIndex_T oIndex, void **ppvEntries,
+                  size_t ulLength) {
+    DynArray_T oDEntries;
+    struct DirIndexSlot *psSlots;
+    struct DirIndexChild *psLevel;
+    struct DirIndexBranch *psBranch;
+    const char *pcName;
+    size_t ulCapacity;
+    size_t ulLeaves, ulNodes, ulBranches;
+    size_t i = 0;
+
+    assert(oIndex != NULL);
+    assert(ppvEntries != NULL || ulLength == 0);
+    assert(oIndex->psSlots == NULL);
+    assert(DynArray_getLength(oIndex->oDEntries) == 0);
+
+    /* a narrow index stays a sorted array, made at its final length */
+    if (ulLength < DIRINDEX_HASH_THRESHOLD) {
+        oDEntries = DynArray_newWith(
+                ulLength, Arena_getDynArrayAllocator(oIndex->oArena));
+        if (oDEntries == NULL)
+            return MEMORY_ERROR;
+        for (i = 0; i < ulLength; i++)
+            (void) DynArray_set(oDEntries, i, ppvEntries[i]);
+        DynArray_free(oIndex->oDEntries);
+        oIndex->oDEntries = oDEntries;
+        assert(DirIndex_isValid(oIndex));
+        return SUCCESS;
+    }
+
+    /* a wide one gets a table sized once, at most half full ... */
+    ulCapacity = 4 * DIRINDEX_HASH_THRESHOLD;
+    while (2 * ulLength >= ulCapacity)
+        ulCapacity *= 2;
+    psSlots = Arena_alloc(oIndex->oArena,
+                          ulCapacity * sizeof(struct DirIndexSlot));
+    if (psSlots == NULL)
+        return MEMORY_ERROR;
+
+    /* ... and a B+-tree, all of whose nodes are allocated before any
+       is filled in, so that nothing can fail halfway */
+    ulLeaves = DirIndex_countNodes(ulLength, DIRINDEX_LEAF_MAX);
+    psLevel = Arena_alloc(oIndex->oArena,
+                          ulLeaves * sizeof(struct DirIndexChild));
+    for (i = 0; psLevel != NULL && i < ulLeaves; i++) {
+        psLevel[i].pvNode = Arena_alloc(oIndex->oArena,
+                                        sizeof(struct DirIndexLeaf));
+        if (psLevel[i].pvNode == NULL)
+            break;
+    }
+    ulBranches = 0;
+    for (ulNodes = ulLeaves; ulNodes > 1;
+         ulNodes = DirIndex_countNodes(ulNodes, DIRINDEX_BRANCH_MAX))
+        ulBranches += DirIndex_countNodes(ulNodes, DIRINDEX_BRANCH_MAX);
+    while (psLevel != NULL && i == ulLeaves
+           && oIndex->ulNumSpareBranches < ulBranches) {
+        psBranch = Arena_alloc(oIndex->oArena,
+                               sizeof(struct DirIndexBranch));
+        if (psBranch == NULL)
+            break;
+        psBranch->psNextSpare = oIndex->psSpareBranches;
+        oIndex->psSpareBranches = psBranch;
+        oIndex->ulNumSpareBranches++;
+    }
+    if (psLevel == NULL || i < ulLeaves
+        || oIndex->ulNumSpareBranches < ulBranches) {
+        while (psLevel != NULL && i > 0)
+            Arena_release(oIndex->oArena, psLevel[--i].pvNode,
+                          sizeof(struct DirIndexLeaf));
+        if (psLevel != NULL)
+            Arena_release(oIndex->oArena, psLevel,
+                          ulLeaves * sizeof(struct DirIndexChild));
+        DirIndex_freeTree(oIndex);
+        Arena_release(oIndex->oArena, psSlots,
+                      ulCapacity * sizeof(struct DirIndexSlot));
+        return MEMORY_ERROR;
+    }
+
+    memset(psSlots, 0, ulCapacity * sizeof(struct DirIndexSlot));
+    for (i = 0; i < ulLength; i++) {
+        pcName = oIndex->pfGetName(ppvEntries[i]);
+        DirIndex_place(psSlots, ulCapacity,
+                       DirIndex_hash(pcName, strlen(pcName)),
+                       ppvEntries[i]);
+    }
+    DirIndex_build(oIndex, ppvEntries, ulLength, psLevel, ulLeaves);
+    Arena_release(oIndex->oArena, psLevel,
+                  ulLeaves * sizeof(struct DirIndexChild));
+
+    DynArray_free(oIndex->oDEntries);
+    oIndex->oDEntries = NULL;
+    oIndex->psSlots = psSlots;
+    oIndex->ulCapacity = ulCapacity;
+    oIndex->ulLength = ulLength;
+
+    assert(DirIndex_isValid(oIndex));
+    return SUCCESS;
+}
+
+boolean DirIndex_remove(DirIndex_T oIndex, const void *pvEntry) {
+    const char *pcName;
+    size_t ulNameLength;
+    size_t ulIndex = 0;
+    size_t ulSlot;
+    size_t ulNext;
+    size_t ulHome;
+    boolean bFound;
+
+    assert(oIndex != NULL);
+    assert(pvEntry != NULL);
+    assert(DirIndex_isValid(oIndex));
+
+    pcName = oIndex->pfGetName(pvEntry);
+    ulNameLength = strlen(pcName);
+
+    if (oIndex->psSlots == NULL) {
+        if (!DirIndex_search(oIndex, pcName, ulNameLength, &ulIndex)
+            || DynArray_get(oIndex->oDEntries, ulIndex) != pvEntry)
+            return FALSE;
+        (void) DynArray_removeAt(oIndex->oDEntries, ulIndex);
+        return TRUE;
+    }
+
+    ulSlot = DirIndex_probe(oIndex, pcName, ulNameLength,
+                            DirIndex_hash(pcName, ulNameLength));
+    if (oIndex->psSlots[ulSlot].pvEntry != pvEntry)
+        return FALSE;
+
+    /* close the gap by shifting back each later entry of the probe
+       run that may no longer be reachable from its home slot */
+    ulNext = ulSlot;
+    for (;;) {
+        ulNext = (ulNext + 1) & (oIndex->ulCapacity - 1);
+        if (oIndex->psSlots[ulNext].pvEntry == NULL)
+            break;
+        ulHome = oIndex->psSlots[ulNext].ulHash
+                 & (oIndex->ulCapacity - 1);
+        /* move it unless its home lies cyclically in (ulSlot, ulNext] */
+        if ((ulNext > ulSlot && (ulHome <= ulSlot || ulHome > ulNext))
+            || (ulNext < ulSlot && ulHome <= ulSlot
+                && ulHome > ulNext)) {
+            oIndex->psSlots[ulSlot] = oIndex->psSlots[ulNext];
+            ulSlot = ulNext;
+        }
+    }
+    oIndex->psSlots[ulSlot].pvEntry = NULL;
+
+    bFound = DirIndex_treeRemove(oIndex, pvEntry);
+    assert(bFound);
+    (void) bFound;
+    oIndex->ulLength--;
+
+    assert(DirIndex_isValid(oIndex));
+    return TRUE;
+}
+
+void DirIndex_replace(DirIndex_T oIndex, const void *pvOld,
+                      void *pvNew) {
+    struct DirIndexKey sKey;
+    void *pvNode;
+    struct DirIndexBranch *psBranch;
+    struct DirIndexLeaf *psLeaf;
+    size_t ulLevel;
+    size_t ulIndex = 0;
+    size_t ulSlot;
+    boolean bFound;
+
+    assert(oIndex != NULL);
+    assert(pvOld != NULL);
+    assert(pvNew != NULL);
+    assert(oIndex->pfCompare(pvOld, pvNew) == 0);
+    assert(oIndex->pfIsFile(pvOld) == oIndex->pfIsFile(pvNew));
+
+    sKey.pfGetName = oIndex->pfGetName;
+    sKey.pcName = oIndex->pfGetName(pvOld);
+    sKey.ulLength = strlen(sKey.pcName);
+
+    if (oIndex->psSlots == NULL) {
+        bFound = DirIndex_search(oIndex, sKey.pcName, sKey.ulLength,
+                                 &ulIndex);
+        assert(bFound);
+        assert(DynArray_get(oIndex->oDEntries, ulIndex) == pvOld);
+        (void) bFound;
+        (void) DynArray_set(oIndex->oDEntries, ulIndex, pvNew);
+        return;
+    }
+
+    ulSlot = DirIndex_probe(oIndex, sKey.pcName, sKey.ulLength,
+                            DirIndex_hash(sKey.pcName, sKey.ulLength));
+    assert(oIndex->psSlots[ulSlot].pvEntry == pvOld);
+    oIndex->psSlots[ulSlot].pvEntry = pvNew;
+
+    /* descend to the entry, swapping it wherever a branch records it
+       as the first entry of a child */
+    pvNode = oIndex->pvRoot;
+    for (ulLevel = oIndex->ulHeight; ulLevel > 0; ulLevel--) {
+        psBranch = pvNode;
+        ulSlot = DirIndex_childFor(
+                psBranch,
+                (int (*)(const void *, const void *))
+                        DirIndex_compareKey,
+                &sKey);
+        if (psBranch->asChildren[ulSlot].pvMin == pvOld)
+            psBranch->asChildren[ulSlot].pvMin = pvNew;
+        pvNode = psBranch->asChildren[ulSlot].pvNode;
+    }
+    psLeaf = pvNode;
+    ulSlot = DirIndex_lowerBound(
+            psLeaf,
+            (int (*)(const void *, const void *)) DirIndex_compareKey,
+            &sKey);
+    assert(ulSlot < psLeaf->ulCount);
+    assert(psLeaf->apvEntries[ulSlot] == pvOld);
+    psLeaf->apvEntries[ulSlot] = pvNew;
+
+    assert(DirIndex_isValid(oIndex));
+}
+
+void *DirIndex_getAt(DirIndex_T oIndex, size_t ulIndex) {
+    const void *pvNode;
+    const struct DirIndexBranch *psBranch;
+    size_t ulLevel;
+    size_t i;
+
+    assert(oIndex != NULL);
+
+    if (ulIndex >= DirIndex_getLength(oIndex))
+        return NULL;
+
+    if (oIndex->psSlots == NULL)
+        return DynArray_get(oIndex->oDEntries, ulIndex);
+
+    /* descend by subtree sizes */
+    pvNode = oIndex->pvRoot;
+    for (ulLevel = oIndex->ulHeight; ulLevel > 0; ulLevel--) {
+        psBranch = pvNode;
+        for (i = 0; ulIndex >= psBranch->asChildren[i].ulSize; i++)
+            ulIndex -= psBranch->asChildren[i].ulSize;
+        pvNode = psBranch->asChildren[i].pvNode;
+    }
+    return (void *)
+            ((const struct DirIndexLeaf *) pvNode)->apvEntries[ulIndex];
+}
+
+void *DirIndex_getAtOfType(DirIndex_T oIndex, size_t ulIndex,
+                           boolean bIsFile) {
+    const void *pvNode;
+    const struct DirIndexBranch *psBranch;
+    const struct DirIndexLeaf *psLeaf;
+    const void *pvEntry;
+    size_t ulLevel;
+    size_t ulOfType;
+    size_t i;
+
+    assert(oIndex != NULL);
+
+    /* a sorted array is small: scan it */
+    if (oIndex->psSlots == NULL) {
+        for (i = 0; i < DynArray_getLength(oIndex->oDEntries); i++) {
+            pvEntry = DynArray_get(oIndex->oDEntries, i);
+            if (oIndex->pfIsFile(pvEntry) == bIsFile
+                && ulIndex-- == 0)
+                return (void *) pvEntry;
+        }
+        return NULL;
+    }
+
+    /* descend by subtree counts of the type */
+    pvNode = oIndex->pvRoot;
+    for (ulLevel = oIndex->ulHeight; ulLevel > 0; ulLevel--) {
+        psBranch = pvNode;
+        for (i = 0; i < psBranch->ulCount; i++) {
+            ulOfType = psBranch->asChildren[i].ulFiles;
+            if (!bIsFile)
+                ulOfType = psBranch->asChildren[i].ulSize - ulOfType;
+            if (ulIndex < ulOfType)
+                break;
+            ulIndex -= ulOfType;
+        }
+        if (i == psBranch->ulCount)
+            return NULL;
+        pvNode = psBranch->asChildren[i].pvNode;
+    }
+
+    psLeaf = pvNode;
+    for (i = 0; i < psLeaf->ulCount; i++)
+        if (oIndex->pfIsFile(psLeaf->apvEntries[i]) == bIsFile
+            && ulIndex-- == 0)
+            return (void *) psLeaf->apvEntries[i];
+    return NULL;
+}
+
+void DirIndex_seek(DirIndex_T oIndex, const char *pcName,
+                   size_t ulNameLength, struct DirIndexCursor *psCursor) {
+    struct DirIndexKey sKey;
+    const void *pvNode;
+    const struct DirIndexBranch *psBranch;
+    size_t ulLevel;
+    size_t ulSlot;
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(psCursor != NULL);
+
+    psCursor->pvLeaf = NULL;
+    psCursor->ulSlot = 0;
+    psCursor->ulRank = 0;
+
+    if (oIndex->psSlots == NULL) {
+        if (pcName != NULL)
+            (void) DirIndex_search(oIndex, pcName, ulNameLength,
+                                   &psCursor->ulRank);
+        return;
+    }
+
+    sKey.pfGetName = oIndex->pfGetName;
+    sKey.pcName = pcName;
+    sKey.ulLength = ulNameLength;
+
+    /* descend towards the name, counting the entries passed over */
+    pvNode = oIndex->pvRoot;
+    for (ulLevel = oIndex->ulHeight; ulLevel > 0; ulLevel--) {
+        psBranch = pvNode;
+        ulSlot = 0;
+        if (pcName != NULL)
+            ulSlot = DirIndex_childFor(
+                    psBranch,
+                    (int (*)(const void *, const void *))
+                            DirIndex_compareKey,
+                    &sKey);
+        for (i = 0; i < ulSlot; i++)
+            psCursor->ulRank += psBranch->asChildren[i].ulSize;
+        pvNode = psBranch->asChildren[ulSlot].pvNode;
+    }
+
+    psCursor->pvLeaf = pvNode;
+    if (pcName != NULL)
+        psCursor->ulSlot = DirIndex_lowerBound(
+                pvNode,
+                (int (*)(const void *, const void *)) DirIndex_compareKey,
+                &sKey);
+    psCursor->ulRank += psCursor->ulSlot;
+}
+
+void *DirIndex_next(DirIndex_T oIndex, struct DirIndexCursor *psCursor) {
+    const struct DirIndexLeaf *psLeaf;
+
+    assert(oIndex != NULL);
+    assert(psCursor != NULL);
+
+    if (oIndex->psSlots == NULL) {
+        if (psCursor->ulRank >= DynArray_getLength(oIndex->oDEntries))
+            return NULL;
+        return DynArray_get(oIndex->oDEntries, psCursor->ulRank++);
+    }
+
+    /* follow the leaf links past the end of each leaf */
+    psLeaf = psCursor->pvLeaf;
+    while (psLeaf != NULL && psCursor->ulSlot >= psLeaf->ulCount) {
+        psLeaf = psLeaf->psNext;
+        psCursor->ulSlot = 0;
+    }
+    psCursor->pvLeaf = psLeaf;
+    if (psLeaf == NULL)
+        return NULL;
+
+    psCursor->ulRank++;
+    return (void *) psLeaf->apvEntries[psCursor->ulSlot++];
+}
+
+void DirIndex_map(DirIndex_T oIndex,
+                  void (*pfApply)(void *pvEntry, void *pvExtra),
+                  const void *pvExtra) {
+    size_t i;
+
+    assert(oIndex != NULL);
+    assert(pfApply != NULL);
+
+    if (oIndex->psSlots == NULL) {
+        DynArray_map(oIndex->oDEntries, pfApply, pvExtra);
+        return;
+    }
+
+    for (i = 0; i < oIndex->ulCapacity; i++)
+        if (oIndex->psSlots[i].pvEntry != NULL)
+            (*pfApply)((void *) oIndex->psSlots[i].pvEntry,
+                       (void *) pvExtra);
+}
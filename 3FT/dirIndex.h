@@ -0,0 +1,218 @@
+/*--------------------------------------------------------------------*/
+/* dirIndex.h                                                         */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef DIRINDEX_INCLUDED
+#define DIRINDEX_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "arena.h"
+
+/*
+   A DirIndex_T is the set of entries (children) of one directory,
+   indexed by their names, which are unique within the index. Each
+   entry is either a file or not. A small index keeps its entries in a
+   name-sorted array. Once it grows past a threshold it switches to an
+   open-addressing hash table, so finding an entry by name takes
+   constant expected time however wide the directory, together with a
+   B+-tree that keeps the entries in name order: inserting, removing,
+   ranking and fetching the entry at a position (among all entries or
+   among those of one type) then take logarithmic time, and the tree's
+   linked leaves make scans in name order sequential.
+*/
+typedef struct DirIndex *DirIndex_T;
+
+/*
+   A position in the name order of an index, for scanning its entries
+   with DirIndex_next. Its fields are private to the DirIndex module.
+   A cursor is invalidated by any insertion or removal.
+*/
+struct DirIndexCursor {
+    /* the B+-tree leaf of the position, NULL if past the end */
+    const void *pvLeaf;
+    /* the position within pvLeaf */
+    size_t ulSlot;
+    /* the position within the whole index */
+    size_t ulRank;
+};
+
+/*
+   Returns a new, empty index whose memory is allocated from oArena, or
+   NULL if memory could not be allocated. pfGetName must return the
+   name of an entry, pfCompare must order two entries by name as strcmp
+   would order their names, and pfIsFile must tell whether an entry is
+   a file.
+
+   Precondition:
+   * oArena, pfGetName, pfCompare and pfIsFile cannot be NULL
+*/
+DirIndex_T DirIndex_new(Arena_T oArena,
+                        const char *(*pfGetName)(const void *pvEntry),
+                        int (*pfCompare)(const void *pvEntry1,
+                                         const void *pvEntry2),
+                        boolean (*pfIsFile)(const void *pvEntry));
+
+/*
+   Releases oIndex to its arena. The entries themselves are not freed.
+
+   Precondition:
+   * oIndex cannot be NULL
+*/
+void DirIndex_free(DirIndex_T oIndex);
+
+/*
+   Returns the number of entries in oIndex.
+
+   Precondition:
+   * oIndex cannot be NULL
+*/
+size_t DirIndex_getLength(DirIndex_T oIndex);
+
+/*
+   Returns the entry of oIndex named by the ulNameLength characters at
+   pcName, which need not be '\0'-terminated, or NULL if there is none.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pcName cannot be NULL
+*/
+void *DirIndex_find(DirIndex_T oIndex, const char *pcName,
+                    size_t ulNameLength);
+
+/*
+   Checks whether oIndex has an entry named by the ulNameLength
+   characters at pcName, which need not be '\0'-terminated, and finds
+   its position in name order.
+
+   Returns:
+   * TRUE if the entry exists and stores its position in *pulIndex
+   * FALSE if it does not exist and stores in *pulIndex the position
+           it would have if it were inserted
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pcName cannot be NULL
+   * pulIndex cannot be NULL
+*/
+boolean DirIndex_search(DirIndex_T oIndex, const char *pcName,
+                        size_t ulNameLength, size_t *pulIndex);
+
+/*
+   Inserts pvEntry into oIndex.
+
+   Returns:
+   * SUCCESS if pvEntry is inserted
+   * ALREADY_IN_TREE if oIndex already has an entry with its name
+   * MEMORY_ERROR if memory could not be allocated to complete request,
+                  in which case oIndex is unchanged
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pvEntry cannot be NULL
+*/
+int DirIndex_insert(DirIndex_T oIndex, void *pvEntry);
+
+/*
+   Fills the empty oIndex with the ulLength entries at ppvEntries, which
+   must be in strictly increasing name order, building the whole index
+   at once instead of entry by entry: a wide index gets a hash table
+   sized for all of them and a B+-tree built bottom up, level by level.
+
+   Returns:
+   * SUCCESS if the entries are inserted
+   * MEMORY_ERROR if memory could not be allocated to complete request,
+                  in which case oIndex is unchanged
+
+   Precondition:
+   * oIndex cannot be NULL, and must be empty
+   * ppvEntries cannot be NULL unless ulLength is 0
+*/
+int DirIndex_fill(DirIndex_T oIndex, void **ppvEntries,
+                  size_t ulLength);
+
+/*
+   Removes pvEntry from oIndex.
+
+   Returns TRUE if pvEntry was in oIndex, and FALSE otherwise.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pvEntry cannot be NULL
+*/
+boolean DirIndex_remove(DirIndex_T oIndex, const void *pvEntry);
+
+/*
+   Puts pvNew in place of pvOld in oIndex, in time logarithmic in the
+   length of oIndex. pvNew must have the same name and type as pvOld,
+   so the index keeps its shape and the replacement cannot fail.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pvOld cannot be NULL, and is in oIndex
+   * pvNew cannot be NULL, and has pvOld's name and type
+*/
+void DirIndex_replace(DirIndex_T oIndex, const void *pvOld,
+                      void *pvNew);
+
+/*
+   Returns the entry at position ulIndex of oIndex in name order, or
+   NULL if ulIndex is not less than the number of entries.
+
+   Precondition:
+   * oIndex cannot be NULL
+*/
+void *DirIndex_getAt(DirIndex_T oIndex, size_t ulIndex);
+
+/*
+   Returns the entry at position ulIndex in name order among only the
+   entries of oIndex that are files if bIsFile is TRUE, or only those
+   that are not if bIsFile is FALSE. Returns NULL if there are not
+   that many such entries.
+
+   Precondition:
+   * oIndex cannot be NULL
+*/
+void *DirIndex_getAtOfType(DirIndex_T oIndex, size_t ulIndex,
+                           boolean bIsFile);
+
+/*
+   Sets *psCursor to the position of the first entry of oIndex whose
+   name is not less than the ulNameLength characters at pcName (which
+   need not be '\0'-terminated), or to the first entry of all if pcName
+   is NULL.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * psCursor cannot be NULL
+*/
+void DirIndex_seek(DirIndex_T oIndex, const char *pcName,
+                   size_t ulNameLength, struct DirIndexCursor *psCursor);
+
+/*
+   Returns the entry of oIndex at *psCursor and advances *psCursor to
+   the next entry in name order, or returns NULL if *psCursor is past
+   the last entry.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * psCursor cannot be NULL, and was set by DirIndex_seek on oIndex
+     since oIndex last changed
+*/
+void *DirIndex_next(DirIndex_T oIndex, struct DirIndexCursor *psCursor);
+
+/*
+   Applies function *pfApply to each entry of oIndex, in no particular
+   order, passing pvExtra as an extra argument. *pfApply must not
+   change oIndex.
+
+   Precondition:
+   * oIndex cannot be NULL
+   * pfApply cannot be NULL
+*/
+void DirIndex_map(DirIndex_T oIndex,
+                  void (*pfApply)(void *pvEntry, void *pvExtra),
+                  const void *pvExtra);
+
+#endif
@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* dirLock.c                                                          */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include "dirLock.h"
+
+/*--------------------------------------------------------------------*/
+
+/* A directory lock */
+struct DirLock {
+    /* the lock itself */
+    pthread_rwlock_t sLock;
+};
+
+/*--------------------------------------------------------------------*/
+
+DirLock_T DirLock_new(Arena_T oArena) {
+    DirLock_T oLock;
+
+    assert(oArena != NULL);
+
+    oLock = Arena_alloc(oArena, sizeof(struct DirLock));
+    if (oLock == NULL)
+        return NULL;
+
+    if (pthread_rwlock_init(&oLock->sLock, NULL) != 0) {
+        Arena_release(oArena, oLock, sizeof(struct DirLock));
+        return NULL;
+    }
+
+    return oLock;
+}
+
+void DirLock_free(Arena_T oArena, DirLock_T oLock) {
+    assert(oArena != NULL);
+    assert(oLock != NULL);
+
+    (void) pthread_rwlock_destroy(&oLock->sLock);
+    Arena_release(oArena, oLock, sizeof(struct DirLock));
+}
+
+void DirLock_readLock(DirLock_T oLock) {
+    assert(oLock != NULL);
+
+    (void) pthread_rwlock_rdlock(&oLock->sLock);
+}
+
+void DirLock_writeLock(DirLock_T oLock) {
+    assert(oLock != NULL);
+
+    (void) pthread_rwlock_wrlock(&oLock->sLock);
+}
+
+void DirLock_unlock(DirLock_T oLock) {
+    assert(oLock != NULL);
+
+    (void) pthread_rwlock_unlock(&oLock->sLock);
+}
@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------*/
+/* dirLock.h                                                          */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef DIRLOCK_INCLUDED
+#define DIRLOCK_INCLUDED
+
+#include "arena.h"
+
+/*
+   A DirLock_T is a small reader-writer lock guarding one directory of
+   a File Tree: its index of children, and the contents of the files
+   among them. Unlike an RWLock_T, it costs a single block from the
+   tree's arena, so every directory can have one.
+*/
+typedef struct DirLock *DirLock_T;
+
+/*
+   Returns a new, unlocked lock allocated from oArena, or NULL if
+   memory could not be allocated or the lock not initialized.
+
+   Precondition:
+   * oArena cannot be NULL
+*/
+DirLock_T DirLock_new(Arena_T oArena);
+
+/*
+   Destroys oLock, which must be unlocked and waited on by no one, and
+   releases it to oArena.
+
+   Precondition:
+   * oArena cannot be NULL, and is the arena oLock was allocated from
+   * oLock cannot be NULL
+*/
+void DirLock_free(Arena_T oArena, DirLock_T oLock);
+
+/*
+   Locks oLock for reading, waiting for any writer to finish first.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void DirLock_readLock(DirLock_T oLock);
+
+/*
+   Locks oLock for writing, waiting for every reader and any writer to
+   finish first.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void DirLock_writeLock(DirLock_T oLock);
+
+/*
+   Unlocks oLock, which the calling thread holds for reading or for
+   writing.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void DirLock_unlock(DirLock_T oLock);
+
+#endif
@@ -3,35 +3,984 @@
 /* Author: Praneeth Bhandaru                                    */
 /*--------------------------------------------------------------------*/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stddef.h>
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 
-#include "dynarray.h"
 #include "checkerFT.h"
+#include "dirLock.h"
 #include "nodeFT.h"
+#include "pathCache.h"
+#include "pathFilter.h"
+#include "rwLock.h"
 #include "ft.h"
 
 /*--------------------------------------------------------------------*/
 
+/* A path filter vouches for the paths under at most this many moved
+   directories before it must be rebuilt to be of use again */
+enum { FT_MAX_MOVED = 8 };
+
+/*
+   A File Tree is a representation of a hierarchy of directories and
+   files, represented as an object with these fields:
+*/
+struct FT {
+    /* 1. a pointer to the root node in the hierarchy */
+    NodeFT_T oNRoot;
+    /* 2. a counter of the number of nodes in the hierarchy */
+    size_t ulCount;
+    /* 3. the arena from which every node in the hierarchy is
+       allocated */
+    Arena_T oArena;
+    /* 4. whether the FT keeps a path filter */
+    boolean bFilterEnabled;
+    /* 5. a Bloom filter holding the path of every node in the
+       hierarchy (and of some removed ones), or NULL if there is none */
+    PathFilter_T oPFilter;
+    /* 6. the number of nodes removed since oPFilter was built */
+    size_t ulFilterStale;
+    /* 7. whether the FT may be used by several threads at once */
+    boolean bConcurrent;
+    /* 8. the lock guarding the FT, whose slots each hold a struct
+       FTReader; it has just one slot, and is never taken, unless
+       bConcurrent */
+    RWLock_T oLock;
+    /* 9. whether each directory has a lock of its own, which every
+       walk down the hierarchy takes hand over hand; if so, changes
+       below the root hold oLock only for reading */
+    boolean bLockDirs;
+    /* 10. the most nodes of removed subtrees that a write frees
+       before it returns, or 0 if it frees them all */
+    size_t ulReclaimBudget;
+    /* 11. the subtrees removed from the hierarchy but not yet freed,
+       as a list of NodeFT_retire */
+    NodeFT_T oNRetired;
+    /* 12. the hashes of the paths of the ulNumMoved directories moved
+       since oPFilter was built, whose subtrees' new paths it lacks;
+       ulNumMoved exceeds FT_MAX_MOVED once there are too many to
+       list, so that oPFilter vouches for no path until the write
+       that moved the last is done and rebuilds it */
+    unsigned long aulMoved[FT_MAX_MOVED];
+    size_t ulNumMoved;
+    /* 13. the FT this is a snapshot of, or NULL if this is an FT of
+       its own, which may be changed; a snapshot shares its owner's
+       arena and nodes, and holds a reference to its root */
+    FT_T oFTOwner;
+    /* 14. the number of snapshots of this FT not yet freed */
+    size_t ulNumSnapshots;
+};
+
+/*
+   A lookup in an FT updates state of its own: a cache and counters.
+   So that concurrent readers never write to the same memory, each
+   slot of the FT's lock holds a copy of that state with these fields:
+*/
+struct FTReader {
+    /* 1. a cache from recently found absolute paths to their nodes */
+    PathCache_T oPCache;
+    /* 2. the number of lookups the path filter turned away, and of
+       those it let through that found nothing anyway */
+    size_t ulFilterRejected;
+    size_t ulFilterFalsePositives;
+    /* 3. the number of nodes this reader's changes added to and
+       removed from the hierarchy, not yet counted in the FT's ulCount:
+       a fine-grained FT's changes count here, as they may run several
+       at once */
+    size_t ulAdded;
+    size_t ulRemoved;
+};
+
+/*
+   The global interface works on a default FT, with 4 state variables:
+*/
+
+/* 1. the default FT, NULL unless in an initialized state */
+static FT_T oFTDefault;
+/* 2. the capacity of the path cache of the next default FT */
+static size_t ulCacheCapacity = FT_DEFAULT_CACHE_CAPACITY;
+/* 3. whether the next default FT keeps a path filter */
+static boolean bFilterEnabled = TRUE;
+/* 4. the reclaim budget of the next default FT */
+static size_t ulReclaimBudget = 0;
+
+/* A path filter is never sized for fewer paths than this */
+enum { FT_MIN_FILTER_PATHS = 64 };
+
+/* A change to a fine-grained FT made holding it only for reading
+   returns this, rather than a status, if it must be made again holding
+   the FT for writing */
+enum { FT_RETRY_EXCLUSIVE = -1 };
+
+/* A bulk load returns this, rather than a status, for a record it
+   cannot load in path order, which must then be inserted */
+enum { FT_OUT_OF_ORDER = -2 };
+
+/* A parallel load splits its records into about this many ranges for
+   each thread, so that threads given small subtrees take more */
+enum { FT_CHUNKS_PER_THREAD = 4 };
+
+/* A serialization hands its output on in pieces of this many bytes,
+   but for the last */
+enum { FT_SERIAL_BUFFER_SIZE = 8192 };
+
+/* A directory a bulk load has made but not yet indexed the children
+   of, with the position of its first child on the load's stack */
+struct FTLoadLevel {
+    NodeFT_T oNDir;
+    size_t ulFirstChild;
+};
+
+/*
+   The state of a bulk load in path order: the chain of directories it
+   has open, from the root down to those of the last record loaded,
+   and a stack of the children made so far for each. The children of
+   each open directory sit on the stack above those of its parent, the
+   last of which it is, so a directory's children are indexed by
+   popping them once it is closed. A parallel load gives each of its
+   ranges of records a loader of its own, whose first directories are
+   the shared ones above the range, which it never closes.
+*/
+struct FTLoader {
+    /* the FT being loaded, and the arena to make nodes in */
+    FT_T oFT;
+    Arena_T oArena;
+    /* the number of open directories never to close */
+    size_t ulBase;
+    /* the open directories, root first: how many there are, and room
+       for how many */
+    struct FTLoadLevel *psLevels;
+    size_t ulDepth;
+    size_t ulLevelsCapacity;
+    /* the stack of children: how many there are, and room for how
+       many */
+    NodeFT_T *poNChildren;
+    size_t ulNumChildren;
+    size_t ulChildrenCapacity;
+    /* the number of nodes the load has made, not yet counted in the
+       FT's ulCount */
+    size_t ulMade;
+};
+
+/* A level of the path of an operation of a batch: where its component
+   ends in the path, and the node there, if the walk got that far */
+struct FTBatchLevel {
+    size_t ulEnd;
+    NodeFT_T oNNode;
+};
+
 /*
-   A Directory Tree is a representation of a hierarchy of directories,
-   represented as an AO with 3 state variables:
+   The state of a batch of operations applied in path order: the path
+   of the last operation, with the chain of nodes from the root down
+   along it as far as it was found, for the next operation to start
+   from, and the subtrees the batch has unlinked, to be freed once it
+   is done.
 */
+struct FTBatch {
+    /* the FT the batch is applied to */
+    FT_T oFT;
+    /* the path of the last operation, and its levels, root first: how
+       many of them are in the chain, and room for how many */
+    const char *pcPath;
+    struct FTBatchLevel *psLevels;
+    size_t ulDepth;
+    size_t ulLevelsCapacity;
+    /* the unlinked subtrees: how many there are, and room for how
+       many */
+    NodeFT_T *poNDetached;
+    size_t ulNumDetached;
+    size_t ulDetachedCapacity;
+};
+
+/*
+   An operation of a batch, with the key it is sorted by: its path with
+   each '/' made '\0', so that comparing keys bytewise, the shorter
+   first where one is a prefix of the other, puts the paths in path
+   order, as no name holds a '\0'.
+*/
+struct FTBatchKey {
+    const struct FTOp *psOp;
+    char *pcKey;
+    size_t ulLength;
+};
+
+/* A directory an iteration is yielding the children of: where it is
+   among them, whether it is still on the files, and the length of the
+   directory's path */
+struct FTIterLevel {
+    NodeFT_T oNDir;
+    struct DirIndexCursor sCursor;
+    boolean bFiles;
+    size_t ulPathLength;
+};
+
+/*
+   The state of a pre-order iteration over a subtree: the directories
+   open, the subtree's root first, and the path of the node last
+   yielded, which those open share a prefix of. Before the first step
+   the subtree's root is still to be yielded; the directory last
+   yielded is opened only on the step after, so it can be skipped.
+*/
+struct FTIter {
+    /* the FT iterated over, and how it was locked, if the iteration
+       is a client's */
+    FT_T oFT;
+    struct FTReader *psReader;
+    NodeFT_T oNStart;
+    NodeFT_T oNToOpen;
+    struct FTIterLevel *psLevels;
+    size_t ulDepth;
+    size_t ulLevelsCapacity;
+    char *pcPath;
+    size_t ulPathLength;
+    size_t ulPathCapacity;
+    /* SUCCESS, or MEMORY_ERROR once a step could not allocate */
+    int iStatus;
+};
 
-/* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
-static boolean bIsInitialized;
-/* 2. a pointer to the root node in the hierarchy */
-static NodeFT_T oNRoot;
-/* 3. a counter of the number of nodes in the hierarchy */
-static size_t ulCount;
+/*
+   The state of a serialization: the function to hand the output to,
+   its pieces so far, and the iteration over the nodes to print.
+*/
+struct FTSerializer {
+    int (*pfWrite)(void *pvExtra, const char *pcData, size_t ulLength);
+    void *pvExtra;
+    char acBuffer[FT_SERIAL_BUFFER_SIZE];
+    size_t ulBuffered;
+    struct FTIter sIter;
+};
+
+/* What FT_toStringIn's measuring and copying passes hand output to:
+   the string being built, or NULL while measuring, and its length */
+struct FTString {
+    char *pcResult;
+    size_t ulLength;
+};
 
 /*--------------------------------------------------------------------*/
 
 /** Helper Functions **/
 
+/*
+   Locks oFT for reading, if it is concurrent, and returns the reader
+   state the caller may use until it passes it to FT_unlockRead.
+*/
+static struct FTReader *FT_lockRead(FT_T oFT) {
+    assert(oFT != NULL);
+
+    if (!oFT->bConcurrent)
+        return RWLock_getSlotData(oFT->oLock, 0);
+    return RWLock_readLock(oFT->oLock);
+}
+
+/*
+   Undoes FT_lockRead on oFT, which returned psReader.
+*/
+static void FT_unlockRead(FT_T oFT, struct FTReader *psReader) {
+    assert(oFT != NULL);
+    assert(psReader != NULL);
+
+    if (oFT->bConcurrent)
+        RWLock_readUnlock(oFT->oLock, psReader);
+}
+
+/*
+   Counts into the ulCount of oFT, which the caller holds for writing,
+   the nodes its readers have added and removed.
+*/
+static void FT_foldCounts(FT_T oFT) {
+    struct FTReader *psReader;
+    size_t i;
+
+    assert(oFT != NULL);
+
+    for (i = 0; i < RWLock_getNumSlots(oFT->oLock); i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        oFT->ulCount += psReader->ulAdded;
+        oFT->ulCount -= psReader->ulRemoved;
+        psReader->ulAdded = 0;
+        psReader->ulRemoved = 0;
+    }
+}
+
+/*
+   Locks oFT for writing, if it is concurrent, and returns the reader
+   state of its first slot for the writer's own lookups. Until it calls
+   FT_unlockWrite, the caller may also touch every other reader state.
+*/
+static struct FTReader *FT_lockWrite(FT_T oFT) {
+    assert(oFT != NULL);
+
+    if (oFT->bConcurrent)
+        RWLock_writeLock(oFT->oLock);
+    FT_foldCounts(oFT);
+    return RWLock_getSlotData(oFT->oLock, 0);
+}
+
+/*
+   Lets readers back into oFT, which the caller holds for writing, if
+   it is concurrent, as by RWLock_writeShare.
+*/
+static void FT_shareWrite(FT_T oFT) {
+    assert(oFT != NULL);
+
+    if (oFT->bConcurrent)
+        RWLock_writeShare(oFT->oLock);
+}
+
+/*
+   Undoes FT_shareWrite on oFT.
+*/
+static void FT_excludeWrite(FT_T oFT) {
+    assert(oFT != NULL);
+
+    if (oFT->bConcurrent)
+        RWLock_writeExclude(oFT->oLock);
+    FT_foldCounts(oFT);
+}
+
+/*
+   Locks the children of directory oNDir of oFT, for writing if
+   bExclusive and for reading otherwise, if oFT locks its directories.
+*/
+static void FT_lockDir(FT_T oFT, NodeFT_T oNDir, boolean bExclusive) {
+    assert(oFT != NULL);
+    assert(oNDir != NULL);
+
+    if (!oFT->bLockDirs)
+        return;
+    if (bExclusive)
+        DirLock_writeLock(NodeFT_getLock(oNDir));
+    else
+        DirLock_readLock(NodeFT_getLock(oNDir));
+}
+
+/*
+   Undoes FT_lockDir on oNDir of oFT, unless oNDir is NULL.
+*/
+static void FT_unlockDir(FT_T oFT, NodeFT_T oNDir) {
+    assert(oFT != NULL);
+
+    if (oFT->bLockDirs && oNDir != NULL)
+        DirLock_unlock(NodeFT_getLock(oNDir));
+}
+
+/*
+   Makes a node for oFT in oArena as NodeFT_new does, and gives it a
+   lock if it is a directory and oFT locks its directories. Returns as
+   NodeFT_new does.
+*/
+static int FT_makeNode(FT_T oFT, Arena_T oArena, NodeFT_T oNParent,
+                       const char *pcName, size_t ulNameLength,
+                       void *pvContents, size_t ulLength,
+                       boolean bIsFile, NodeFT_T *poNResult) {
+    DirLock_T oLock;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(oArena != NULL);
+    assert(poNResult != NULL);
+
+    iStatus = NodeFT_new(oArena, oNParent, pcName, ulNameLength,
+                         pvContents, ulLength, bIsFile, poNResult);
+    if (iStatus != SUCCESS || bIsFile || !oFT->bLockDirs)
+        return iStatus;
+
+    oLock = DirLock_new(oArena);
+    if (oLock == NULL) {
+        (void) NodeFT_free(oArena, *poNResult);
+        *poNResult = NULL;
+        return MEMORY_ERROR;
+    }
+    NodeFT_setLock(*poNResult, oLock);
+    return SUCCESS;
+}
+
+/*
+   Makes a node in the arena of oFT as FT_makeNode does.
+*/
+static int FT_newNode(FT_T oFT, NodeFT_T oNParent, const char *pcName,
+                      size_t ulNameLength, void *pvContents,
+                      size_t ulLength, boolean bIsFile,
+                      NodeFT_T *poNResult) {
+    assert(oFT != NULL);
+
+    return FT_makeNode(oFT, oFT->oArena, oNParent, pcName, ulNameLength,
+                       pvContents, ulLength, bIsFile, poNResult);
+}
+
+/*
+   Makes the nodes for levels ulFrom onwards of oPPath, each named by
+   the component at its level: directories, but for a file with
+   contents pvContents of ulLength bytes at the last level if bIsFile.
+   They are made deepest first, each linked into the one above as soon
+   as that is made, so that no count is carried up more than one level
+   until the chain is done; only then is its top linked under oNParent,
+   unless that is NULL, and set in *poNTop, and its deepest node in
+   *poNBottom unless that is NULL. So the chain takes time linear in
+   its length plus the depth of oNParent, and other threads see all of
+   it or none.
+
+   Returns SUCCESS, or the status of the first failure, having freed
+   every node made.
+*/
+static int FT_makeChain(FT_T oFT, NodeFT_T oNParent, Path_T oPPath,
+                        size_t ulFrom, boolean bIsFile,
+                        void *pvContents, size_t ulLength,
+                        NodeFT_T *poNTop, NodeFT_T *poNBottom) {
+    NodeFT_T oNBelow = NULL;
+    NodeFT_T oNNew;
+    const char *pcName;
+    size_t ulNameLength;
+    size_t ulIndex;
+    int iStatus = SUCCESS;
+
+    assert(oFT != NULL);
+    assert(oPPath != NULL);
+    assert(ulFrom < Path_getDepth(oPPath));
+    assert(poNTop != NULL);
+
+    for (ulIndex = Path_getDepth(oPPath); ulIndex > ulFrom; ) {
+        ulIndex--;
+        pcName = Path_getComponentSpan(oPPath, ulIndex, &ulNameLength);
+        if (oNBelow == NULL && bIsFile)
+            iStatus = FT_newNode(oFT, NULL, pcName, ulNameLength,
+                                 pvContents, ulLength, TRUE, &oNNew);
+        else
+            iStatus = FT_newNode(oFT, NULL, pcName, ulNameLength,
+                                 NULL, 0, FALSE, &oNNew);
+        if (iStatus != SUCCESS)
+            break;
+        if (oNBelow != NULL
+            && (iStatus = NodeFT_link(oNNew, oNBelow)) != SUCCESS) {
+            (void) NodeFT_free(oFT->oArena, oNNew);
+            break;
+        }
+        if (oNBelow == NULL && poNBottom != NULL)
+            *poNBottom = oNNew;
+        oNBelow = oNNew;
+    }
+
+    if (iStatus == SUCCESS && oNParent != NULL)
+        iStatus = NodeFT_link(oNParent, oNBelow);
+    if (iStatus != SUCCESS) {
+        if (oNBelow != NULL)
+            (void) NodeFT_free(oFT->oArena, oNBelow);
+        *poNTop = NULL;
+        return iStatus;
+    }
+
+    *poNTop = oNBelow;
+    return SUCCESS;
+}
+
+/*
+   Waits out every walk still inside the subtree of directory oNDir of
+   oFT, which the caller has unlinked from its parent and holds locked
+   for writing: locks each directory below for writing in turn, top
+   down as walks go, so that each lock is had only once the walks
+   within it have moved on below, and none can come back. Afterwards
+   no other thread can reach the subtree.
+*/
+static void FT_drainSubtree(FT_T oFT, NodeFT_T oNDir) {
+    struct DirIndexCursor sCursor;
+    NodeFT_T oNNode = oNDir;
+    NodeFT_T oNChild;
+    const char *pcName;
+
+    assert(oFT != NULL);
+    assert(oNDir != NULL);
+
+    /* walk down to each directory and back up its parent links, so a
+       subtree of any depth needs no stack */
+    NodeFT_seekChild(oNNode, NULL, 0, &sCursor);
+    for (;;) {
+        oNChild = NodeFT_nextChild(oNNode, FALSE, &sCursor);
+        if (oNChild != NULL) {
+            FT_lockDir(oFT, oNChild, TRUE);
+            oNNode = oNChild;
+            NodeFT_seekChild(oNNode, NULL, 0, &sCursor);
+            continue;
+        }
+        if (oNNode == oNDir)
+            return;
+
+        /* the parent is still held, so its children are as they were,
+           and the cursor can pick up after oNNode by its name */
+        oNChild = oNNode;
+        oNNode = NodeFT_getParent(oNChild);
+        pcName = NodeFT_getName(oNChild);
+        NodeFT_seekChild(oNNode, pcName, strlen(pcName), &sCursor);
+        FT_unlockDir(oFT, oNChild);
+        (void) NodeFT_nextChild(oNNode, FALSE, &sCursor);
+    }
+}
+
+/*
+   Makes the cache of every reader of oFT forget the path given by the
+   ulLength characters at pcPath, or forget every path if pcPath is
+   NULL. The caller must hold oFT for writing.
+*/
+static void FT_forgetPath(FT_T oFT, const char *pcPath,
+                          size_t ulLength) {
+    struct FTReader *psReader;
+    unsigned long ulHash = 0;
+    size_t i;
+
+    assert(oFT != NULL);
+
+    if (pcPath != NULL)
+        ulHash = PathFilter_hash(pcPath, ulLength);
+    for (i = 0; i < RWLock_getNumSlots(oFT->oLock); i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        if (pcPath == NULL)
+            PathCache_clear(psReader->oPCache);
+        else
+            PathCache_remove(psReader->oPCache, pcPath, ulLength,
+                             ulHash);
+    }
+}
+
+/*
+   Makes *poNNode, a node of oFT, which the caller holds for writing,
+   and its ancestors oFT's alone before a change to *poNNode: copies,
+   from the root down, each of them that a snapshot shares (see
+   NodeFT_unshare), so the snapshots keep the originals, and sets
+   *poNNode to the node now in its place. The caches, which may hold
+   the originals, then forget every path. Takes time proportional to
+   the depth of *poNNode if nothing is shared, as there is nothing to
+   share in a fine-grained FT.
+
+   Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated,
+   leaving the hierarchy as it was, though perhaps with fewer nodes
+   shared.
+*/
+static int FT_own(FT_T oFT, NodeFT_T *poNNode) {
+    NodeFT_T *poNPath;
+    NodeFT_T oNNode;
+    NodeFT_T oNCopy = NULL;
+    size_t ulHeight = 0;
+    size_t ulShared = 0;
+    size_t i;
+    int iStatus = SUCCESS;
+
+    assert(oFT != NULL);
+    assert(oFT->oFTOwner == NULL);
+    assert(poNNode != NULL);
+    assert(*poNNode != NULL);
+
+    if (oFT->bLockDirs)
+        return SUCCESS;
+
+    /* find the highest shared node on the path: it and every node
+       below it must be copied */
+    for (oNNode = *poNNode; oNNode != NULL;
+         oNNode = NodeFT_getParent(oNNode)) {
+        ulHeight++;
+        if (NodeFT_isShared(oNNode))
+            ulShared = ulHeight;
+    }
+    if (ulShared == 0)
+        return SUCCESS;
+
+    poNPath = malloc(ulShared * sizeof(NodeFT_T));
+    if (poNPath == NULL)
+        return MEMORY_ERROR;
+    oNNode = *poNNode;
+    for (i = ulShared; i > 0; i--) {
+        poNPath[i - 1] = oNNode;
+        oNNode = NodeFT_getParent(oNNode);
+    }
+
+    /* each copy shares the children of the node it copies, so the
+       next node down is then shared too */
+    for (i = 0; i < ulShared; i++) {
+        assert(NodeFT_isShared(poNPath[i]));
+        iStatus = NodeFT_unshare(oFT->oArena, poNPath[i], &oNCopy);
+        if (iStatus != SUCCESS)
+            break;
+        if (poNPath[i] == oFT->oNRoot)
+            oFT->oNRoot = oNCopy;
+        poNPath[i] = oNCopy;
+    }
+    FT_forgetPath(oFT, NULL, 0);
+
+    if (iStatus == SUCCESS)
+        *poNNode = poNPath[ulShared - 1];
+    free(poNPath);
+    return iStatus;
+}
+
+/*
+   Returns the array pvArray, of *pulCapacity elements of ulSize bytes
+   each, or a copy with its capacity doubled as often as needed to hold
+   ulNeeded, updating *pulCapacity. Returns NULL, leaving pvArray as it
+   was, if memory could not be allocated.
+*/
+static void *FT_grow(void *pvArray, size_t *pulCapacity, size_t ulSize,
+                     size_t ulNeeded) {
+    size_t ulCapacity;
+
+    assert(pulCapacity != NULL);
+
+    if (ulNeeded <= *pulCapacity)
+        return pvArray;
+
+    ulCapacity = (*pulCapacity == 0) ? 16 : *pulCapacity;
+    while (ulCapacity < ulNeeded)
+        ulCapacity *= 2;
+    pvArray = realloc(pvArray, ulCapacity * ulSize);
+    if (pvArray != NULL)
+        *pulCapacity = ulCapacity;
+    return pvArray;
+}
+
+/*
+   A directory open in FT_filterSubtree: the node, the hash of its path
+   with a '/' appended, and where it is in its DIRECTORY children.
+*/
+struct FTFilterLevel {
+    NodeFT_T oNDir;
+    unsigned long ulHash;
+    struct DirIndexCursor sCursor;
+};
+
+/*
+   Adds to oPFilter the path of oNNode, whose hash is ulHash, and the
+   paths of all of oNNode's descendants. Keeps the directories it is
+   within on a stack of its own, so a subtree of any depth fits.
+   Returns SUCCESS, or MEMORY_ERROR if memory could not be allocated
+   for that stack.
+*/
+static int FT_filterSubtree(PathFilter_T oPFilter, NodeFT_T oNNode,
+                            unsigned long ulHash) {
+    struct FTFilterLevel *psLevels = NULL;
+    struct FTFilterLevel *psGrown;
+    struct FTFilterLevel *psLevel;
+    size_t ulCapacity = 0;
+    size_t ulDepth = 0;
+    NodeFT_T oNChild;
+    const char *pcName;
+
+    assert(oPFilter != NULL);
+    assert(oNNode != NULL);
+
+    for (;;) {
+        PathFilter_add(oPFilter, ulHash);
+        if (!NodeFT_isFile(oNNode)) {
+            psGrown = FT_grow(psLevels, &ulCapacity,
+                              sizeof(struct FTFilterLevel),
+                              ulDepth + 1);
+            if (psGrown == NULL) {
+                free(psLevels);
+                return MEMORY_ERROR;
+            }
+            psLevels = psGrown;
+            psLevel = &psLevels[ulDepth++];
+            psLevel->oNDir = oNNode;
+            psLevel->ulHash = PathFilter_extendHash(ulHash, "/", 1);
+
+            /* FILES need no level of their own */
+            NodeFT_seekChild(oNNode, NULL, 0, &psLevel->sCursor);
+            while ((oNChild = NodeFT_nextChild(oNNode, TRUE,
+                                               &psLevel->sCursor))
+                   != NULL) {
+                pcName = NodeFT_getName(oNChild);
+                PathFilter_add(oPFilter,
+                               PathFilter_extendHash(psLevel->ulHash,
+                                                     pcName,
+                                                     strlen(pcName)));
+            }
+            NodeFT_seekChild(oNNode, NULL, 0, &psLevel->sCursor);
+        }
+
+        /* go on to the next DIRECTORY, closing those done */
+        oNNode = NULL;
+        while (ulDepth > 0) {
+            psLevel = &psLevels[ulDepth - 1];
+            oNNode = NodeFT_nextChild(psLevel->oNDir, FALSE,
+                                      &psLevel->sCursor);
+            if (oNNode != NULL)
+                break;
+            ulDepth--;
+        }
+        if (oNNode == NULL)
+            break;
+        pcName = NodeFT_getName(oNNode);
+        ulHash = PathFilter_extendHash(psLevel->ulHash, pcName,
+                                       strlen(pcName));
+    }
+
+    free(psLevels);
+    return SUCCESS;
+}
+
+/*
+   Returns a new path filter built from the hierarchy of oFT and sized
+   for twice its current number of nodes, so it can grow that far
+   before it must be rebuilt again, or NULL if filtering is turned off
+   or memory could not be allocated. Only reads oFT.
+*/
+static PathFilter_T FT_buildFilter(FT_T oFT) {
+    PathFilter_T oPFilter;
+    size_t ulPaths;
+    const char *pcName;
+
+    assert(oFT != NULL);
+
+    if (!oFT->bFilterEnabled)
+        return NULL;
+
+    ulPaths = 2 * oFT->ulCount;
+    if (ulPaths < FT_MIN_FILTER_PATHS)
+        ulPaths = FT_MIN_FILTER_PATHS;
+    oPFilter = PathFilter_new(ulPaths);
+    if (oPFilter != NULL && oFT->oNRoot != NULL) {
+        pcName = NodeFT_getName(oFT->oNRoot);
+        if (FT_filterSubtree(oPFilter, oFT->oNRoot,
+                             PathFilter_hash(pcName, strlen(pcName)))
+            != SUCCESS) {
+            PathFilter_free(oPFilter);
+            return NULL;
+        }
+    }
+    return oPFilter;
+}
+
+/*
+   Replaces the path filter of oFT with oPFilter, which may be NULL for
+   none, as built by FT_buildFilter from its current hierarchy.
+*/
+static void FT_installFilter(FT_T oFT, PathFilter_T oPFilter) {
+    assert(oFT != NULL);
+
+    if (oFT->oPFilter != NULL)
+        PathFilter_free(oFT->oPFilter);
+    oFT->oPFilter = oPFilter;
+    oFT->ulFilterStale = 0;
+    oFT->ulNumMoved = 0;
+}
+
+/*
+   Returns TRUE if the path given by the ulLength characters at pcPath
+   may lie beneath a directory of oFT moved since its path filter was
+   built, so that the filter cannot vouch for it. Takes time linear in
+   ulLength plus the number of moves times the depth of the path.
+*/
+static boolean FT_isUnderMove(FT_T oFT, const char *pcPath,
+                              size_t ulLength) {
+    unsigned long ulHash;
+    size_t ulHashed = 0;
+    size_t i, j;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    if (oFT->ulNumMoved == 0)
+        return FALSE;
+    if (oFT->ulNumMoved > FT_MAX_MOVED)
+        return TRUE;
+
+    /* hash each proper prefix of pcPath ending at a separator */
+    ulHash = PathFilter_hash(pcPath, 0);
+    for (i = 0; i < ulLength; i++) {
+        if (pcPath[i] != '/')
+            continue;
+        ulHash = PathFilter_extendHash(ulHash, pcPath + ulHashed,
+                                       i - ulHashed);
+        ulHashed = i;
+        for (j = 0; j < oFT->ulNumMoved; j++)
+            if (oFT->aulMoved[j] == ulHash)
+                return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+   Returns TRUE if the path filter of oFT should be rebuilt: if it has
+   been filled past the number of paths it was sized for, if more of
+   the paths it holds have been removed than remain, if too many
+   directories have been moved to list, or if there is none but there
+   should be. Each rebuild costs time linear in the size of the
+   hierarchy, which the insertions, removals, or moves since the
+   previous one pay for.
+*/
+static boolean FT_isFilterDue(FT_T oFT) {
+    assert(oFT != NULL);
+
+    if (!oFT->bFilterEnabled)
+        return FALSE;
+
+    return (boolean) (oFT->oPFilter == NULL
+                      || PathFilter_getLength(oFT->oPFilter)
+                         > PathFilter_getCapacity(oFT->oPFilter)
+                      || (oFT->ulFilterStale > oFT->ulCount
+                          && oFT->ulFilterStale > FT_MIN_FILTER_PATHS)
+                      || oFT->ulNumMoved > FT_MAX_MOVED);
+}
+
+/*
+   Counts the ulNumDetached subtrees at poNDetached, which a write to
+   oFT, held for writing, unlinked, out of oFT by their subtree sizes,
+   and retires them, in constant time each, for FT_unlockWrite to free
+   a reclaim budget at a time, or all at once with no budget, with
+   readers let back in: the subtrees are out of every reader's reach
+   once the lock has shut them all out. Nodes a snapshot shares are
+   left to it.
+
+   A fine-grained FT keeps no subtree sizes, nor has snapshots, so its
+   subtrees are freed here, again with readers let back in, and
+   counted out by the nodes freed. Readers are shut out again only
+   briefly to publish the counts.
+*/
+static void FT_freeDetached(FT_T oFT, NodeFT_T *poNDetached,
+                            size_t ulNumDetached) {
+    size_t ulNumRemoved = 0;
+    size_t i;
+
+    assert(oFT != NULL);
+    assert(poNDetached != NULL || ulNumDetached == 0);
+
+    if (ulNumDetached == 0)
+        return;
+
+    if (!oFT->bLockDirs) {
+        for (i = 0; i < ulNumDetached; i++) {
+            ulNumRemoved += NodeFT_getSubtreeSize(poNDetached[i]);
+            NodeFT_retire(poNDetached[i], &oFT->oNRetired);
+        }
+        oFT->ulCount -= ulNumRemoved;
+        oFT->ulFilterStale += ulNumRemoved;
+        return;
+    }
+
+    FT_shareWrite(oFT);
+    for (i = 0; i < ulNumDetached; i++)
+        ulNumRemoved += NodeFT_free(oFT->oArena, poNDetached[i]);
+    FT_excludeWrite(oFT);
+    oFT->ulCount -= ulNumRemoved;
+    oFT->ulFilterStale += ulNumRemoved;
+}
+
+/*
+   Undoes FT_lockWrite on oFT, first finishing the write's slow work:
+   freeing oNDetached, a subtree the write unlinked, if it is not NULL,
+   freeing up to the reclaim budget of the nodes retired so far, and
+   rebuilding the path filter if due. All take time linear in the nodes
+   they touch, so they are done with readers let back in: the subtree
+   is freed by FT_freeDetached, and the filter is built aside and
+   swapped in.
+*/
+static void FT_unlockWrite(FT_T oFT, NodeFT_T oNDetached) {
+    PathFilter_T oPNewFilter;
+
+    assert(oFT != NULL);
+
+    if (oNDetached != NULL)
+        FT_freeDetached(oFT, &oNDetached, 1);
+
+    if (oFT->oNRetired != NULL) {
+        FT_shareWrite(oFT);
+        (void) NodeFT_freeRetired(oFT->oArena, &oFT->oNRetired,
+                                  oFT->ulReclaimBudget == 0
+                                  ? (size_t) -1
+                                  : oFT->ulReclaimBudget);
+        FT_excludeWrite(oFT);
+    }
+
+    if (FT_isFilterDue(oFT)) {
+        FT_shareWrite(oFT);
+        oPNewFilter = FT_buildFilter(oFT);
+        FT_excludeWrite(oFT);
+        FT_installFilter(oFT, oPNewFilter);
+    }
+
+    /* a snapshot's parent links are its owner's */
+    assert(oFT->oFTOwner != NULL
+           || CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+    if (oFT->bConcurrent)
+        RWLock_writeUnlock(oFT->oLock);
+}
+
+/*
+   Adds to the path filter of oFT, if there is one, the path of the
+   node just made for level ulLevel of oPPath. *pulHash holds the hash
+   of the first *pulHashed characters of oPPath's pathname, and is
+   carried from each level to the next, so that a run of new nodes
+   costs time linear in the length of oPPath.
+*/
+static void FT_filterNewNode(FT_T oFT, Path_T oPPath,
+                             size_t ulLevel, unsigned long *pulHash,
+                             size_t *pulHashed) {
+    const char *pcPathname;
+    const char *pcName;
+    size_t ulNameLength = 0;
+    size_t ulEnd;
+
+    assert(oFT != NULL);
+    assert(oPPath != NULL);
+    assert(pulHash != NULL);
+    assert(pulHashed != NULL);
+
+    if (oFT->oPFilter == NULL)
+        return;
+
+    pcPathname = Path_getPathname(oPPath);
+    pcName = Path_getComponentSpan(oPPath, ulLevel, &ulNameLength);
+    ulEnd = (size_t) (pcName - pcPathname) + ulNameLength;
+    *pulHash = PathFilter_extendHash(*pulHash, pcPathname + *pulHashed,
+                                     ulEnd - *pulHashed);
+    *pulHashed = ulEnd;
+    PathFilter_add(oFT->oPFilter, *pulHash);
+}
+
+/*
+   Compares the name of oNNode with the ulNameLength characters at
+   pcName, which need not be '\0'-terminated, returning <0, 0 or >0 as
+   strcmp would.
+*/
+static int FT_compareName(NodeFT_T oNNode, const char *pcName,
+                          size_t ulNameLength) {
+    const char *pcNodeName;
+    int iResult;
+
+    assert(oNNode != NULL);
+    assert(pcName != NULL);
+
+    pcNodeName = NodeFT_getName(oNNode);
+    iResult = strncmp(pcNodeName, pcName, ulNameLength);
+    if (iResult != 0)
+        return iResult;
+    return (pcNodeName[ulNameLength] != '\0');
+}
+
+/*
+   Returns TRUE if the root of oFT exists and its path is the first
+   component of oPPath, and FALSE otherwise.
+*/
+static boolean FT_isUnderRoot(FT_T oFT, Path_T oPPath) {
+    const char *pcComponent;
+    size_t ulComponentLength = 0;
+
+    assert(oFT != NULL);
+    assert(oPPath != NULL);
+
+    if (oFT->oNRoot == NULL)
+        return FALSE;
+
+    /* the root's path is its name */
+    pcComponent = Path_getComponentSpan(oPPath, 0, &ulComponentLength);
+    return (boolean) (FT_compareName(oFT->oNRoot, pcComponent,
+                                     ulComponentLength) == 0);
+}
+
 /*
    The FT_traversePath and FT_findNode functions modularize the common
    functionality of going as far as possible down an FT towards a path
@@ -40,132 +989,217 @@ static size_t ulCount;
 */
 
 /*
-   Traverses the FT starting at the root as far as possible towards
+   Traverses oFT starting at the root as far as possible towards
    absolute path oPPath. If able to traverse, returns an int SUCCESS
-   status and sets *poNFurthest to the furthest node reached (which may
-   be only a prefix of oPPath, or even NULL if the root is NULL).
-
-   Otherwise, sets *poNFurthest to NULL and returns with status:
+   status, sets *poNFurthest to the furthest node reached (which may
+   be only a prefix of oPPath, or even NULL if the root is NULL) and
+   sets *pulFurthestDepth to that node's depth (0 if it is NULL).
+
+   Each level is resolved by matching oPPath's component at that level
+   against the names of the current node's children in place, so the
+   walk performs no heap allocation, and by a single search whether
+   the child there is a file or a directory.
+
+   If oFT locks its directories, the walk couples their locks: it
+   locks each directory before searching it, for writing if its depth
+   is at least ulExclusiveFrom and for reading otherwise, and only then
+   releases the directory above. It returns still holding the last
+   directory it searched, and sets *poNLocked to that directory (or to
+   NULL if it searched none), which the caller must pass to
+   FT_unlockDir once done with what the walk found.
+
+   Otherwise, sets *poNFurthest and *poNLocked to NULL,
+   *pulFurthestDepth to 0 and returns with status:
    * CONFLICTING_PATH if the root's path is not a prefix of oPPath
-   * MEMORY_ERROR if memory could not be allocated to complete request
 
    Precondition:
+   * oFT cannot be NULL
    * oPPath cannot be NULL
    * poNFurthest cannot be NULL
+   * pulFurthestDepth cannot be NULL
+   * poNLocked cannot be NULL
 */
-static int FT_traversePath(Path_T oPPath, NodeFT_T *poNFurthest) {
-    int iStatus;
-    Path_T oPPrefix = NULL;
+static int FT_traversePath(FT_T oFT, Path_T oPPath,
+                           size_t ulExclusiveFrom,
+                           NodeFT_T *poNFurthest,
+                           size_t *pulFurthestDepth,
+                           NodeFT_T *poNLocked) {
     NodeFT_T oNCurr;
     NodeFT_T oNChild = NULL;
+    const char *pcComponent;
+    size_t ulComponentLength = 0;
     size_t ulDepth;
     size_t i;
-    size_t ulChildID = 0;
 
+    assert(oFT != NULL);
     assert(oPPath != NULL);
     assert(poNFurthest != NULL);
+    assert(pulFurthestDepth != NULL);
+    assert(poNLocked != NULL);
+
+    *pulFurthestDepth = 0;
+    *poNLocked = NULL;
 
     /* root is NULL -> won't find anything */
-    if (oNRoot == NULL) {
+    if (oFT->oNRoot == NULL) {
         *poNFurthest = NULL;
         return SUCCESS;
     }
 
-    iStatus = Path_prefix(oPPath, 1, &oPPrefix);
-    if (iStatus != SUCCESS) {
-        *poNFurthest = NULL;
-        return iStatus;
-    }
-
-    if (Path_comparePath(NodeFT_getPath(oNRoot), oPPrefix)) {
-        Path_free(oPPrefix);
+    if (!FT_isUnderRoot(oFT, oPPath)) {
         *poNFurthest = NULL;
         return CONFLICTING_PATH;
     }
-    Path_free(oPPrefix);
-    oPPrefix = NULL;
 
-    oNCurr = oNRoot;
+    oNCurr = oFT->oNRoot;
     ulDepth = Path_getDepth(oPPath);
-    for (i = 2; i <= ulDepth; i++) {
-        iStatus = Path_prefix(oPPath, i, &oPPrefix);
-        if (iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
+    for (i = 1; i < ulDepth; i++) {
+        /* oNCurr, at depth i, is locked before its parent is let go */
+        FT_lockDir(oFT, oNCurr, (boolean) (i >= ulExclusiveFrom));
+        FT_unlockDir(oFT, *poNLocked);
+        *poNLocked = oNCurr;
+
+        pcComponent = Path_getComponentSpan(oPPath, i,
+                                            &ulComponentLength);
+
+        oNChild = NodeFT_findChild(oNCurr, pcComponent,
+                                   ulComponentLength);
+        if (oNChild == NULL) {
+            /* oNCurr doesn't have child named pcComponent:
+               this is as far as we can go */
+            break;
         }
 
-        if (NodeFT_hasFile(oNCurr, oPPrefix, &ulChildID) == TRUE) {
-            /* go to that child and continue with next prefix */
-            Path_free(oPPrefix);
-            oPPrefix = NULL;
-            iStatus = NodeFT_getChild(oNCurr, ulChildID, TRUE,
-                                      &oNChild);
-            if (iStatus != SUCCESS) {
-                *poNFurthest = NULL;
-                return iStatus;
-            }
-            oNCurr = oNChild;
-            break;
-        } else if (NodeFT_hasDir(oNCurr, oPPrefix, &ulChildID) ==
-                   TRUE) {
-            /* go to that child and continue with next prefix */
-            Path_free(oPPrefix);
-            oPPrefix = NULL;
-            iStatus = NodeFT_getChild(oNCurr, ulChildID, FALSE,
-                                      &oNChild);
-            if (iStatus != SUCCESS) {
-                *poNFurthest = NULL;
-                return iStatus;
-            }
-            oNCurr = oNChild;
-        } else {
-            /* oNCurr doesn't have child with path oPPrefix:
-               this is as far as we can go */
+        /* go to that child and continue with next component */
+        oNCurr = oNChild;
+
+        /* a file ends the walk: nothing can lie beneath it */
+        if (NodeFT_isFile(oNCurr) == TRUE) {
+            i++;
             break;
         }
     }
 
-    Path_free(oPPrefix);
     *poNFurthest = oNCurr;
+    *pulFurthestDepth = i;
     return SUCCESS;
 }
 
 /*
-   Traverses the FT to find a node with absolute path pcPath. Returns an
-   int SUCCESS status and sets *poNResult to be the node, if found.
+   Validates the ulLength characters at pcPath (which need not be
+   '\0'-terminated) as an absolute path and sets *poPPath to a path
+   object for it. The path is normally a view borrowing pcPath and
+   *psView, so it costs no allocation; only paths deeper than
+   PATH_VIEW_MAX_DEPTH fall back to a heap-allocated path. Either way
+   the caller must pass *poPPath to Path_free when done with it.
+
+   Returns SUCCESS, or sets *poPPath to NULL and returns:
+   * BAD_PATH if pcPath does not represent a well-formatted path
+   * MEMORY_ERROR if memory could not be allocated to complete request
+
+   Precondition:
+   * psView, pcPath and poPPath cannot be NULL
+*/
+static int FT_parsePath(struct pathView *psView, const char *pcPath,
+                        size_t ulLength, Path_T *poPPath) {
+    int iStatus;
+
+    assert(psView != NULL);
+    assert(pcPath != NULL);
+    assert(poPPath != NULL);
 
-   Otherwise, sets *poNResult to NULL and returns with status:
-   * INITIALIZATION_ERROR if the FT is not in an initialized state
+    iStatus = Path_initBorrowed(psView, pcPath, ulLength, poPPath);
+    /* too deep for the view: fall back to a heap-allocated path */
+    if (iStatus == MEMORY_ERROR)
+        iStatus = Path_newFromBuffer(pcPath, ulLength, poPPath);
+    return iStatus;
+}
+
+/*
+   Traverses oFT to find a node with absolute path given by the
+   ulLength characters at pcPath, which need not be '\0'-terminated.
+   Returns an int SUCCESS status and sets *poNResult to be the node, if
+   found. A path in the path cache is found with one hash probe; any
+   other is parsed as a borrowed view on the stack, so lookups of paths
+   up to PATH_VIEW_MAX_DEPTH deep allocate nothing, and is then cached.
+   A path the path filter rules out is reported missing without
+   walking the hierarchy. The cache and filter counters are those of
+   psReader. A fine-grained FT has neither cache nor filter: its walks
+   lock as FT_traversePath does, each directory for reading but, if
+   bForWrite, the node's parent for writing, and *poNLocked is set as
+   there for the caller to release. Otherwise *poNLocked holds nothing.
+
+   Otherwise, sets *poNResult and *poNLocked to NULL, leaving nothing
+   locked, and returns with status:
    * BAD_PATH if pcPath does not represent a well-formatted path
    * CONFLICTING_PATH if the root's path is not a prefix of pcPath
    * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
    * MEMORY_ERROR if memory could not be allocated to complete request
 
    Precondition:
+   * oFT cannot be NULL
+   * psReader cannot be NULL
    * pcPath cannot be NULL
    * poNResult cannot be NULL
+   * poNLocked cannot be NULL
 */
-static int FT_findNode(const char *pcPath, NodeFT_T *poNResult) {
+static int FT_findNode(FT_T oFT, struct FTReader *psReader,
+                       const char *pcPath, size_t ulLength,
+                       boolean bForWrite, NodeFT_T *poNResult,
+                       NodeFT_T *poNLocked) {
+    struct pathView sView;
     Path_T oPPath = NULL;
     NodeFT_T oNFound = NULL;
+    size_t ulDepth, ulFoundDepth;
+    boolean bFiltered = FALSE;
+    unsigned long ulHash;
     int iStatus;
 
+    assert(oFT != NULL);
+    assert(psReader != NULL);
     assert(pcPath != NULL);
     assert(poNResult != NULL);
-
-    if (!bIsInitialized) {
-        *poNResult = NULL;
-        return INITIALIZATION_ERROR;
+    assert(poNLocked != NULL);
+
+    *poNLocked = NULL;
+
+    /* only paths that were found are cached, so a hit needs no checks;
+       one hash serves both the cache and the filter */
+    ulHash = PathFilter_hash(pcPath, ulLength);
+    if (!oFT->bLockDirs) {
+        oNFound = PathCache_get(psReader->oPCache, pcPath, ulLength,
+                                ulHash);
+        if (oNFound != NULL) {
+            *poNResult = oNFound;
+            return SUCCESS;
+        }
     }
 
-    iStatus = Path_new(pcPath, &oPPath);
+    iStatus = FT_parsePath(&sView, pcPath, ulLength, &oPPath);
     if (iStatus != SUCCESS) {
         *poNResult = NULL;
         return iStatus;
     }
 
+    /* a path under the root the filter has never seen is not in the
+       FT: skip the walk */
+    if (oFT->oPFilter != NULL && FT_isUnderRoot(oFT, oPPath)) {
+        if (PathFilter_mayContain(oFT->oPFilter, ulHash))
+            bFiltered = TRUE;
+        /* a path the filter cannot vouch for is no false positive */
+        else if (!FT_isUnderMove(oFT, pcPath, ulLength)) {
+            psReader->ulFilterRejected++;
+            Path_free(oPPath);
+            *poNResult = NULL;
+            return NO_SUCH_PATH;
+        }
+    }
+
     /* find the closest ancestor */
-    iStatus = FT_traversePath(oPPath, &oNFound);
+    ulDepth = Path_getDepth(oPPath);
+    iStatus = FT_traversePath(oFT, oPPath,
+                              bForWrite ? ulDepth - 1 : ulDepth,
+                              &oNFound, &ulFoundDepth, poNLocked);
     if (iStatus != SUCCESS) {
         Path_free(oPPath);
         *poNResult = NULL;
@@ -179,489 +1213,3336 @@ static int FT_findNode(const char *pcPath, NodeFT_T *poNResult) {
         return NO_SUCH_PATH;
     }
 
-    /* "closest" ancestor is not the node itself */
-    if (Path_comparePath(NodeFT_getPath(oNFound), oPPath) != 0) {
+    /* "closest" ancestor is not the node itself; every level down to
+       oNFound matched, so comparing depths is enough */
+    if (ulFoundDepth != ulDepth) {
+        if (bFiltered)
+            psReader->ulFilterFalsePositives++;
+        FT_unlockDir(oFT, *poNLocked);
+        *poNLocked = NULL;
         Path_free(oPPath);
         *poNResult = NULL;
         return NO_SUCH_PATH;
     }
 
     Path_free(oPPath);
+    if (!oFT->bLockDirs)
+        PathCache_put(psReader->oPCache, pcPath, ulLength, ulHash,
+                      oNFound);
     *poNResult = oNFound;
     return SUCCESS;
 }
 
 /*--------------------------------------------------------------------*/
 
-int FT_insertDir(const char *pcPath) {
+/*
+   The FT_xxxLocked functions below are the bodies of the FT_xxxIn
+   functions of the same names, which call them holding oFT locked as
+   they need. Those that look paths up do so through psReader.
+   FT_unlockWrite then finishes any slow work they leave behind.
+
+   A change to a fine-grained FT is first made holding the FT only for
+   reading, with bShared TRUE, relying on the locks of its directories
+   instead: it then counts the nodes it adds or removes in psReader,
+   and returns FT_RETRY_EXCLUSIVE if it would make or remove the root.
+*/
+
+static int FT_insertDirLocked(FT_T oFT, struct FTReader *psReader,
+                              const char *pcPath, boolean bShared) {
     int iStatus;
+    struct pathView sView;
     Path_T oPPath = NULL;
     NodeFT_T oNFirstNew = NULL;
     NodeFT_T oNCurr = NULL;
+    NodeFT_T oNLocked = NULL;
     size_t ulDepth, ulIndex;
+    size_t ulExclusiveFrom;
     size_t ulNewNodes = 0;
-    void *pvContents = NULL;
-    boolean bIsFile = FALSE;
+    unsigned long ulHash;
+    size_t ulHashed = 0;
 
+    assert(oFT != NULL);
+    assert(psReader != NULL);
     assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
 
     /* validate pcPath and generate a Path_T for it */
-    if (!bIsInitialized)
-        return INITIALIZATION_ERROR;
-
-    iStatus = Path_new(pcPath, &oPPath);
+    iStatus = FT_parsePath(&sView, pcPath, strlen(pcPath), &oPPath);
     if (iStatus != SUCCESS)
         return iStatus;
 
-    /* find the closest ancestor of oPPath already in the tree */
-    iStatus = FT_traversePath(oPPath, &oNCurr);
+    /* find the closest ancestor of oPPath already in the tree, holding
+       it locked for writing: expect it to be the parent, and walk
+       again locking from its depth if it turns out higher up */
+    ulDepth = Path_getDepth(oPPath);
+    ulExclusiveFrom = ulDepth - 1;
+    for (;;) {
+        iStatus = FT_traversePath(oFT, oPPath, ulExclusiveFrom,
+                                  &oNCurr, &ulIndex, &oNLocked);
+        if (iStatus != SUCCESS) {
+            Path_free(oPPath);
+            return iStatus;
+        }
+        if (oNCurr == NULL || NodeFT_isFile(oNCurr) == TRUE
+            || ulIndex == ulDepth || ulIndex >= ulExclusiveFrom)
+            break;
+        FT_unlockDir(oFT, oNLocked);
+        ulExclusiveFrom = ulIndex;
+    }
+
+    /* no ancestor node found, so if root is not NULL,
+       pcPath isn't underneath root. */
+    if (oNCurr == NULL && oFT->oNRoot != NULL) {
+        Path_free(oPPath);
+        return CONFLICTING_PATH;
+    }
+
+    /* only a writer holding the whole FT may make the root */
+    if (oNCurr == NULL && bShared) {
+        Path_free(oPPath);
+        return FT_RETRY_EXCLUSIVE;
+    }
+
+    /* cannot add something to a file */
+    if (oNCurr != NULL && NodeFT_isFile(oNCurr) == TRUE) {
+        FT_unlockDir(oFT, oNLocked);
+        Path_free(oPPath);
+        return NOT_A_DIRECTORY;
+    }
+
+    /* oNCurr is the node we're trying to insert */
+    if (ulIndex == ulDepth) {
+        FT_unlockDir(oFT, oNLocked);
+        Path_free(oPPath);
+        return ALREADY_IN_TREE;
+    }
+
+    /* starting at oNCurr, made oFT's own, build the rest of the path,
+       then add the path of each new node to the filter */
+    if (oNCurr != NULL)
+        iStatus = FT_own(oFT, &oNCurr);
+    if (iStatus == SUCCESS)
+        iStatus = FT_makeChain(oFT, oNCurr, oPPath, ulIndex, FALSE,
+                               NULL, 0, &oNFirstNew, NULL);
     if (iStatus != SUCCESS) {
+        FT_unlockDir(oFT, oNLocked);
         Path_free(oPPath);
         return iStatus;
     }
+    ulNewNodes = ulDepth - ulIndex;
+    ulHash = PathFilter_hash(Path_getPathname(oPPath), 0);
+    for (; ulIndex < ulDepth; ulIndex++)
+        FT_filterNewNode(oFT, oPPath, ulIndex, &ulHash, &ulHashed);
 
-    /* no ancestor node found, so if root is not NULL,
-       pcPath isn't underneath root. */
-    if (oNCurr == NULL && oNRoot != NULL) {
+    FT_unlockDir(oFT, oNLocked);
+    Path_free(oPPath);
+    /* update FT state variables to reflect insertion */
+    if (oFT->oNRoot == NULL)
+        oFT->oNRoot = oNFirstNew;
+    if (bShared)
+        psReader->ulAdded += ulNewNodes;
+    else
+        oFT->ulCount += ulNewNodes;
+
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
+    return SUCCESS;
+}
+
+static int FT_rmDirLocked(FT_T oFT, struct FTReader *psReader,
+                          const char *pcPath, boolean bShared,
+                          NodeFT_T *poNDetached) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    NodeFT_T oNParent;
+
+    assert(oFT != NULL);
+    assert(psReader != NULL);
+    assert(pcPath != NULL);
+    assert(poNDetached != NULL);
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
+
+    *poNDetached = NULL;
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), TRUE,
+                          &oNFound, &oNLocked);
+
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    if (NodeFT_isFile(oNFound) == TRUE) {
+        FT_unlockDir(oFT, oNLocked);
+        return NOT_A_DIRECTORY;
+    }
+
+    if (bShared) {
+        /* only a writer holding the whole FT may remove the root */
+        if (oNFound == oFT->oNRoot) {
+            FT_unlockDir(oFT, oNLocked);
+            return FT_RETRY_EXCLUSIVE;
+        }
+
+        /* lock the directory as a walk would before unlinking it, then
+           wait out the walks still inside before freeing it */
+        FT_lockDir(oFT, oNFound, TRUE);
+        NodeFT_detach(oNFound);
+        FT_unlockDir(oFT, oNLocked);
+        FT_drainSubtree(oFT, oNFound);
+        FT_unlockDir(oFT, oNFound);
+        psReader->ulRemoved += NodeFT_free(oFT->oArena, oNFound);
+        return SUCCESS;
+    }
+
+    /* the parent loses a child, so make it oFT's own */
+    oNParent = NodeFT_getParent(oNFound);
+    if (oNParent != NULL) {
+        iStatus = FT_own(oFT, &oNParent);
+        if (iStatus != SUCCESS)
+            return iStatus;
+    }
+
+    /* any cached path may lie in the subtree: forget them all */
+    FT_forgetPath(oFT, NULL, 0);
+
+    /* unlink the subtree now; FT_unlockWrite frees it and counts it
+       out of the FT */
+    NodeFT_detach(oNFound);
+    FT_unlockDir(oFT, oNLocked);
+    if (oNFound == oFT->oNRoot)
+        oFT->oNRoot = NULL;
+    *poNDetached = oNFound;
+    return SUCCESS;
+}
+
+static int FT_insertFileLocked(FT_T oFT, struct FTReader *psReader,
+                               const char *pcPath, void *pvContents,
+                               size_t ulLength, boolean bShared) {
+    int iStatus;
+    struct pathView sView;
+    Path_T oPPath = NULL;
+    NodeFT_T oNFirstNew = NULL;
+    NodeFT_T oNCurr = NULL;
+    NodeFT_T oNLocked = NULL;
+    size_t ulDepth, ulIndex;
+    size_t ulExclusiveFrom;
+    size_t ulNewNodes = 0;
+    unsigned long ulHash;
+    size_t ulHashed = 0;
+
+    assert(oFT != NULL);
+    assert(psReader != NULL);
+    assert(pcPath != NULL);
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
+
+    /* validate pcPath and generate a Path_T for it */
+    iStatus = FT_parsePath(&sView, pcPath, strlen(pcPath), &oPPath);
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    /* find the closest ancestor of oPPath already in the tree, holding
+       it locked for writing: expect it to be the parent, and walk
+       again locking from its depth if it turns out higher up */
+    ulDepth = Path_getDepth(oPPath);
+    ulExclusiveFrom = ulDepth - 1;
+    for (;;) {
+        iStatus = FT_traversePath(oFT, oPPath, ulExclusiveFrom,
+                                  &oNCurr, &ulIndex, &oNLocked);
+        if (iStatus != SUCCESS) {
+            Path_free(oPPath);
+            return iStatus;
+        }
+        if (oNCurr == NULL || NodeFT_isFile(oNCurr) == TRUE
+            || ulIndex == ulDepth || ulIndex >= ulExclusiveFrom)
+            break;
+        FT_unlockDir(oFT, oNLocked);
+        ulExclusiveFrom = ulIndex;
+    }
+
+    /* no ancestor node found, and File cannot be root */
+    if (oNCurr == NULL) {
+        Path_free(oPPath);
+        return CONFLICTING_PATH;
+    }
+
+    /* cannot add something to a file */
+    if (oNCurr != NULL && NodeFT_isFile(oNCurr)) {
+        FT_unlockDir(oFT, oNLocked);
         Path_free(oPPath);
+        return NOT_A_DIRECTORY;
+    }
+
+    /* oNCurr is the node we're trying to insert */
+    if (ulIndex == ulDepth) {
+        FT_unlockDir(oFT, oNLocked);
+        Path_free(oPPath);
+        return ALREADY_IN_TREE;
+    }
+
+    /* starting at oNCurr, made oFT's own, build the rest of the path,
+       then add the path of each new node to the filter */
+    iStatus = FT_own(oFT, &oNCurr);
+    if (iStatus == SUCCESS)
+        iStatus = FT_makeChain(oFT, oNCurr, oPPath, ulIndex, TRUE,
+                               pvContents, ulLength, &oNFirstNew,
+                               NULL);
+    if (iStatus != SUCCESS) {
+        FT_unlockDir(oFT, oNLocked);
+        Path_free(oPPath);
+        return iStatus;
+    }
+    ulNewNodes = ulDepth - ulIndex;
+    ulHash = PathFilter_hash(Path_getPathname(oPPath), 0);
+    for (; ulIndex < ulDepth; ulIndex++)
+        FT_filterNewNode(oFT, oPPath, ulIndex, &ulHash, &ulHashed);
+
+    FT_unlockDir(oFT, oNLocked);
+    Path_free(oPPath);
+    /* update FT state variables to reflect insertion */
+    if (oFT->oNRoot == NULL)
+        oFT->oNRoot = oNFirstNew;
+    if (bShared)
+        psReader->ulAdded += ulNewNodes;
+    else
+        oFT->ulCount += ulNewNodes;
+
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
+    return SUCCESS;
+}
+
+static int FT_rmFileLocked(FT_T oFT, struct FTReader *psReader,
+                           const char *pcPath, boolean bShared) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    NodeFT_T oNParent;
+    size_t ulNumRemoved;
+
+    assert(oFT != NULL);
+    assert(psReader != NULL);
+    assert(pcPath != NULL);
+    assert(bShared || CheckerFT_isValid(TRUE, oFT->oNRoot,
+                                        oFT->ulCount));
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), TRUE,
+                          &oNFound, &oNLocked);
+
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    if (NodeFT_isFile(oNFound) == FALSE) {
+        FT_unlockDir(oFT, oNLocked);
+        return NOT_A_FILE;
+    }
+
+    /* a file is only ever reached through its parent, which is locked
+       for writing, so it can go at once */
+    if (bShared) {
+        psReader->ulRemoved += NodeFT_free(oFT->oArena, oNFound);
+        FT_unlockDir(oFT, oNLocked);
+        return SUCCESS;
+    }
+
+    /* the parent loses a child, so make it oFT's own; a snapshot may
+       keep the file, so count it out rather than what is freed */
+    oNParent = NodeFT_getParent(oNFound);
+    iStatus = FT_own(oFT, &oNParent);
+    if (iStatus != SUCCESS)
+        return iStatus;
+    FT_forgetPath(oFT, pcPath, strlen(pcPath));
+    ulNumRemoved = NodeFT_getSubtreeSize(oNFound);
+    (void) NodeFT_free(oFT->oArena, oNFound);
+    FT_unlockDir(oFT, oNLocked);
+    oFT->ulCount -= ulNumRemoved;
+    oFT->ulFilterStale += ulNumRemoved;
+    if (oFT->ulCount == 0)
+        oFT->oNRoot = NULL;
+
+    assert(CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+    return SUCCESS;
+}
+
+static void *FT_getFileContentsLocked(FT_T oFT,
+                                      struct FTReader *psReader,
+                                      const char *pcPath,
+                                      size_t ulLength) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    void *pvContents = NULL;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    /* a concurrent FT's writer may be part-way through a write with
+       readers let in, so only its writers check it, and a snapshot's
+       parent links are its owner's */
+    assert(oFT->bConcurrent || oFT->oFTOwner != NULL
+           || CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, ulLength, FALSE,
+                          &oNFound, &oNLocked);
+    if (iStatus != SUCCESS) {
+        return NULL;
+    }
+
+    pvContents = NodeFT_getContents(oNFound);
+    FT_unlockDir(oFT, oNLocked);
+
+    return pvContents;
+}
+
+static void *FT_replaceFileContentsLocked(FT_T oFT,
+                                          struct FTReader *psReader,
+                                          const char *pcPath,
+                                          void *pvNewContents,
+                                          size_t ulNewLength) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    void *pvContents = NULL;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    /* a fine-grained FT is changed holding it only for reading */
+    assert(oFT->bLockDirs
+           || CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), TRUE,
+                          &oNFound, &oNLocked);
+
+    if (iStatus != SUCCESS) {
+        return NULL;
+    }
+
+    /* a snapshot keeps the contents as they were */
+    if (FT_own(oFT, &oNFound) != SUCCESS) {
+        FT_unlockDir(oFT, oNLocked);
+        return NULL;
+    }
+
+    pvContents = NodeFT_setContents(oNFound, pvNewContents,
+                                    ulNewLength);
+    FT_unlockDir(oFT, oNLocked);
+
+    return pvContents;
+}
+
+/*
+   Moves the node at pcSrc in oFT, which the caller holds for writing,
+   to pcDst, as FT_rename does, and returns as it does. The subtree is
+   relinked whole, and only the directories made for pcDst's missing
+   ancestors are new, so the move takes time proportional to the
+   depths of the two paths.
+*/
+static int FT_renameLocked(FT_T oFT, struct FTReader *psReader,
+                           const char *pcSrc, const char *pcDst) {
+    int iStatus;
+    struct pathView sView;
+    Path_T oPDst = NULL;
+    Path_T oPParent = NULL;
+    NodeFT_T oNSrc = NULL;
+    NodeFT_T oNCurr = NULL;
+    NodeFT_T oNLocked = NULL;
+    NodeFT_T oNFirstNew = NULL;
+    NodeFT_T oNNewParent = NULL;
+    NodeFT_T oNAncestor;
+    const char *pcName;
+    size_t ulNameLength;
+    size_t ulDepth, ulIndex;
+    unsigned long ulHash;
+    size_t ulHashed = 0;
+
+    assert(oFT != NULL);
+    assert(psReader != NULL);
+    assert(pcSrc != NULL);
+    assert(pcDst != NULL);
+    assert(CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+
+    iStatus = FT_parsePath(&sView, pcDst, strlen(pcDst), &oPDst);
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    iStatus = FT_findNode(oFT, psReader, pcSrc, strlen(pcSrc), FALSE,
+                          &oNSrc, &oNLocked);
+    if (iStatus != SUCCESS) {
+        Path_free(oPDst);
+        return iStatus;
+    }
+    /* the FT lock alone keeps other changes out */
+    FT_unlockDir(oFT, oNLocked);
+
+    /* find the closest ancestor of pcDst already in the tree */
+    ulDepth = Path_getDepth(oPDst);
+    iStatus = FT_traversePath(oFT, oPDst, ulDepth, &oNCurr, &ulIndex,
+                              &oNLocked);
+    if (iStatus != SUCCESS) {
+        Path_free(oPDst);
+        return iStatus;
+    }
+    FT_unlockDir(oFT, oNLocked);
+
+    /* the root cannot move anywhere: every other path lies under it */
+    if (oNCurr == NULL || oNSrc == oFT->oNRoot) {
+        Path_free(oPDst);
         return CONFLICTING_PATH;
     }
+    if (NodeFT_isFile(oNCurr) == TRUE) {
+        Path_free(oPDst);
+        return NOT_A_DIRECTORY;
+    }
+    if (ulIndex == ulDepth) {
+        Path_free(oPDst);
+        return ALREADY_IN_TREE;
+    }
+
+    /* nor can a directory move into its own subtree */
+    for (oNAncestor = oNCurr; oNAncestor != NULL;
+         oNAncestor = NodeFT_getParent(oNAncestor)) {
+        if (oNAncestor == oNSrc) {
+            Path_free(oPDst);
+            return CONFLICTING_PATH;
+        }
+    }
+
+    /* both ends of the move change, so make them oFT's own: oNCurr
+       first, as oNSrc's ancestors, which may include it, could be
+       copied from under it, while once it and the nodes above it are
+       unshared, none of them is copied again */
+    iStatus = FT_own(oFT, &oNCurr);
+    if (iStatus == SUCCESS)
+        iStatus = FT_own(oFT, &oNSrc);
+    if (iStatus != SUCCESS) {
+        Path_free(oPDst);
+        return iStatus;
+    }
+
+    /* make pcDst's missing ancestors, as an insertion would */
+    oNNewParent = oNCurr;
+    if (ulIndex + 1 < ulDepth) {
+        iStatus = Path_prefix(oPDst, ulDepth - 1, &oPParent);
+        if (iStatus == SUCCESS) {
+            iStatus = FT_makeChain(oFT, oNCurr, oPParent, ulIndex,
+                                   FALSE, NULL, 0, &oNFirstNew,
+                                   &oNNewParent);
+            Path_free(oPParent);
+        }
+        if (iStatus != SUCCESS) {
+            Path_free(oPDst);
+            return iStatus;
+        }
+    }
+
+    pcName = Path_getComponentSpan(oPDst, ulDepth - 1, &ulNameLength);
+    iStatus = NodeFT_move(oFT->oArena, oNSrc, oNNewParent, pcName,
+                          ulNameLength);
+    if (iStatus != SUCCESS) {
+        if (oNFirstNew != NULL)
+            (void) NodeFT_free(oFT->oArena, oNFirstNew);
+        Path_free(oPDst);
+        return iStatus;
+    }
+
+    /* any cached path may lie in the moved subtree: forget them all */
+    FT_forgetPath(oFT, NULL, 0);
+
+    oFT->ulCount += ulDepth - 1 - ulIndex;
+
+    /* the filter learns the new paths down to pcDst, and, if pcDst is
+       a directory, to vouch for none beneath it; the old paths are
+       stale, as a removal's would be */
+    if (oFT->oPFilter != NULL) {
+        ulHash = PathFilter_hash(Path_getPathname(oPDst), 0);
+        for (; ulIndex < ulDepth; ulIndex++)
+            FT_filterNewNode(oFT, oPDst, ulIndex, &ulHash, &ulHashed);
+        if (NodeFT_isFile(oNSrc) == FALSE) {
+            if (oFT->ulNumMoved < FT_MAX_MOVED)
+                oFT->aulMoved[oFT->ulNumMoved] = ulHash;
+            if (oFT->ulNumMoved <= FT_MAX_MOVED)
+                oFT->ulNumMoved++;
+        }
+        oFT->ulFilterStale += NodeFT_getSubtreeSize(oNSrc);
+    }
+
+    Path_free(oPDst);
+    assert(CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+    return SUCCESS;
+}
+
+static int FT_statLocked(FT_T oFT, struct FTReader *psReader,
+                         const char *pcPath, size_t ulLength,
+                         boolean *pbIsFile, size_t *pulSize) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    assert(pbIsFile != NULL);
+    assert(pulSize != NULL);
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, ulLength, FALSE,
+                          &oNFound, &oNLocked);
+
+    if (iStatus != SUCCESS) {
+        return iStatus;
+    }
+
+    if (NodeFT_isFile(oNFound)) {
+        *pbIsFile = TRUE;
+        *pulSize = NodeFT_getFileSize(oNFound);
+    } else {
+        *pbIsFile = FALSE;
+    }
+    FT_unlockDir(oFT, oNLocked);
+    return SUCCESS;
+}
+
+/*
+  Returns the next FILE child of oNDir from *psCursor whose name is not
+  greater than pcLast (unbounded if pcLast is NULL), or NULL if there
+  is none.
+*/
+static NodeFT_T FT_nextFileInRange(NodeFT_T oNDir, const char *pcLast,
+                                   struct DirIndexCursor *psCursor) {
+    NodeFT_T oNChild;
+
+    assert(oNDir != NULL);
+    assert(psCursor != NULL);
+
+    oNChild = NodeFT_nextChild(oNDir, TRUE, psCursor);
+    if (oNChild != NULL && pcLast != NULL
+        && strcmp(NodeFT_getName(oNChild), pcLast) > 0)
+        return NULL;
+    return oNChild;
+}
+
+static int FT_listFilesLocked(FT_T oFT, struct FTReader *psReader,
+                              const char *pcPath, const char *pcFirst,
+                              const char *pcLast, char **ppcResult) {
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    NodeFT_T oNChild;
+    struct DirIndexCursor sCursor;
+    size_t ulFirstLength = 0;
+    size_t ulPathLength;
+    size_t ulNameLength;
+    size_t ulTotal = 1;
+    char *pcEnd;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    assert(ppcResult != NULL);
+
+    *ppcResult = NULL;
+
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), FALSE,
+                          &oNFound, &oNLocked);
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    if (NodeFT_isFile(oNFound) == TRUE) {
+        FT_unlockDir(oFT, oNLocked);
+        return NOT_A_DIRECTORY;
+    }
+
+    /* the listing reads oNFound's children: couple down to its lock */
+    FT_lockDir(oFT, oNFound, FALSE);
+    FT_unlockDir(oFT, oNLocked);
+
+    if (pcFirst != NULL)
+        ulFirstLength = strlen(pcFirst);
+
+    /* size the listing in one pass, then fill it in a second; each
+       path is pcPath and a name, since parent links lead up the
+       latest version of the hierarchy, which may not be a
+       snapshot's */
+    ulPathLength = strlen(pcPath);
+    NodeFT_seekChild(oNFound, pcFirst, ulFirstLength, &sCursor);
+    while ((oNChild = FT_nextFileInRange(oNFound, pcLast, &sCursor))
+           != NULL)
+        ulTotal += ulPathLength + strlen(NodeFT_getName(oNChild)) + 2;
+
+    *ppcResult = malloc(ulTotal);
+    if (*ppcResult == NULL) {
+        FT_unlockDir(oFT, oNFound);
+        return MEMORY_ERROR;
+    }
+
+    pcEnd = *ppcResult;
+    NodeFT_seekChild(oNFound, pcFirst, ulFirstLength, &sCursor);
+    while ((oNChild = FT_nextFileInRange(oNFound, pcLast, &sCursor))
+           != NULL) {
+        ulNameLength = strlen(NodeFT_getName(oNChild));
+        memcpy(pcEnd, pcPath, ulPathLength);
+        pcEnd += ulPathLength;
+        *pcEnd++ = '/';
+        memcpy(pcEnd, NodeFT_getName(oNChild), ulNameLength);
+        pcEnd += ulNameLength;
+        *pcEnd++ = '\n';
+    }
+    *pcEnd = '\0';
+    FT_unlockDir(oFT, oNFound);
+
+    return SUCCESS;
+}
+
+/*
+   Closes the open directories of bulk load *psLoader below the first
+   ulDepth, deepest first, indexing each one's children. Returns
+   SUCCESS, or MEMORY_ERROR if memory could not be allocated to index
+   the children of some directory, which are then freed instead.
+*/
+static int FT_closeLevels(struct FTLoader *psLoader, size_t ulDepth) {
+    struct FTLoadLevel *psClosed;
+    size_t i;
+    int iStatus = SUCCESS;
+
+    assert(psLoader != NULL);
+    assert(ulDepth >= psLoader->ulBase);
+
+    while (psLoader->ulDepth > ulDepth) {
+        psClosed = &psLoader->psLevels[--psLoader->ulDepth];
+        if (NodeFT_setChildren(psClosed->oNDir,
+                               psLoader->poNChildren
+                               + psClosed->ulFirstChild,
+                               psLoader->ulNumChildren
+                               - psClosed->ulFirstChild) != SUCCESS) {
+            for (i = psClosed->ulFirstChild;
+                 i < psLoader->ulNumChildren; i++)
+                psLoader->ulMade -= NodeFT_free(
+                        psLoader->oArena, psLoader->poNChildren[i]);
+            iStatus = MEMORY_ERROR;
+        }
+        psLoader->ulNumChildren = psClosed->ulFirstChild;
+    }
+    return iStatus;
+}
+
+/*
+   Loads psRecord in path order into the FT of bulk load *psLoader:
+   closes the open directories its path leaves, then makes a node for
+   each component of the path below the directories it shares with
+   the path loaded last, each a child of the one before, and opens
+   those that are directories. The nodes are linked into the FT only
+   as their directories are closed, and counted in it only by the
+   loader's owner.
+
+   Returns SUCCESS, or:
+   * BAD_PATH if the path does not represent a well-formatted path
+   * MEMORY_ERROR if memory could not be allocated to complete request
+   * FT_OUT_OF_ORDER, having made no node, if the path does not come
+     after the path loaded last or is not a new one under the loader's
+     base directories; so for a record that inserting it would turn
+     down, inserting it is left to say why
+*/
+static int FT_loadRecord(struct FTLoader *psLoader,
+                         const struct FTRecord *psRecord) {
+    struct pathView sView;
+    Path_T oPPath = NULL;
+    NodeFT_T oNNew = NULL;
+    struct FTLoadLevel *psOpen;
+    const char *pcName;
+    size_t ulNameLength = 0;
+    size_t ulDepth, ulShared;
+    boolean bIsFile;
+    void *pvGrown;
+    int iStatus;
+
+    assert(psLoader != NULL);
+    assert(psRecord != NULL);
+    assert(psRecord->pcPath != NULL);
+
+    iStatus = FT_parsePath(&sView, psRecord->pcPath,
+                           strlen(psRecord->pcPath), &oPPath);
+    if (iStatus != SUCCESS)
+        return iStatus;
+    ulDepth = Path_getDepth(oPPath);
+
+    /* count the open directories the path goes through */
+    for (ulShared = 0;
+         ulShared < psLoader->ulDepth && ulShared < ulDepth;
+         ulShared++) {
+        pcName = Path_getComponentSpan(oPPath, ulShared, &ulNameLength);
+        if (FT_compareName(psLoader->psLevels[ulShared].oNDir, pcName,
+                           ulNameLength) != 0)
+            break;
+    }
+
+    /* it must go through the root, if there is one, and the base
+       directories, and on to a new node, and a file cannot be the
+       root */
+    if ((psLoader->ulDepth > 0 && ulShared == 0)
+        || ulShared < psLoader->ulBase || ulShared == ulDepth
+        || (psLoader->ulDepth == 0 && psRecord->bIsFile)) {
+        Path_free(oPPath);
+        return FT_OUT_OF_ORDER;
+    }
+
+    iStatus = FT_closeLevels(psLoader, ulShared);
+    if (iStatus != SUCCESS) {
+        Path_free(oPPath);
+        return iStatus;
+    }
+
+    /* and must follow the children of its deepest shared directory */
+    if (ulShared > 0) {
+        psOpen = &psLoader->psLevels[ulShared - 1];
+        pcName = Path_getComponentSpan(oPPath, ulShared, &ulNameLength);
+        if (psLoader->ulNumChildren > psOpen->ulFirstChild
+            && FT_compareName(
+                   psLoader->poNChildren[psLoader->ulNumChildren - 1],
+                   pcName, ulNameLength) >= 0) {
+            Path_free(oPPath);
+            return FT_OUT_OF_ORDER;
+        }
+    }
+
+    for (; ulShared < ulDepth; ulShared++) {
+        /* make room first, so that no node made is ever dropped */
+        pvGrown = FT_grow(psLoader->poNChildren,
+                          &psLoader->ulChildrenCapacity,
+                          sizeof(NodeFT_T),
+                          psLoader->ulNumChildren + 1);
+        if (pvGrown != NULL) {
+            psLoader->poNChildren = pvGrown;
+            pvGrown = FT_grow(psLoader->psLevels,
+                              &psLoader->ulLevelsCapacity,
+                              sizeof(struct FTLoadLevel),
+                              psLoader->ulDepth + 1);
+        }
+        if (pvGrown == NULL) {
+            Path_free(oPPath);
+            return MEMORY_ERROR;
+        }
+        psLoader->psLevels = pvGrown;
+
+        bIsFile = (boolean) (psRecord->bIsFile
+                             && ulShared + 1 == ulDepth);
+        pcName = Path_getComponentSpan(oPPath, ulShared, &ulNameLength);
+        iStatus = FT_makeNode(psLoader->oFT, psLoader->oArena, NULL,
+                              pcName, ulNameLength,
+                              psRecord->pvContents, psRecord->ulLength,
+                              bIsFile, &oNNew);
+        if (iStatus != SUCCESS) {
+            Path_free(oPPath);
+            return iStatus;
+        }
+        psLoader->ulMade++;
+
+        if (ulShared == 0)
+            psLoader->oFT->oNRoot = oNNew;
+        else
+            psLoader->poNChildren[psLoader->ulNumChildren++] = oNNew;
+        if (!bIsFile) {
+            psOpen = &psLoader->psLevels[psLoader->ulDepth++];
+            psOpen->oNDir = oNNew;
+            psOpen->ulFirstChild = psLoader->ulNumChildren;
+        }
+    }
+
+    Path_free(oPPath);
+    return SUCCESS;
+}
+
+/* The records of an array that FT_bulkLoadIn has yet to load */
+struct FTRecordArray {
+    const struct FTRecord *psNext;
+    size_t ulLeft;
+};
+
+/*
+   Fills in *psRecord with the next record of the struct FTRecordArray
+   at pvExtra and returns TRUE, or returns FALSE if there are no more.
+*/
+static boolean FT_nextRecord(void *pvExtra, struct FTRecord *psRecord) {
+    struct FTRecordArray *psArray = pvExtra;
+
+    assert(psArray != NULL);
+    assert(psRecord != NULL);
+
+    if (psArray->ulLeft == 0)
+        return FALSE;
+    *psRecord = *psArray->psNext++;
+    psArray->ulLeft--;
+    return TRUE;
+}
+
+/*
+   Sets up *psLoader as an empty bulk load into oFT, making nodes in
+   oArena.
+*/
+static void FT_initLoader(struct FTLoader *psLoader, FT_T oFT,
+                          Arena_T oArena) {
+    assert(psLoader != NULL);
+    assert(oFT != NULL);
+    assert(oArena != NULL);
+
+    psLoader->oFT = oFT;
+    psLoader->oArena = oArena;
+    psLoader->ulBase = 0;
+    psLoader->psLevels = NULL;
+    psLoader->ulDepth = 0;
+    psLoader->ulLevelsCapacity = 0;
+    psLoader->poNChildren = NULL;
+    psLoader->ulNumChildren = 0;
+    psLoader->ulChildrenCapacity = 0;
+    psLoader->ulMade = 0;
+}
+
+/*
+   Frees the stacks of bulk load *psLoader, which must have no open
+   directories left but its base ones.
+*/
+static void FT_freeLoader(struct FTLoader *psLoader) {
+    assert(psLoader != NULL);
+    assert(psLoader->ulDepth == psLoader->ulBase);
+
+    free(psLoader->psLevels);
+    free(psLoader->poNChildren);
+}
+
+/*
+   Closes every open directory of bulk load *psLoader, so that all it
+   has loaded is linked into its FT, and counts the nodes it made in
+   the FT's ulCount. If it made any, drops the FT's path filter, which
+   they are not in, for FT_unlockWrite to rebuild over the whole
+   hierarchy. Returns as FT_closeLevels does.
+*/
+static int FT_foldLoad(struct FTLoader *psLoader) {
+    int iStatus;
+
+    assert(psLoader != NULL);
+    assert(psLoader->ulBase == 0);
+
+    iStatus = FT_closeLevels(psLoader, 0);
+    if (psLoader->ulMade > 0) {
+        psLoader->oFT->ulCount += psLoader->ulMade;
+        psLoader->ulMade = 0;
+        FT_installFilter(psLoader->oFT, NULL);
+    }
+    return iStatus;
+}
+
+/*
+   Loads the records that *pfNext yields (as for FT_bulkLoadStream)
+   with bulk load *psLoader as long as *pbInOrder, and inserts them
+   one by one from the first record that cannot be loaded in path
+   order on, setting *pbInOrder to FALSE. psReader is the reader state
+   of the caller, which holds the FT for writing. Returns SUCCESS, or
+   the status of the first record that could not be loaded.
+*/
+static int FT_loadRecords(struct FTLoader *psLoader,
+                          struct FTReader *psReader, boolean *pbInOrder,
+                          boolean (*pfNext)(void *pvExtra,
+                                            struct FTRecord *psRecord),
+                          void *pvExtra) {
+    FT_T oFT;
+    struct FTRecord sRecord;
+    int iStatus = SUCCESS;
+
+    assert(psLoader != NULL);
+    assert(psReader != NULL);
+    assert(pbInOrder != NULL);
+    assert(pfNext != NULL);
+
+    oFT = psLoader->oFT;
+    while (iStatus == SUCCESS && (*pfNext)(pvExtra, &sRecord)) {
+        assert(sRecord.pcPath != NULL);
+        if (*pbInOrder) {
+            iStatus = FT_loadRecord(psLoader, &sRecord);
+            if (iStatus != FT_OUT_OF_ORDER)
+                continue;
+            /* link in all that is loaded, and insert from here on */
+            *pbInOrder = FALSE;
+            iStatus = FT_foldLoad(psLoader);
+            if (iStatus != SUCCESS)
+                break;
+        }
+        if (sRecord.bIsFile)
+            iStatus = FT_insertFileLocked(oFT, psReader, sRecord.pcPath,
+                                          sRecord.pvContents,
+                                          sRecord.ulLength, FALSE);
+        else
+            iStatus = FT_insertDirLocked(oFT, psReader, sRecord.pcPath,
+                                         FALSE);
+    }
+    return iStatus;
+}
+
+/*
+   Undoes what bulk load *psLoader has loaded since it had ulDepth
+   directories open and ulNumChildren children on its stack, having
+   closed none of those: frees every child since pushed, each with its
+   subtree, and the root if it was made since, and closes the
+   directories opened since.
+*/
+static void FT_unloadChain(struct FTLoader *psLoader, size_t ulDepth,
+                           size_t ulNumChildren) {
+    FT_T oFT;
+
+    assert(psLoader != NULL);
+    assert(ulDepth <= psLoader->ulDepth);
+    assert(ulNumChildren <= psLoader->ulNumChildren);
+
+    oFT = psLoader->oFT;
+    while (psLoader->ulNumChildren > ulNumChildren)
+        psLoader->ulMade -= NodeFT_free(
+                psLoader->oArena,
+                psLoader->poNChildren[--psLoader->ulNumChildren]);
+    if (ulDepth == 0 && psLoader->ulDepth > 0) {
+        psLoader->ulMade -= NodeFT_free(psLoader->oArena, oFT->oNRoot);
+        oFT->oNRoot = NULL;
+    }
+    psLoader->ulDepth = ulDepth;
+}
+
+/*
+   Returns the component at level ulLevel of the path at pcPath, the
+   root's being at level 0, and sets *pulLength to its length, or
+   returns NULL if the path is not that deep. Does not check that the
+   path is well formatted.
+*/
+static const char *FT_findComponent(const char *pcPath, size_t ulLevel,
+                                    size_t *pulLength) {
+    const char *pcEnd;
+
+    assert(pcPath != NULL);
+    assert(pulLength != NULL);
+
+    for (; ulLevel > 0; ulLevel--) {
+        pcPath = strchr(pcPath, '/');
+        if (pcPath == NULL)
+            return NULL;
+        pcPath++;
+    }
+    pcEnd = strchr(pcPath, '/');
+    *pulLength = (pcEnd == NULL) ? strlen(pcPath)
+                                 : (size_t) (pcEnd - pcPath);
+    return pcPath;
+}
+
+/*
+   Returns TRUE if the paths of the records at psRecords[ulIndex - 1]
+   and psRecords[ulIndex] have the same component at level ulLevel.
+*/
+static boolean FT_isSameSubtree(const struct FTRecord *psRecords,
+                                size_t ulIndex, size_t ulLevel) {
+    const char *pcFirst;
+    const char *pcSecond;
+    size_t ulFirstLength = 0;
+    size_t ulSecondLength = 0;
+
+    assert(psRecords != NULL);
+    assert(ulIndex > 0);
+
+    pcFirst = FT_findComponent(psRecords[ulIndex - 1].pcPath, ulLevel,
+                               &ulFirstLength);
+    pcSecond = FT_findComponent(psRecords[ulIndex].pcPath, ulLevel,
+                                &ulSecondLength);
+    return (boolean) (pcFirst != NULL && pcSecond != NULL
+                      && ulFirstLength == ulSecondLength
+                      && !strncmp(pcFirst, pcSecond, ulFirstLength));
+}
+
+/* One range of the records of a parallel load, which one thread loads
+   below the directories all the records share, into a forest of its
+   own */
+struct FTLoadChunk {
+    /* the first record of the range, and one past its last */
+    size_t ulFirst;
+    size_t ulEnd;
+    /* the range's loader, whose base is the shared directories, and
+       which makes nodes in an arena of its own */
+    struct FTLoader sLoader;
+    /* SUCCESS and ulEnd if all of the range loaded, or the status of
+       the first record that did not and its index */
+    int iStatus;
+    size_t ulFailed;
+};
+
+/* A parallel load: its records, and the ranges they are split into,
+   which its threads take one at a time */
+struct FTParallelLoad {
+    const struct FTRecord *psRecords;
+    struct FTLoadChunk *psChunks;
+    size_t ulNumChunks;
+    /* the next range no thread has taken, guarded by sMutex */
+    size_t ulNextChunk;
+    pthread_mutex_t sMutex;
+};
+
+/*
+   Loads the ranges of the struct FTParallelLoad at pvLoad until none
+   is left to take. Has the signature of a thread's start routine, and
+   returns NULL.
+*/
+static void *FT_loadChunks(void *pvLoad) {
+    struct FTParallelLoad *psLoad = pvLoad;
+    struct FTLoadChunk *psChunk;
+    size_t i;
+    int iStatus;
+
+    assert(psLoad != NULL);
+
+    for (;;) {
+        (void) pthread_mutex_lock(&psLoad->sMutex);
+        i = psLoad->ulNextChunk;
+        if (i < psLoad->ulNumChunks)
+            psLoad->ulNextChunk++;
+        (void) pthread_mutex_unlock(&psLoad->sMutex);
+        if (i >= psLoad->ulNumChunks)
+            return NULL;
+
+        psChunk = &psLoad->psChunks[i];
+        iStatus = SUCCESS;
+        for (i = psChunk->ulFirst; i < psChunk->ulEnd; i++) {
+            iStatus = FT_loadRecord(&psChunk->sLoader,
+                                    &psLoad->psRecords[i]);
+            if (iStatus != SUCCESS)
+                break;
+        }
+        if (FT_closeLevels(&psChunk->sLoader, psChunk->sLoader.ulBase)
+            != SUCCESS && iStatus == SUCCESS)
+            iStatus = MEMORY_ERROR;
+        psChunk->iStatus = iStatus;
+        psChunk->ulFailed = i;
+    }
+}
+
+/*
+   Sets up the ulNumChunks ranges at psChunks, splitting the ulCount
+   records at psRecords from index ulFirst on at subtree boundaries
+   below the ulBase directories open in *psLoader, each range getting a
+   loader of its own based on those. Returns SUCCESS, or MEMORY_ERROR
+   (having set up nothing) if memory could not be allocated.
+*/
+static int FT_splitLoad(struct FTLoader *psLoader,
+                        const struct FTRecord *psRecords,
+                        size_t ulCount, size_t ulFirst,
+                        struct FTLoadChunk *psChunks,
+                        size_t ulNumChunks) {
+    struct FTLoader *psChunkLoader;
+    Arena_T oArena;
+    size_t ulBase;
+    size_t ulEnd;
+    size_t i, j;
+
+    assert(psLoader != NULL);
+    assert(psRecords != NULL);
+    assert(psChunks != NULL);
+    assert(ulNumChunks > 0);
+
+    ulBase = psLoader->ulDepth;
+    for (i = 0; i < ulNumChunks; i++) {
+        /* an even share of the records, then on to the end of the
+           subtree that share ends in */
+        ulEnd = ulFirst + (ulCount - ulFirst) / (ulNumChunks - i);
+        while (ulEnd > ulFirst && ulEnd < ulCount
+               && FT_isSameSubtree(psRecords, ulEnd, ulBase))
+            ulEnd++;
+        psChunks[i].ulFirst = ulFirst;
+        psChunks[i].ulEnd = ulEnd;
+        ulFirst = ulEnd;
+
+        oArena = psLoader->oFT->bLockDirs ? Arena_newShared()
+                                          : Arena_new();
+        psChunkLoader = &psChunks[i].sLoader;
+        if (oArena != NULL) {
+            FT_initLoader(psChunkLoader, psLoader->oFT, oArena);
+            psChunkLoader->psLevels = FT_grow(
+                    NULL, &psChunkLoader->ulLevelsCapacity,
+                    sizeof(struct FTLoadLevel), ulBase);
+        }
+        if (oArena == NULL || psChunkLoader->psLevels == NULL) {
+            if (oArena != NULL)
+                Arena_free(oArena);
+            for (j = 0; j < i; j++) {
+                free(psChunks[j].sLoader.psLevels);
+                Arena_free(psChunks[j].sLoader.oArena);
+            }
+            return MEMORY_ERROR;
+        }
+        for (j = 0; j < ulBase; j++) {
+            psChunkLoader->psLevels[j].oNDir =
+                psLoader->psLevels[j].oNDir;
+            psChunkLoader->psLevels[j].ulFirstChild = 0;
+        }
+        psChunkLoader->ulDepth = ulBase;
+        psChunkLoader->ulBase = ulBase;
+    }
+    assert(ulFirst == ulCount);
+    return SUCCESS;
+}
+
+/*
+   Links the forests that the ranges at psChunks loaded into the
+   directories of bulk load *psLoader, in order, up to the first range
+   that did not load in full, through the records it did load, and
+   frees the rest. Ranges whose forests would overlap are not in path
+   order, so the second of them counts as failing at its first record.
+   Sets *pulFailed to the index of the first record not loaded, or to
+   ulCount if all were, and returns SUCCESS or its status.
+*/
+static int FT_mergeLoad(struct FTLoader *psLoader,
+                        struct FTLoadChunk *psChunks,
+                        size_t ulNumChunks, size_t ulCount,
+                        size_t *pulFailed) {
+    struct FTLoader *psChunkLoader;
+    struct FTLoadLevel *psOpen;
+    NodeFT_T *poNMerged = NULL;
+    int iStatus = SUCCESS;
+    size_t i, j;
+
+    assert(psLoader != NULL);
+    assert(psChunks != NULL);
+    assert(pulFailed != NULL);
+
+    *pulFailed = ulCount;
+    psOpen = &psLoader->psLevels[psLoader->ulDepth - 1];
+    for (i = 0; i < ulNumChunks; i++) {
+        psChunkLoader = &psChunks[i].sLoader;
+        if (iStatus == SUCCESS && psChunkLoader->ulNumChildren > 0
+            && psLoader->ulNumChildren > psOpen->ulFirstChild
+            && NodeFT_compare(
+                   psLoader->poNChildren[psLoader->ulNumChildren - 1],
+                   psChunkLoader->poNChildren[0]) >= 0) {
+            iStatus = FT_OUT_OF_ORDER;
+            *pulFailed = psChunks[i].ulFirst;
+        }
+        if (iStatus == SUCCESS) {
+            poNMerged = FT_grow(psLoader->poNChildren,
+                                &psLoader->ulChildrenCapacity,
+                                sizeof(NodeFT_T),
+                                psLoader->ulNumChildren
+                                + psChunkLoader->ulNumChildren);
+            if (poNMerged == NULL) {
+                iStatus = MEMORY_ERROR;
+                *pulFailed = psChunks[i].ulFirst;
+            }
+        }
+
+        if (iStatus == SUCCESS) {
+            psLoader->poNChildren = poNMerged;
+            for (j = 0; j < psChunkLoader->ulNumChildren; j++)
+                psLoader->poNChildren[psLoader->ulNumChildren++] =
+                        psChunkLoader->poNChildren[j];
+            psLoader->ulMade += psChunkLoader->ulMade;
+            Arena_adopt(psLoader->oArena, psChunkLoader->oArena);
+            iStatus = psChunks[i].iStatus;
+            *pulFailed = psChunks[i].ulFailed;
+        }
+        else {
+            for (j = 0; j < psChunkLoader->ulNumChildren; j++)
+                (void) NodeFT_free(psChunkLoader->oArena,
+                                   psChunkLoader->poNChildren[j]);
+            Arena_free(psChunkLoader->oArena);
+        }
+        FT_freeLoader(psChunkLoader);
+    }
+    return iStatus;
+}
+
+/*
+   Loads as many as it can of the ulCount records at psRecords with
+   bulk load *psLoader, into an empty FT, using up to ulThreads
+   threads: finds the directories that all records lie in, loads the
+   records above them and the directories themselves in order, splits
+   the rest into ranges of whole subtrees for the threads to load into
+   forests of their own, and links those forests in under the shared
+   directories. Sets *pulNext to the index of the first record left to
+   load in order, as FT_loadRecords would. Returns SUCCESS, or
+   MEMORY_ERROR if memory could not be allocated to link in a range,
+   whose records are then left out.
+*/
+static int FT_loadInParallel(struct FTLoader *psLoader,
+                             const struct FTRecord *psRecords,
+                             size_t ulCount, size_t ulThreads,
+                             size_t *pulNext) {
+    struct pathView asViews[2];
+    Path_T aoPPaths[2];
+    struct FTRecord sBase;
+    char *pcBase;
+    const char *pcName;
+    size_t ulNameLength = 0;
+    size_t ulBase, ulFirst, ulDepth, ulNumChildren;
+    struct FTParallelLoad sLoad;
+    pthread_t *psThreads;
+    size_t ulStarted = 0;
+    size_t i;
+    int iStatus;
+
+    assert(psLoader != NULL);
+    assert(psRecords != NULL || ulCount == 0);
+    assert(pulNext != NULL);
+
+    *pulNext = 0;
+    if (ulCount < 2)
+        return SUCCESS;
+
+    /* the records in path order lie below the directories shared by
+       the first and last of them, the last being below them all */
+    aoPPaths[0] = NULL;
+    aoPPaths[1] = NULL;
+    if (FT_parsePath(&asViews[0], psRecords[0].pcPath,
+                     strlen(psRecords[0].pcPath),
+                     &aoPPaths[0]) != SUCCESS
+        || FT_parsePath(&asViews[1], psRecords[ulCount - 1].pcPath,
+                        strlen(psRecords[ulCount - 1].pcPath),
+                        &aoPPaths[1]) != SUCCESS) {
+        if (aoPPaths[0] != NULL)
+            Path_free(aoPPaths[0]);
+        return SUCCESS;
+    }
+    ulBase = Path_getSharedPrefixDepth(aoPPaths[0], aoPPaths[1]);
+    if (ulBase >= Path_getDepth(aoPPaths[1]))
+        ulBase = Path_getDepth(aoPPaths[1]) - 1;
+    Path_free(aoPPaths[0]);
+
+    /* load the records above those directories in order; any other
+       outcome leaves the rest in order too */
+    for (ulFirst = 0; ulFirst < ulCount && ulBase > 0; ulFirst++) {
+        if (FT_findComponent(psRecords[ulFirst].pcPath, ulBase,
+                             &ulNameLength) != NULL)
+            break;
+        if (FT_loadRecord(psLoader, &psRecords[ulFirst]) != SUCCESS) {
+            Path_free(aoPPaths[1]);
+            *pulNext = ulFirst;
+            return SUCCESS;
+        }
+    }
+
+    /* and then the directories, unless open already */
+    ulDepth = psLoader->ulDepth;
+    ulNumChildren = psLoader->ulNumChildren;
+    for (i = 0; i < ulDepth; i++) {
+        pcName = Path_getComponentSpan(aoPPaths[1], i, &ulNameLength);
+        if (FT_compareName(psLoader->psLevels[i].oNDir, pcName,
+                           ulNameLength) != 0)
+            break;
+    }
+    /* (a file cannot make the root, so when there is none, the first
+       record below must be a directory to make the root for it) */
+    iStatus = (ulBase == 0 || ulFirst == ulCount || i < ulDepth
+               || (ulDepth == 0 && psRecords[ulFirst].bIsFile))
+              ? FT_OUT_OF_ORDER : SUCCESS;
+    if (iStatus == SUCCESS && ulDepth < ulBase) {
+        pcName = Path_getComponentSpan(aoPPaths[1], ulBase - 1,
+                                       &ulNameLength);
+        i = (size_t) (pcName - Path_getPathname(aoPPaths[1]))
+            + ulNameLength;
+        pcBase = malloc(i + 1);
+        if (pcBase == NULL)
+            iStatus = MEMORY_ERROR;
+        else {
+            strncpy(pcBase, Path_getPathname(aoPPaths[1]), i);
+            pcBase[i] = '\0';
+            sBase.pcPath = pcBase;
+            sBase.bIsFile = FALSE;
+            sBase.pvContents = NULL;
+            sBase.ulLength = 0;
+            iStatus = FT_loadRecord(psLoader, &sBase);
+            free(pcBase);
+        }
+    }
+    Path_free(aoPPaths[1]);
+    if (iStatus == SUCCESS && psLoader->ulDepth != ulBase)
+        iStatus = FT_OUT_OF_ORDER;
+    if (iStatus != SUCCESS) {
+        FT_unloadChain(psLoader, ulDepth, ulNumChildren);
+        *pulNext = ulFirst;
+        return SUCCESS;
+    }
+
+    sLoad.psRecords = psRecords;
+    sLoad.ulNumChunks = ulThreads * FT_CHUNKS_PER_THREAD;
+    if (sLoad.ulNumChunks > ulCount - ulFirst)
+        sLoad.ulNumChunks = ulCount - ulFirst;
+    sLoad.ulNextChunk = 0;
+    sLoad.psChunks = malloc(sLoad.ulNumChunks
+                            * sizeof(struct FTLoadChunk));
+    iStatus = (sLoad.psChunks == NULL) ? MEMORY_ERROR
+              : FT_splitLoad(psLoader, psRecords, ulCount, ulFirst,
+                             sLoad.psChunks, sLoad.ulNumChunks);
+    if (iStatus == SUCCESS
+        && pthread_mutex_init(&sLoad.sMutex, NULL) != 0) {
+        for (i = 0; i < sLoad.ulNumChunks; i++) {
+            Arena_free(sLoad.psChunks[i].sLoader.oArena);
+            FT_freeLoader(&sLoad.psChunks[i].sLoader);
+        }
+        iStatus = MEMORY_ERROR;
+    }
+    if (iStatus != SUCCESS) {
+        /* too little memory to split the load: load it in order */
+        free(sLoad.psChunks);
+        FT_unloadChain(psLoader, ulDepth, ulNumChildren);
+        *pulNext = ulFirst;
+        return SUCCESS;
+    }
+
+    /* the calling thread loads ranges too, alone if no other starts */
+    psThreads = malloc((ulThreads - 1) * sizeof(pthread_t));
+    while (psThreads != NULL && ulStarted < ulThreads - 1
+           && pthread_create(&psThreads[ulStarted], NULL, FT_loadChunks,
+                             &sLoad) == 0)
+        ulStarted++;
+    (void) FT_loadChunks(&sLoad);
+    for (i = 0; i < ulStarted; i++)
+        (void) pthread_join(psThreads[i], NULL);
+    free(psThreads);
+    (void) pthread_mutex_destroy(&sLoad.sMutex);
+
+    iStatus = FT_mergeLoad(psLoader, sLoad.psChunks, sLoad.ulNumChunks,
+                           ulCount, pulNext);
+    free(sLoad.psChunks);
+
+    /* a range failing at once had the shared directories made for
+       nothing */
+    if (*pulNext == ulFirst)
+        FT_unloadChain(psLoader, ulDepth, ulNumChildren);
+    if (iStatus == MEMORY_ERROR)
+        return iStatus;
+    return SUCCESS;
+}
+
+/*
+   Compares the operations of batch keys pvKey1 and pvKey2, each a
+   struct FTBatchKey, by path order of their paths, and then by their
+   positions in the array of the batch's operations.
+*/
+static int FT_compareKeys(const void *pvKey1, const void *pvKey2) {
+    const struct FTBatchKey *psKey1 = pvKey1;
+    const struct FTBatchKey *psKey2 = pvKey2;
+    size_t ulLength;
+    int iResult;
+
+    assert(psKey1 != NULL);
+    assert(psKey2 != NULL);
+
+    ulLength = psKey1->ulLength;
+    if (psKey2->ulLength < ulLength)
+        ulLength = psKey2->ulLength;
+    iResult = memcmp(psKey1->pcKey, psKey2->pcKey, ulLength);
+    if (iResult != 0)
+        return iResult;
+    if (psKey1->ulLength != psKey2->ulLength)
+        return (psKey1->ulLength < psKey2->ulLength) ? -1 : 1;
+    /* operations on the same path keep their order */
+    return (psKey1->psOp > psKey2->psOp)
+           - (psKey1->psOp < psKey2->psOp);
+}
+
+/*
+   Validates the ulLength characters at pcPath as an absolute path, as
+   FT_parsePath would, and splits it into the levels of batch *psBatch,
+   making it the batch's path and setting *pulDepth to its depth. The
+   levels it shares with the batch's last path are kept, chain and
+   all, without looking at them again: only the rest of pcPath is
+   validated and split.
+
+   Returns SUCCESS, or leaves just the shared levels in the chain and
+   returns:
+   * BAD_PATH if pcPath does not represent a well-formatted path
+   * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_splitBatch(struct FTBatch *psBatch, const char *pcPath,
+                         size_t ulLength, size_t *pulDepth) {
+    struct FTBatchLevel *psLevels;
+    size_t ulShared = 0;
+    size_t ulDepth = 0;
+    size_t ulStart = 0;
+    size_t ulEnd;
+
+    assert(psBatch != NULL);
+    assert(pcPath != NULL);
+    assert(pulDepth != NULL);
+
+    /* a level is shared if its component is, and ends where the
+       component of the last path did */
+    if (psBatch->ulDepth > 0) {
+        ulEnd = psBatch->psLevels[psBatch->ulDepth - 1].ulEnd;
+        while (ulShared < ulEnd && ulShared < ulLength
+               && pcPath[ulShared] == psBatch->pcPath[ulShared])
+            ulShared++;
+        while (ulDepth < psBatch->ulDepth) {
+            ulEnd = psBatch->psLevels[ulDepth].ulEnd;
+            if (ulEnd > ulShared
+                || (ulEnd < ulLength && pcPath[ulEnd] != '/'))
+                break;
+            ulDepth++;
+        }
+        psBatch->ulDepth = ulDepth;
+        if (ulDepth > 0)
+            ulStart = psBatch->psLevels[ulDepth - 1].ulEnd + 1;
+    }
+
+    /* path cannot be empty string */
+    if (ulLength == 0)
+        return BAD_PATH;
+
+    /* validate and split the rest of pcPath, as Path_split does */
+    while (ulStart <= ulLength) {
+        /* component can't start with delimiter (or be empty at the
+           end, which means the path ended with a slash) */
+        if (ulStart == ulLength || pcPath[ulStart] == '/')
+            return BAD_PATH;
+
+        ulEnd = ulStart;
+        while (ulEnd < ulLength && pcPath[ulEnd] != '/')
+            ulEnd++;
+
+        psLevels = FT_grow(psBatch->psLevels,
+                           &psBatch->ulLevelsCapacity,
+                           sizeof(struct FTBatchLevel), ulDepth + 1);
+        if (psLevels == NULL)
+            return MEMORY_ERROR;
+        psBatch->psLevels = psLevels;
+        psLevels[ulDepth].ulEnd = ulEnd;
+        ulDepth++;
+
+        ulStart = ulEnd + 1;
+    }
+
+    psBatch->pcPath = pcPath;
+    *pulDepth = ulDepth;
+    return SUCCESS;
+}
+
+/*
+   Walks the FT of batch *psBatch, which the caller holds, as
+   FT_traversePath would towards the batch's path, of depth ulDepth,
+   but starting from the end of the batch's chain, which it extends as
+   far as the path is found in the hierarchy. Locks no directories, so
+   a fine-grained FT must be held for writing.
+
+   Returns SUCCESS, with the chain empty if the root is NULL, or
+   returns CONFLICTING_PATH, with the chain empty, if the root's path
+   is not a prefix of the batch's path.
+*/
+static int FT_walkBatch(struct FTBatch *psBatch, size_t ulDepth) {
+    struct FTBatchLevel *psLevels;
+    NodeFT_T oNChild;
+    size_t ulStart;
+    size_t i;
+
+    assert(psBatch != NULL);
+    assert(ulDepth > 0);
+
+    psLevels = psBatch->psLevels;
+    if (psBatch->oFT->oNRoot == NULL) {
+        psBatch->ulDepth = 0;
+        return SUCCESS;
+    }
+
+    /* the root's path is its name */
+    i = psBatch->ulDepth;
+    if (i == 0) {
+        if (FT_compareName(psBatch->oFT->oNRoot, psBatch->pcPath,
+                           psLevels[0].ulEnd) != 0)
+            return CONFLICTING_PATH;
+        psLevels[0].oNNode = psBatch->oFT->oNRoot;
+        i = 1;
+    }
+
+    for (; i < ulDepth; i++) {
+        /* a file ends the walk: nothing can lie beneath it */
+        if (NodeFT_isFile(psLevels[i - 1].oNNode) == TRUE)
+            break;
+        ulStart = psLevels[i - 1].ulEnd + 1;
+        oNChild = NodeFT_findChild(psLevels[i - 1].oNNode,
+                                   psBatch->pcPath + ulStart,
+                                   psLevels[i].ulEnd - ulStart);
+        if (oNChild == NULL)
+            break;
+        psLevels[i].oNNode = oNChild;
+    }
+    psBatch->ulDepth = i;
+    return SUCCESS;
+}
+
+/*
+   Makes the first ulLevels nodes of the chain of batch *psBatch, the
+   last of which is about to change, the FT's own, as FT_own does, and
+   puts the copies made in their places in the chain. Returns as
+   FT_own does, emptying the chain on failure.
+*/
+static int FT_ownBatch(struct FTBatch *psBatch, size_t ulLevels) {
+    NodeFT_T oNNode;
+
+    assert(psBatch != NULL);
+    assert(ulLevels > 0);
+    assert(ulLevels <= psBatch->ulDepth);
+
+    oNNode = psBatch->psLevels[ulLevels - 1].oNNode;
+    if (FT_own(psBatch->oFT, &oNNode) != SUCCESS) {
+        psBatch->ulDepth = 0;
+        return MEMORY_ERROR;
+    }
+
+    /* the copies are of the lowest levels up to the highest shared
+       one: follow the parent links up until the chain agrees */
+    while (ulLevels > 0
+           && psBatch->psLevels[ulLevels - 1].oNNode != oNNode) {
+        psBatch->psLevels[--ulLevels].oNNode = oNNode;
+        oNNode = NodeFT_getParent(oNNode);
+    }
+    return SUCCESS;
+}
+
+/*
+   Inserts a directory, or a file with contents pvContents of ulLength
+   bytes if bIsFile, into the FT of batch *psBatch at the batch's path,
+   of depth ulDepth, which FT_walkBatch has just walked, as
+   FT_insertDirLocked or FT_insertFileLocked would, and extends the
+   chain to the new node. Returns as they would.
+*/
+static int FT_insertBatch(struct FTBatch *psBatch, size_t ulDepth,
+                          boolean bIsFile, void *pvContents,
+                          size_t ulLength) {
+    FT_T oFT;
+    struct FTBatchLevel *psLevels;
+    NodeFT_T oNCurr = NULL;
+    NodeFT_T oNFirstNew = NULL;
+    NodeFT_T oNNewNode;
+    size_t ulIndex, ulLevel;
+    size_t ulStart, ulEnd;
+    unsigned long ulHash;
+    size_t ulHashed = 0;
+    int iStatus = SUCCESS;
+
+    assert(psBatch != NULL);
+
+    oFT = psBatch->oFT;
+    psLevels = psBatch->psLevels;
+    ulIndex = psBatch->ulDepth;
+
+    if (ulIndex == 0) {
+        /* a file cannot be the root */
+        if (bIsFile)
+            return CONFLICTING_PATH;
+    } else {
+        oNCurr = psLevels[ulIndex - 1].oNNode;
+        if (NodeFT_isFile(oNCurr) == TRUE)
+            return NOT_A_DIRECTORY;
+        if (ulIndex == ulDepth)
+            return ALREADY_IN_TREE;
+        if (FT_ownBatch(psBatch, ulIndex) != SUCCESS)
+            return MEMORY_ERROR;
+        oNCurr = psLevels[ulIndex - 1].oNNode;
+    }
+
+    /* build the rest of the path deepest first, onto the chain, as
+       FT_makeChain does, and link its top under oNCurr */
+    for (ulLevel = ulDepth; ulLevel > ulIndex; ) {
+        ulLevel--;
+        ulStart = (ulLevel == 0) ? 0 : psLevels[ulLevel - 1].ulEnd + 1;
+        ulEnd = psLevels[ulLevel].ulEnd;
+        if (bIsFile && ulLevel + 1 == ulDepth)
+            iStatus = FT_newNode(oFT, NULL, psBatch->pcPath + ulStart,
+                                 ulEnd - ulStart, pvContents, ulLength,
+                                 TRUE, &oNNewNode);
+        else
+            iStatus = FT_newNode(oFT, NULL, psBatch->pcPath + ulStart,
+                                 ulEnd - ulStart, NULL, 0, FALSE,
+                                 &oNNewNode);
+        if (iStatus != SUCCESS)
+            break;
+        if (oNFirstNew != NULL
+            && (iStatus = NodeFT_link(oNNewNode, oNFirstNew))
+               != SUCCESS) {
+            (void) NodeFT_free(oFT->oArena, oNNewNode);
+            break;
+        }
+        psLevels[ulLevel].oNNode = oNNewNode;
+        oNFirstNew = oNNewNode;
+    }
+    if (iStatus == SUCCESS && oNCurr != NULL)
+        iStatus = NodeFT_link(oNCurr, oNFirstNew);
+    if (iStatus != SUCCESS) {
+        if (oNFirstNew != NULL)
+            (void) NodeFT_free(oFT->oArena, oNFirstNew);
+        return iStatus;
+    }
+
+    /* hash each new path into the filter as FT_filterNewNode does */
+    if (oFT->oPFilter != NULL) {
+        ulHash = PathFilter_hash(psBatch->pcPath, 0);
+        for (; ulIndex < ulDepth; ulIndex++) {
+            ulEnd = psLevels[ulIndex].ulEnd;
+            ulHash = PathFilter_extendHash(ulHash,
+                                           psBatch->pcPath + ulHashed,
+                                           ulEnd - ulHashed);
+            ulHashed = ulEnd;
+            PathFilter_add(oFT->oPFilter, ulHash);
+        }
+    }
+
+    if (oFT->oNRoot == NULL)
+        oFT->oNRoot = oNFirstNew;
+    oFT->ulCount += ulDepth - psBatch->ulDepth;
+    psBatch->ulDepth = ulDepth;
+    return SUCCESS;
+}
+
+/*
+   Unlinks directory oNDir from the FT of batch *psBatch, which the
+   caller holds for writing, onto the batch's list of subtrees to free
+   once it is done, or frees it at once if memory could not be
+   allocated to list it.
+*/
+static void FT_detachBatch(struct FTBatch *psBatch, NodeFT_T oNDir) {
+    FT_T oFT;
+    NodeFT_T *poNDetached;
+    size_t ulNumRemoved;
+
+    assert(psBatch != NULL);
+    assert(oNDir != NULL);
+
+    oFT = psBatch->oFT;
+
+    /* any cached path may lie in the subtree: forget them all */
+    FT_forgetPath(oFT, NULL, 0);
+    NodeFT_detach(oNDir);
+    if (oNDir == oFT->oNRoot)
+        oFT->oNRoot = NULL;
+
+    poNDetached = FT_grow(psBatch->poNDetached,
+                          &psBatch->ulDetachedCapacity,
+                          sizeof(NodeFT_T), psBatch->ulNumDetached + 1);
+    if (poNDetached == NULL) {
+        /* a fine-grained FT keeps no subtree sizes, nor has snapshots
+           to leave any of the subtree to */
+        if (oFT->bLockDirs)
+            ulNumRemoved = NodeFT_free(oFT->oArena, oNDir);
+        else {
+            ulNumRemoved = NodeFT_getSubtreeSize(oNDir);
+            NodeFT_retire(oNDir, &oFT->oNRetired);
+        }
+        oFT->ulCount -= ulNumRemoved;
+        oFT->ulFilterStale += ulNumRemoved;
+        return;
+    }
+    psBatch->poNDetached = poNDetached;
+    poNDetached[psBatch->ulNumDetached++] = oNDir;
+}
+
+/*
+   Applies operation *psOp, which is not an insertion, to oNFound, the
+   node at its path in the FT of batch *psBatch, and stores its outcome
+   in *psResult. If the operation removes oNFound, it must be the last
+   node of the batch's chain.
+*/
+static void FT_applyBatchOpAt(struct FTBatch *psBatch,
+                              const struct FTOp *psOp,
+                              NodeFT_T oNFound,
+                              struct FTOpResult *psResult) {
+    FT_T oFT;
+    size_t ulNumRemoved;
+
+    assert(psBatch != NULL);
+    assert(psOp != NULL);
+    assert(oNFound != NULL);
+    assert(psResult != NULL);
+
+    oFT = psBatch->oFT;
+
+    if (psOp->iKind == FT_OP_STAT) {
+        psResult->bIsFile = NodeFT_isFile(oNFound);
+        if (psResult->bIsFile)
+            psResult->ulSize = NodeFT_getFileSize(oNFound);
+    } else if (psOp->iKind == FT_OP_RM_DIR) {
+        if (NodeFT_isFile(oNFound) == TRUE) {
+            psResult->iStatus = NOT_A_DIRECTORY;
+            return;
+        }
+        assert(psBatch->psLevels[psBatch->ulDepth - 1].oNNode
+               == oNFound);
+        /* the parent loses a child, so make it the FT's own */
+        if (psBatch->ulDepth > 1
+            && FT_ownBatch(psBatch, psBatch->ulDepth - 1) != SUCCESS) {
+            psResult->iStatus = MEMORY_ERROR;
+            return;
+        }
+        psBatch->ulDepth--;
+        FT_detachBatch(psBatch, oNFound);
+    } else if (NodeFT_isFile(oNFound) == FALSE) {
+        /* the rest are for files only */
+        psResult->iStatus = NOT_A_FILE;
+    } else if (psOp->iKind == FT_OP_RM_FILE) {
+        assert(psBatch->psLevels[psBatch->ulDepth - 1].oNNode
+               == oNFound);
+        if (FT_ownBatch(psBatch, psBatch->ulDepth - 1) != SUCCESS) {
+            psResult->iStatus = MEMORY_ERROR;
+            return;
+        }
+        psBatch->ulDepth--;
+        FT_forgetPath(oFT, psOp->pcPath, strlen(psOp->pcPath));
+        /* a snapshot may keep the file: count it out, not what is
+           freed */
+        ulNumRemoved = NodeFT_getSubtreeSize(oNFound);
+        (void) NodeFT_free(oFT->oArena, oNFound);
+        oFT->ulCount -= ulNumRemoved;
+        oFT->ulFilterStale += ulNumRemoved;
+    } else if (psOp->iKind == FT_OP_GET_FILE_CONTENTS) {
+        psResult->pvContents = NodeFT_getContents(oNFound);
+    } else {
+        assert(psOp->iKind == FT_OP_REPLACE_FILE_CONTENTS);
+        assert(psBatch->psLevels[psBatch->ulDepth - 1].oNNode
+               == oNFound);
+        if (FT_ownBatch(psBatch, psBatch->ulDepth) != SUCCESS) {
+            psResult->iStatus = MEMORY_ERROR;
+            return;
+        }
+        oNFound = psBatch->psLevels[psBatch->ulDepth - 1].oNNode;
+        psResult->pvContents = NodeFT_setContents(oNFound,
+                                                  psOp->pvContents,
+                                                  psOp->ulLength);
+    }
+}
+
+/*
+   Applies the operation of batch key *psKey to the FT of batch
+   *psBatch, which the caller holds, for writing unless the operation
+   only looks its path up, starting from the batch's chain, and stores
+   its outcome in *psResult.
+*/
+static void FT_applyBatchOp(struct FTBatch *psBatch,
+                            const struct FTBatchKey *psKey,
+                            struct FTOpResult *psResult) {
+    const struct FTOp *psOp;
+    size_t ulDepth = 0;
+    int iStatus;
+
+    assert(psBatch != NULL);
+    assert(psKey != NULL);
+    assert(psResult != NULL);
+
+    psOp = psKey->psOp;
+    psResult->iStatus = SUCCESS;
+    psResult->bIsFile = FALSE;
+    psResult->ulSize = 0;
+    psResult->pvContents = NULL;
+
+    iStatus = FT_splitBatch(psBatch, psOp->pcPath, psKey->ulLength,
+                            &ulDepth);
+    if (iStatus == SUCCESS)
+        iStatus = FT_walkBatch(psBatch, ulDepth);
+    if (iStatus != SUCCESS) {
+        psResult->iStatus = iStatus;
+        return;
+    }
+
+    if (psOp->iKind == FT_OP_INSERT_DIR
+        || psOp->iKind == FT_OP_INSERT_FILE)
+        psResult->iStatus = FT_insertBatch(
+            psBatch, ulDepth,
+            (boolean) (psOp->iKind == FT_OP_INSERT_FILE),
+            psOp->pvContents, psOp->ulLength);
+    /* every other operation needs the node at the path itself */
+    else if (psBatch->ulDepth != ulDepth)
+        psResult->iStatus = NO_SUCH_PATH;
+    else
+        FT_applyBatchOpAt(psBatch, psOp,
+                          psBatch->psLevels[ulDepth - 1].oNNode,
+                          psResult);
+}
+
+int FT_insertDirIn(FT_T oFT, const char *pcPath) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    /* a snapshot never changes */
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    if (oFT->bLockDirs) {
+        psReader = FT_lockRead(oFT);
+        iStatus = FT_insertDirLocked(oFT, psReader, pcPath, TRUE);
+        FT_unlockRead(oFT, psReader);
+        if (iStatus != FT_RETRY_EXCLUSIVE)
+            return iStatus;
+    }
+
+    psReader = FT_lockWrite(oFT);
+    iStatus = FT_insertDirLocked(oFT, psReader, pcPath, FALSE);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath) {
+    struct FTReader *psReader;
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    boolean bResult;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    psReader = FT_lockRead(oFT);
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), FALSE,
+                          &oNFound, &oNLocked);
+    bResult = (boolean) (iStatus == SUCCESS
+                         && NodeFT_isFile(oNFound) == FALSE);
+    FT_unlockDir(oFT, oNLocked);
+    FT_unlockRead(oFT, psReader);
+    return bResult;
+}
+
+int FT_renameIn(FT_T oFT, const char *pcSrc, const char *pcDst) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcSrc != NULL);
+    assert(pcDst != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    /* a move touches two places at once, so even a fine-grained FT
+       makes it holding the whole FT */
+    psReader = FT_lockWrite(oFT);
+    iStatus = FT_renameLocked(oFT, psReader, pcSrc, pcDst);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+int FT_rmDirIn(FT_T oFT, const char *pcPath) {
+    struct FTReader *psReader;
+    NodeFT_T oNDetached;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    if (oFT->bLockDirs) {
+        psReader = FT_lockRead(oFT);
+        iStatus = FT_rmDirLocked(oFT, psReader, pcPath, TRUE,
+                                 &oNDetached);
+        FT_unlockRead(oFT, psReader);
+        if (iStatus != FT_RETRY_EXCLUSIVE)
+            return iStatus;
+    }
+
+    psReader = FT_lockWrite(oFT);
+    iStatus = FT_rmDirLocked(oFT, psReader, pcPath, FALSE,
+                             &oNDetached);
+    FT_unlockWrite(oFT, oNDetached);
+    return iStatus;
+}
+
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    /* a file is never the root, so a fine-grained FT's directory locks
+       always suffice */
+    if (oFT->bLockDirs) {
+        psReader = FT_lockRead(oFT);
+        iStatus = FT_insertFileLocked(oFT, psReader, pcPath, pvContents,
+                                      ulLength, TRUE);
+        FT_unlockRead(oFT, psReader);
+        return iStatus;
+    }
+
+    psReader = FT_lockWrite(oFT);
+    iStatus = FT_insertFileLocked(oFT, psReader, pcPath, pvContents,
+                                  ulLength, FALSE);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath) {
+    struct FTReader *psReader;
+    int iStatus;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    boolean bResult;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    psReader = FT_lockRead(oFT);
+    iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath), FALSE,
+                          &oNFound, &oNLocked);
+    bResult = (boolean) (iStatus == SUCCESS
+                         && NodeFT_isFile(oNFound) == TRUE);
+    FT_unlockDir(oFT, oNLocked);
+    FT_unlockRead(oFT, psReader);
+    return bResult;
+}
+
+int FT_rmFileIn(FT_T oFT, const char *pcPath) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    if (oFT->bLockDirs) {
+        psReader = FT_lockRead(oFT);
+        iStatus = FT_rmFileLocked(oFT, psReader, pcPath, TRUE);
+        FT_unlockRead(oFT, psReader);
+        return iStatus;
+    }
+
+    psReader = FT_lockWrite(oFT);
+    iStatus = FT_rmFileLocked(oFT, psReader, pcPath, FALSE);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath) {
+    assert(pcPath != NULL);
+
+    return FT_getFileContentsBufferIn(oFT, pcPath, strlen(pcPath));
+}
+
+void *FT_getFileContentsBufferIn(FT_T oFT, const char *pcPath,
+                                 size_t ulLength) {
+    struct FTReader *psReader;
+    void *pvContents;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    psReader = FT_lockRead(oFT);
+    pvContents = FT_getFileContentsLocked(oFT, psReader, pcPath,
+                                          ulLength);
+    FT_unlockRead(oFT, psReader);
+    return pvContents;
+}
+
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength) {
+    struct FTReader *psReader;
+    void *pvContents;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return NULL;
+
+    if (oFT->bLockDirs) {
+        psReader = FT_lockRead(oFT);
+        pvContents = FT_replaceFileContentsLocked(oFT, psReader, pcPath,
+                                                  pvNewContents,
+                                                  ulNewLength);
+        FT_unlockRead(oFT, psReader);
+        return pvContents;
+    }
+
+    psReader = FT_lockWrite(oFT);
+    pvContents = FT_replaceFileContentsLocked(oFT, psReader, pcPath,
+                                              pvNewContents,
+                                              ulNewLength);
+    FT_unlockWrite(oFT, NULL);
+    return pvContents;
+}
+
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize) {
+    assert(pcPath != NULL);
+
+    return FT_statBufferIn(oFT, pcPath, strlen(pcPath), pbIsFile,
+                           pulSize);
+}
+
+int FT_statBufferIn(FT_T oFT, const char *pcPath, size_t ulLength,
+                    boolean *pbIsFile, size_t *pulSize) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    assert(pbIsFile != NULL);
+    assert(pulSize != NULL);
+
+    psReader = FT_lockRead(oFT);
+    iStatus = FT_statLocked(oFT, psReader, pcPath, ulLength, pbIsFile,
+                            pulSize);
+    FT_unlockRead(oFT, psReader);
+    return iStatus;
+}
+
+int FT_listFilesIn(FT_T oFT, const char *pcPath, const char *pcFirst,
+                   const char *pcLast, char **ppcResult) {
+    struct FTReader *psReader;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    assert(ppcResult != NULL);
+
+    psReader = FT_lockRead(oFT);
+    iStatus = FT_listFilesLocked(oFT, psReader, pcPath, pcFirst, pcLast,
+                                 ppcResult);
+    FT_unlockRead(oFT, psReader);
+    return iStatus;
+}
+
+int FT_bulkLoadIn(FT_T oFT, const struct FTRecord *psRecords,
+                  size_t ulCount) {
+    struct FTRecordArray sArray;
+
+    assert(oFT != NULL);
+    assert(psRecords != NULL || ulCount == 0);
+
+    sArray.psNext = psRecords;
+    sArray.ulLeft = ulCount;
+    return FT_bulkLoadStreamIn(oFT, FT_nextRecord, &sArray);
+}
+
+int FT_bulkLoadStreamIn(FT_T oFT,
+                        boolean (*pfNext)(void *pvExtra,
+                                          struct FTRecord *psRecord),
+                        void *pvExtra) {
+    struct FTReader *psReader;
+    struct FTLoader sLoader;
+    boolean bInOrder;
+    int iStatus;
+    int iFoldStatus;
+
+    assert(oFT != NULL);
+    assert(pfNext != NULL);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    psReader = FT_lockWrite(oFT);
+    FT_initLoader(&sLoader, oFT, oFT->oArena);
+
+    /* only into an empty FT can records be loaded in path order */
+    bInOrder = (boolean) (oFT->oNRoot == NULL);
+    iStatus = FT_loadRecords(&sLoader, psReader, &bInOrder, pfNext,
+                             pvExtra);
+
+    iFoldStatus = FT_foldLoad(&sLoader);
+    if (iStatus == SUCCESS)
+        iStatus = iFoldStatus;
+    FT_freeLoader(&sLoader);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+int FT_parallelLoadIn(FT_T oFT, const struct FTRecord *psRecords,
+                      size_t ulCount, size_t ulThreads) {
+    struct FTReader *psReader;
+    struct FTLoader sLoader;
+    struct FTRecordArray sArray;
+    boolean bInOrder;
+    size_t ulNext = 0;
+    int iStatus = SUCCESS;
+    int iFoldStatus;
+
+    assert(oFT != NULL);
+    assert(psRecords != NULL || ulCount == 0);
+
+    if (oFT->oFTOwner != NULL)
+        return FT_READ_ONLY;
+
+    psReader = FT_lockWrite(oFT);
+    FT_initLoader(&sLoader, oFT, oFT->oArena);
+
+    bInOrder = (boolean) (oFT->oNRoot == NULL);
+    if (bInOrder && ulThreads > 1)
+        iStatus = FT_loadInParallel(&sLoader, psRecords, ulCount,
+                                    ulThreads, &ulNext);
+
+    /* whatever is left, as FT_bulkLoadIn would load it */
+    if (iStatus == SUCCESS) {
+        sArray.psNext = psRecords + ulNext;
+        sArray.ulLeft = ulCount - ulNext;
+        iStatus = FT_loadRecords(&sLoader, psReader, &bInOrder,
+                                 FT_nextRecord, &sArray);
+    }
+
+    iFoldStatus = FT_foldLoad(&sLoader);
+    if (iStatus == SUCCESS)
+        iStatus = iFoldStatus;
+    FT_freeLoader(&sLoader);
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+int FT_applyBatchIn(FT_T oFT, const struct FTOp *psOps, size_t ulCount,
+                    struct FTOpResult *psResults) {
+    struct FTBatchKey *psKeys;
+    char *pcKeys;
+    char *pcNextKey;
+    char *pcSlash;
+    size_t ulKeysLength = 0;
+    struct FTReader *psReader = NULL;
+    struct FTBatch sBatch;
+    boolean bLookupsOnly = TRUE;
+    boolean bSorted = TRUE;
+    size_t i;
+
+    assert(oFT != NULL);
+    assert(psOps != NULL || ulCount == 0);
+    assert(psResults != NULL || ulCount == 0);
+
+    if (ulCount == 0)
+        return SUCCESS;
+
+    /* sort the operations by their keys, made all in one block */
+    for (i = 0; i < ulCount; i++) {
+        assert(psOps[i].pcPath != NULL);
+        ulKeysLength += strlen(psOps[i].pcPath);
+    }
+    psKeys = malloc(ulCount * sizeof(struct FTBatchKey));
+    pcKeys = malloc(ulKeysLength + 1);
+    if (psKeys == NULL || pcKeys == NULL) {
+        free(psKeys);
+        free(pcKeys);
+        return MEMORY_ERROR;
+    }
+    pcNextKey = pcKeys;
+    for (i = 0; i < ulCount; i++) {
+        assert(psOps[i].iKind >= FT_OP_INSERT_DIR
+               && psOps[i].iKind <= FT_OP_STAT);
+        psKeys[i].psOp = &psOps[i];
+        psKeys[i].pcKey = pcNextKey;
+        psKeys[i].ulLength = strlen(psOps[i].pcPath);
+        memcpy(pcNextKey, psOps[i].pcPath, psKeys[i].ulLength);
+        pcNextKey += psKeys[i].ulLength;
+        pcSlash = psKeys[i].pcKey;
+        while ((pcSlash = memchr(pcSlash, '/',
+                                 (size_t) (pcNextKey - pcSlash)))
+               != NULL)
+            *pcSlash++ = '\0';
+        if (psOps[i].iKind != FT_OP_STAT
+            && psOps[i].iKind != FT_OP_GET_FILE_CONTENTS)
+            bLookupsOnly = FALSE;
+        if (i > 0 && FT_compareKeys(&psKeys[i - 1], &psKeys[i]) > 0)
+            bSorted = FALSE;
+    }
+    if (!bLookupsOnly && oFT->oFTOwner != NULL) {
+        free(pcKeys);
+        free(psKeys);
+        return FT_READ_ONLY;
+    }
+    if (!bSorted)
+        qsort(psKeys, ulCount, sizeof(struct FTBatchKey),
+              FT_compareKeys);
+
+    sBatch.oFT = oFT;
+    sBatch.pcPath = NULL;
+    sBatch.psLevels = NULL;
+    sBatch.ulDepth = 0;
+    sBatch.ulLevelsCapacity = 0;
+    sBatch.poNDetached = NULL;
+    sBatch.ulNumDetached = 0;
+    sBatch.ulDetachedCapacity = 0;
+
+    /* lookups can share the FT with other readers, but the walk locks
+       no directories, so not with a fine-grained FT's changes */
+    if (bLookupsOnly && !oFT->bLockDirs)
+        psReader = FT_lockRead(oFT);
+    else
+        (void) FT_lockWrite(oFT);
+
+    for (i = 0; i < ulCount; i++)
+        FT_applyBatchOp(&sBatch, &psKeys[i],
+                        &psResults[psKeys[i].psOp - psOps]);
+
+    if (psReader != NULL)
+        FT_unlockRead(oFT, psReader);
+    else {
+        FT_freeDetached(oFT, sBatch.poNDetached, sBatch.ulNumDetached);
+        FT_unlockWrite(oFT, NULL);
+    }
+    free(sBatch.psLevels);
+    free(sBatch.poNDetached);
+    free(pcKeys);
+    free(psKeys);
+    return SUCCESS;
+}
+
+int FT_setCacheCapacityIn(FT_T oFT, size_t ulCapacity) {
+    struct FTReader *psReader;
+    PathCache_T *poPNewCaches;
+    size_t ulReaders;
+    size_t i;
+
+    assert(oFT != NULL);
+
+    /* make every reader's new cache before replacing any, so that a
+       failure leaves them all as they were */
+    ulReaders = RWLock_getNumSlots(oFT->oLock);
+    poPNewCaches = malloc(ulReaders * sizeof(PathCache_T));
+    if (poPNewCaches == NULL)
+        return MEMORY_ERROR;
+    for (i = 0; i < ulReaders; i++) {
+        poPNewCaches[i] = PathCache_new(ulCapacity);
+        if (poPNewCaches[i] == NULL) {
+            while (i > 0)
+                PathCache_free(poPNewCaches[--i]);
+            free(poPNewCaches);
+            return MEMORY_ERROR;
+        }
+    }
+
+    (void) FT_lockWrite(oFT);
+    for (i = 0; i < ulReaders; i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        PathCache_free(psReader->oPCache);
+        psReader->oPCache = poPNewCaches[i];
+    }
+    FT_unlockWrite(oFT, NULL);
+
+    free(poPNewCaches);
+    return SUCCESS;
+}
+
+int FT_setFilterIn(FT_T oFT, boolean bEnabled) {
+    int iStatus = SUCCESS;
+
+    assert(oFT != NULL);
+
+    /* a fine-grained FT's changes, made side by side, would race on
+       the filter's bits */
+    if (oFT->bLockDirs)
+        return SUCCESS;
+
+    (void) FT_lockWrite(oFT);
+    oFT->bFilterEnabled = bEnabled;
+    if (!bEnabled || oFT->oPFilter == NULL)
+        FT_installFilter(oFT, FT_buildFilter(oFT));
+    if (bEnabled && oFT->oPFilter == NULL)
+        iStatus = MEMORY_ERROR;
+    FT_unlockWrite(oFT, NULL);
+    return iStatus;
+}
+
+void FT_setReclaimBudgetIn(FT_T oFT, size_t ulBudget) {
+    assert(oFT != NULL);
+
+    /* with no budget, the write lock's release frees every retired
+       node */
+    (void) FT_lockWrite(oFT);
+    oFT->ulReclaimBudget = ulBudget;
+    FT_unlockWrite(oFT, NULL);
+}
+
+void FT_getFilterStatsIn(FT_T oFT, struct FTFilterStats *psStats) {
+    struct FTReader *psReader;
+    size_t i;
+
+    assert(oFT != NULL);
+    assert(psStats != NULL);
+
+    /* the counters are spread over the readers: hold them all */
+    (void) FT_lockWrite(oFT);
+    psStats->ulPaths = 0;
+    psStats->ulBits = 0;
+    psStats->dEstimatedRate = 0.0;
+    if (oFT->oPFilter != NULL) {
+        psStats->ulPaths = PathFilter_getLength(oFT->oPFilter);
+        psStats->ulBits = PathFilter_getNumBits(oFT->oPFilter);
+        psStats->dEstimatedRate =
+            PathFilter_getFalsePositiveRate(oFT->oPFilter);
+    }
+    psStats->ulRejected = 0;
+    psStats->ulFalsePositives = 0;
+    for (i = 0; i < RWLock_getNumSlots(oFT->oLock); i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        psStats->ulRejected += psReader->ulFilterRejected;
+        psStats->ulFalsePositives += psReader->ulFilterFalsePositives;
+    }
+    FT_unlockWrite(oFT, NULL);
+}
+
+/*
+   Frees the caches of the first ulReaders readers of oFT, then the lock
+   holding them.
+*/
+static void FT_freeReaders(FT_T oFT, size_t ulReaders) {
+    struct FTReader *psReader;
+    size_t i;
+
+    assert(oFT != NULL);
+
+    for (i = 0; i < ulReaders; i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        PathCache_free(psReader->oPCache);
+    }
+    RWLock_free(oFT->oLock);
+}
+
+/*
+   Returns a new, empty FT whose lock has ulSlots slots (one per online
+   processor if ulSlots is 0), which is concurrent if bConcurrent and
+   locks its directories if bLockDirs, or NULL if memory could not be
+   allocated. If oFTOwner is not NULL, the FT is to be a snapshot of
+   it instead, and is made empty, without a path filter, in oFTOwner's
+   arena, for the caller to give a root.
+*/
+static FT_T FT_make(size_t ulSlots, boolean bConcurrent,
+                    boolean bLockDirs, FT_T oFTOwner) {
+    FT_T oFT;
+    struct FTReader *psReader;
+    size_t i;
+
+    assert(oFTOwner == NULL || !bLockDirs);
+
+    oFT = malloc(sizeof(struct FT));
+    if (oFT == NULL)
+        return NULL;
+
+    if (oFTOwner != NULL)
+        oFT->oArena = oFTOwner->oArena;
+    else
+        oFT->oArena = bLockDirs ? Arena_newShared() : Arena_new();
+    if (oFT->oArena == NULL) {
+        free(oFT);
+        return NULL;
+    }
+
+    oFT->oLock = RWLock_new(ulSlots, sizeof(struct FTReader));
+    if (oFT->oLock == NULL) {
+        if (oFTOwner == NULL)
+            Arena_free(oFT->oArena);
+        free(oFT);
+        return NULL;
+    }
+
+    for (i = 0; i < RWLock_getNumSlots(oFT->oLock); i++) {
+        psReader = RWLock_getSlotData(oFT->oLock, i);
+        psReader->oPCache = PathCache_new(FT_DEFAULT_CACHE_CAPACITY);
+        psReader->ulFilterRejected = 0;
+        psReader->ulFilterFalsePositives = 0;
+        psReader->ulAdded = 0;
+        psReader->ulRemoved = 0;
+        if (psReader->oPCache == NULL) {
+            FT_freeReaders(oFT, i);
+            if (oFTOwner == NULL)
+                Arena_free(oFT->oArena);
+            free(oFT);
+            return NULL;
+        }
+    }
+
+    oFT->oNRoot = NULL;
+    oFT->ulCount = 0;
+    oFT->bConcurrent = bConcurrent;
+    oFT->bLockDirs = bLockDirs;
+    oFT->bFilterEnabled = (boolean) (!bLockDirs && oFTOwner == NULL);
+    oFT->oPFilter = NULL;
+    oFT->ulReclaimBudget = 0;
+    oFT->oNRetired = NULL;
+    oFT->oFTOwner = oFTOwner;
+    oFT->ulNumSnapshots = 0;
+    FT_installFilter(oFT, FT_buildFilter(oFT));
+    if (oFT->bFilterEnabled && oFT->oPFilter == NULL) {
+        FT_freeReaders(oFT, RWLock_getNumSlots(oFT->oLock));
+        Arena_free(oFT->oArena);
+        free(oFT);
+        return NULL;
+    }
+
+    assert(CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+    return oFT;
+}
+
+FT_T FT_new(void) {
+    return FT_make(1, FALSE, FALSE, NULL);
+}
+
+FT_T FT_newConcurrent(void) {
+    return FT_make(0, TRUE, FALSE, NULL);
+}
+
+FT_T FT_newFineGrained(void) {
+    return FT_make(0, TRUE, TRUE, NULL);
+}
+
+FT_T FT_snapshotIn(FT_T oFT) {
+    FT_T oFTOwner;
+    FT_T oFTSnapshot;
+
+    assert(oFT != NULL);
+
+    /* a fine-grained FT's changes, made side by side, cannot each copy
+       the directories above them */
+    if (oFT->bLockDirs)
+        return NULL;
+
+    /* a snapshot of a snapshot is another of the same version */
+    oFTOwner = oFT;
+    if (oFT->oFTOwner != NULL)
+        oFTOwner = oFT->oFTOwner;
+
+    oFTSnapshot = FT_make(oFTOwner->bConcurrent ? 0 : 1,
+                          oFTOwner->bConcurrent, FALSE, oFTOwner);
+    if (oFTSnapshot == NULL)
+        return NULL;
+
+    /* the root is shared under the owner's lock, as its writers copy
+       nodes and count their references; a snapshot never changes */
+    (void) FT_lockWrite(oFTOwner);
+    oFTSnapshot->oNRoot = oFT->oNRoot;
+    oFTSnapshot->ulCount = oFT->ulCount;
+    if (oFT->oNRoot != NULL)
+        NodeFT_share(oFT->oNRoot);
+    oFTOwner->ulNumSnapshots++;
+    FT_unlockWrite(oFTOwner, NULL);
+
+    return oFTSnapshot;
+}
+
+void FT_free(FT_T oFT) {
+    FT_T oFTOwner;
+
+    assert(oFT != NULL);
+
+    FT_foldCounts(oFT);
+
+    /* a snapshot gives its root back to its owner, which frees what
+       no other version shares as it frees removed subtrees */
+    oFTOwner = oFT->oFTOwner;
+    if (oFTOwner != NULL) {
+        (void) FT_lockWrite(oFTOwner);
+        if (oFT->oNRoot != NULL)
+            NodeFT_retire(oFT->oNRoot, &oFTOwner->oNRetired);
+        oFTOwner->ulNumSnapshots--;
+        FT_unlockWrite(oFTOwner, NULL);
+
+        FT_freeReaders(oFT, RWLock_getNumSlots(oFT->oLock));
+        if (oFT->oPFilter != NULL)
+            PathFilter_free(oFT->oPFilter);
+        free(oFT);
+        return;
+    }
+
+    assert(oFT->ulNumSnapshots == 0);
+    assert(CheckerFT_isValid(TRUE, oFT->oNRoot, oFT->ulCount));
+
+    /* every node lives in the arena, so release them all at once
+       rather than walking the hierarchy */
+    Arena_free(oFT->oArena);
+    FT_freeReaders(oFT, RWLock_getNumSlots(oFT->oLock));
+    if (oFT->oPFilter != NULL)
+        PathFilter_free(oFT->oPFilter);
+    free(oFT);
+}
+
+/*--------------------------------------------------------------------*/
+
+/** Iteration and toString Functions **/
+
+/*
+  Sets up *psIter to iterate over the subtree rooted at oNStart, whose
+  path is the ulLength characters at pcPath, in pre-order with each
+  directory's FILES before its DIRECTORIES. Returns SUCCESS, or
+  MEMORY_ERROR with nothing to free.
+*/
+static int FT_initIter(struct FTIter *psIter, NodeFT_T oNStart,
+                       const char *pcPath, size_t ulLength) {
+    assert(psIter != NULL);
+    assert(oNStart != NULL);
+    assert(pcPath != NULL);
+
+    psIter->oFT = NULL;
+    psIter->psReader = NULL;
+    psIter->oNStart = oNStart;
+    psIter->oNToOpen = NULL;
+    psIter->psLevels = NULL;
+    psIter->ulDepth = 0;
+    psIter->ulLevelsCapacity = 0;
+    psIter->ulPathLength = ulLength;
+    psIter->ulPathCapacity = 0;
+    psIter->iStatus = SUCCESS;
+    psIter->pcPath = FT_grow(NULL, &psIter->ulPathCapacity, 1,
+                             ulLength + 1);
+    if (psIter->pcPath == NULL)
+        return MEMORY_ERROR;
+    memcpy(psIter->pcPath, pcPath, ulLength);
+    psIter->pcPath[ulLength] = '\0';
+    return SUCCESS;
+}
+
+/*
+  Frees what *psIter holds, but not psIter itself.
+*/
+static void FT_freeIter(struct FTIter *psIter) {
+    assert(psIter != NULL);
+
+    free(psIter->pcPath);
+    free(psIter->psLevels);
+}
+
+/*
+  Returns the next node of *psIter's iteration, with its path in
+  psIter->pcPath, or NULL once there are none or a step could not
+  allocate memory, which sets psIter->iStatus. Allocates only to grow
+  the levels and the path beyond any earlier node's, so a step takes
+  time proportional to the new node's name, plus that of the levels it
+  closes.
+*/
+static NodeFT_T FT_stepIter(struct FTIter *psIter) {
+    struct FTIterLevel *psLevel;
+    NodeFT_T oNChild;
+    const char *pcName;
+    size_t ulNameLength;
+
+    assert(psIter != NULL);
+
+    if (psIter->iStatus != SUCCESS)
+        return NULL;
+
+    if (psIter->oNStart != NULL) {
+        oNChild = psIter->oNStart;
+        psIter->oNStart = NULL;
+        if (!NodeFT_isFile(oNChild))
+            psIter->oNToOpen = oNChild;
+        return oNChild;
+    }
+
+    if (psIter->oNToOpen != NULL) {
+        psIter->psLevels = FT_grow(psIter->psLevels,
+                                   &psIter->ulLevelsCapacity,
+                                   sizeof(struct FTIterLevel),
+                                   psIter->ulDepth + 1);
+        if (psIter->psLevels == NULL) {
+            psIter->iStatus = MEMORY_ERROR;
+            return NULL;
+        }
+        psLevel = &psIter->psLevels[psIter->ulDepth++];
+        psLevel->oNDir = psIter->oNToOpen;
+        psLevel->bFiles = TRUE;
+        psLevel->ulPathLength = psIter->ulPathLength;
+        NodeFT_seekChild(psLevel->oNDir, NULL, 0, &psLevel->sCursor);
+        psIter->oNToOpen = NULL;
+    }
+
+    /* yield each open directory's FILES, then its DIRECTORIES */
+    while (psIter->ulDepth > 0) {
+        psLevel = &psIter->psLevels[psIter->ulDepth - 1];
+        oNChild = NodeFT_nextChild(psLevel->oNDir, psLevel->bFiles,
+                                   &psLevel->sCursor);
+        if (oNChild != NULL)
+            break;
+        if (psLevel->bFiles) {
+            psLevel->bFiles = FALSE;
+            NodeFT_seekChild(psLevel->oNDir, NULL, 0,
+                             &psLevel->sCursor);
+        }
+        else
+            psIter->ulDepth--;
+    }
+    if (psIter->ulDepth == 0)
+        return NULL;
+
+    /* the child's siblings have been yielded, so its path may take
+       their place after the parent's */
+    pcName = NodeFT_getName(oNChild);
+    ulNameLength = strlen(pcName);
+    psIter->ulPathLength = psLevel->ulPathLength + 1 + ulNameLength;
+    psIter->pcPath = FT_grow(psIter->pcPath, &psIter->ulPathCapacity,
+                             1, psIter->ulPathLength + 1);
+    if (psIter->pcPath == NULL) {
+        psIter->iStatus = MEMORY_ERROR;
+        return NULL;
+    }
+    psIter->pcPath[psLevel->ulPathLength] = '/';
+    memcpy(psIter->pcPath + psLevel->ulPathLength + 1, pcName,
+           ulNameLength + 1);
+
+    if (!NodeFT_isFile(oNChild))
+        psIter->oNToOpen = oNChild;
+    return oNChild;
+}
+
+/*
+  Appends the ulLength bytes at pcData to psSerializer's output,
+  handing each full piece to its writer. Returns SUCCESS, or the
+  status the writer stopped with.
+*/
+static int FT_emit(struct FTSerializer *psSerializer,
+                   const char *pcData, size_t ulLength) {
+    size_t ulRoom;
+    int iStatus;
+
+    assert(psSerializer != NULL);
+    assert(pcData != NULL || ulLength == 0);
+
+    while (ulLength > 0) {
+        ulRoom = FT_SERIAL_BUFFER_SIZE - psSerializer->ulBuffered;
+        if (ulRoom > ulLength)
+            ulRoom = ulLength;
+        memcpy(psSerializer->acBuffer + psSerializer->ulBuffered,
+               pcData, ulRoom);
+        psSerializer->ulBuffered += ulRoom;
+        pcData += ulRoom;
+        ulLength -= ulRoom;
+        if (psSerializer->ulBuffered == FT_SERIAL_BUFFER_SIZE) {
+            iStatus = (*psSerializer->pfWrite)(psSerializer->pvExtra,
+                                               psSerializer->acBuffer,
+                                               FT_SERIAL_BUFFER_SIZE);
+            psSerializer->ulBuffered = 0;
+            if (iStatus != SUCCESS)
+                return iStatus;
+        }
+    }
+    return SUCCESS;
+}
+
+/*
+  Hands the representation of oFT, which the caller has locked, to
+  function *pfWrite, as FT_serializeIn documents. The iteration keeps
+  one level per open directory and one path, so the extra memory is
+  proportional to the depth of oFT, and the time to the length of the
+  output.
+*/
+static int FT_serializeLocked(FT_T oFT,
+                              int (*pfWrite)(void *pvExtra,
+                                             const char *pcData,
+                                             size_t ulLength),
+                              void *pvExtra) {
+    struct FTSerializer *psSerializer;
+    const char *pcName;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pfWrite != NULL);
+
+    if (oFT->oNRoot == NULL)
+        return SUCCESS;
+
+    psSerializer = malloc(sizeof(struct FTSerializer));
+    if (psSerializer == NULL)
+        return MEMORY_ERROR;
+    psSerializer->pfWrite = pfWrite;
+    psSerializer->pvExtra = pvExtra;
+    psSerializer->ulBuffered = 0;
+    pcName = NodeFT_getName(oFT->oNRoot);
+    iStatus = FT_initIter(&psSerializer->sIter, oFT->oNRoot, pcName,
+                          strlen(pcName));
+    if (iStatus != SUCCESS) {
+        free(psSerializer);
+        return iStatus;
+    }
+
+    while (iStatus == SUCCESS
+           && FT_stepIter(&psSerializer->sIter) != NULL) {
+        iStatus = FT_emit(psSerializer, psSerializer->sIter.pcPath,
+                          psSerializer->sIter.ulPathLength);
+        if (iStatus == SUCCESS)
+            iStatus = FT_emit(psSerializer, "\n", 1);
+    }
+    if (iStatus == SUCCESS)
+        iStatus = psSerializer->sIter.iStatus;
+    if (iStatus == SUCCESS && psSerializer->ulBuffered > 0)
+        iStatus = (*pfWrite)(pvExtra, psSerializer->acBuffer,
+                             psSerializer->ulBuffered);
+
+    FT_freeIter(&psSerializer->sIter);
+    free(psSerializer);
+    return iStatus;
+}
+
+/*
+  Locks oFT to be printed whole, returning the reader state to pass to
+  FT_unlockToString.
+*/
+static struct FTReader *FT_lockToString(FT_T oFT) {
+    assert(oFT != NULL);
+
+    /* a fine-grained FT's changes hold it only for reading, so shut
+       them out to print the whole hierarchy at one moment */
+    if (oFT->bLockDirs)
+        return FT_lockWrite(oFT);
+    return FT_lockRead(oFT);
+}
 
-    /* cannot add something to a file */
-    if (oNCurr != NULL && NodeFT_isFile(oNCurr) == TRUE) {
-        Path_free(oPPath);
-        return NOT_A_DIRECTORY;
-    }
+/*
+  Undoes on oFT the lock FT_lockToString took, which returned
+  psReader.
+*/
+static void FT_unlockToString(FT_T oFT, struct FTReader *psReader) {
+    assert(oFT != NULL);
 
-    ulDepth = Path_getDepth(oPPath);
-    if (oNCurr == NULL) /* new root! */
-        ulIndex = 1;
-    else {
-        ulIndex = Path_getDepth(NodeFT_getPath(oNCurr)) + 1;
+    if (oFT->bLockDirs)
+        FT_unlockWrite(oFT, NULL);
+    else
+        FT_unlockRead(oFT, psReader);
+}
 
-        /* oNCurr is the node we're trying to insert */
-        if (ulIndex == ulDepth + 1
-            && !Path_comparePath(oPPath, NodeFT_getPath(oNCurr))) {
-            Path_free(oPPath);
-            return ALREADY_IN_TREE;
-        }
-    }
+int FT_serializeIn(FT_T oFT,
+                   int (*pfWrite)(void *pvExtra, const char *pcData,
+                                  size_t ulLength),
+                   void *pvExtra) {
+    struct FTReader *psReader;
+    int iStatus;
 
-    /* starting at oNCurr, build rest of the path one level at a time */
-    while (ulIndex <= ulDepth) {
-        Path_T oPPrefix = NULL;
-        NodeFT_T oNNewNode = NULL;
+    assert(oFT != NULL);
+    assert(pfWrite != NULL);
 
-        /* generate a Path_T for this level */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            if (oNFirstNew != NULL)
-                (void) NodeFT_free(oNFirstNew);
-            assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-            return iStatus;
-        }
+    psReader = FT_lockToString(oFT);
+    iStatus = FT_serializeLocked(oFT, pfWrite, pvExtra);
+    FT_unlockToString(oFT, psReader);
+    return iStatus;
+}
 
-        /* insert the new node for this level */
-        iStatus = NodeFT_new(oNCurr, oPPrefix, pvContents, 0, bIsFile,
-                             &oNNewNode);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if (oNFirstNew != NULL)
-                (void) NodeFT_free(oNFirstNew);
-            assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-            return iStatus;
+/*
+  Writes the ulLength bytes at pcData to the file descriptor
+  *(int *) pvExtra, a piece of FT_writeToIn's output. Returns SUCCESS,
+  or FT_WRITE_ERROR if write fails.
+*/
+static int FT_writePiece(void *pvExtra, const char *pcData,
+                         size_t ulLength) {
+    ssize_t lWritten;
+
+    assert(pvExtra != NULL);
+    assert(pcData != NULL);
+
+    while (ulLength > 0) {
+        lWritten = write(*(int *) pvExtra, pcData, ulLength);
+        if (lWritten < 0) {
+            if (errno == EINTR)
+                continue;
+            return FT_WRITE_ERROR;
         }
-
-        /* set up for next level */
-        Path_free(oPPrefix);
-        oNCurr = oNNewNode;
-        ulNewNodes++;
-        if (oNFirstNew == NULL)
-            oNFirstNew = oNCurr;
-        ulIndex++;
+        pcData += lWritten;
+        ulLength -= (size_t) lWritten;
     }
+    return SUCCESS;
+}
 
-    Path_free(oPPath);
-    /* update FT state variables to reflect insertion */
-    if (oNRoot == NULL)
-        oNRoot = oNFirstNew;
-    ulCount += ulNewNodes;
+int FT_writeToIn(FT_T oFT, int iFd) {
+    assert(oFT != NULL);
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-    return SUCCESS;
+    return FT_serializeIn(oFT, FT_writePiece, &iFd);
 }
 
-boolean FT_containsDir(const char *pcPath) {
-    int iStatus;
+int FT_iterBeginIn(FT_T oFT, const char *pcPath, FTIter_T *poIter) {
+    struct FTReader *psReader;
     NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    struct FTIter *psIter;
+    size_t ulLength;
+    int iStatus;
 
+    assert(oFT != NULL);
     assert(pcPath != NULL);
+    assert(poIter != NULL);
+
+    *poIter = NULL;
+    ulLength = strlen(pcPath);
+
+    psReader = FT_lockToString(oFT);
+    iStatus = FT_findNode(oFT, psReader, pcPath, ulLength, FALSE,
+                          &oNFound, &oNLocked);
+    /* the FT lock alone keeps changes out until FT_iterEnd */
+    if (iStatus == SUCCESS)
+        FT_unlockDir(oFT, oNLocked);
+
+    psIter = NULL;
+    if (iStatus == SUCCESS) {
+        psIter = malloc(sizeof(struct FTIter));
+        if (psIter == NULL)
+            iStatus = MEMORY_ERROR;
+    }
+    if (iStatus == SUCCESS) {
+        iStatus = FT_initIter(psIter, oNFound, pcPath, ulLength);
+        if (iStatus != SUCCESS)
+            free(psIter);
+    }
+    if (iStatus != SUCCESS) {
+        FT_unlockToString(oFT, psReader);
+        return iStatus;
+    }
 
-    iStatus = FT_findNode(pcPath, &oNFound);
-    return (boolean) (iStatus == SUCCESS
-                      && NodeFT_isFile(oNFound) == FALSE);
+    psIter->oFT = oFT;
+    psIter->psReader = psReader;
+    *poIter = psIter;
+    return SUCCESS;
 }
 
-int FT_rmDir(const char *pcPath) {
-    int iStatus;
-    NodeFT_T oNFound = NULL;
-
-    assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+boolean FT_iterNext(FTIter_T oIter, const char **ppcPath,
+                    boolean *pbIsFile, size_t *pulSize) {
+    NodeFT_T oNNode;
 
-    iStatus = FT_findNode(pcPath, &oNFound);
+    assert(oIter != NULL);
+    assert(ppcPath != NULL);
+    assert(pbIsFile != NULL);
+    assert(pulSize != NULL);
 
-    if (iStatus != SUCCESS)
-        return iStatus;
+    oNNode = FT_stepIter(oIter);
+    if (oNNode == NULL)
+        return FALSE;
+    *ppcPath = oIter->pcPath;
+    *pbIsFile = NodeFT_isFile(oNNode);
+    *pulSize = NodeFT_getFileSize(oNNode);
+    return TRUE;
+}
 
-    if (NodeFT_isFile(oNFound) == TRUE)
-        return NOT_A_DIRECTORY;
+int FT_iterEnd(FTIter_T oIter) {
+    int iStatus;
 
-    ulCount -= NodeFT_free(oNFound);
-    if (ulCount == 0)
-        oNRoot = NULL;
+    assert(oIter != NULL);
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-    return SUCCESS;
+    FT_unlockToString(oIter->oFT, oIter->psReader);
+    iStatus = oIter->iStatus;
+    FT_freeIter(oIter);
+    free(oIter);
+    return iStatus;
 }
 
-int FT_insertFile(const char *pcPath, void *pvContents,
-                  size_t ulLength) {
+int FT_walkIn(FT_T oFT, const char *pcPath,
+              int (*pfVisit)(void *pvExtra, const char *pcPath,
+                             boolean bIsFile, size_t ulSize),
+              void *pvExtra) {
+    FTIter_T oIter;
+    NodeFT_T oNNode;
+    int iAction;
     int iStatus;
-    Path_T oPPath = NULL;
-    NodeFT_T oNFirstNew = NULL;
-    NodeFT_T oNCurr = NULL;
-    size_t ulDepth, ulIndex;
-    size_t ulNewNodes = 0;
 
+    assert(oFT != NULL);
     assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-
-    /* validate pcPath and generate a Path_T for it */
-    if (!bIsInitialized)
-        return INITIALIZATION_ERROR;
+    assert(pfVisit != NULL);
 
-    iStatus = Path_new(pcPath, &oPPath);
+    iStatus = FT_iterBeginIn(oFT, pcPath, &oIter);
     if (iStatus != SUCCESS)
         return iStatus;
 
-    /* find the closest ancestor of oPPath already in the tree */
-    iStatus = FT_traversePath(oPPath, &oNCurr);
-    if (iStatus != SUCCESS) {
-        Path_free(oPPath);
-        return iStatus;
+    while ((oNNode = FT_stepIter(oIter)) != NULL) {
+        iAction = (*pfVisit)(pvExtra, oIter->pcPath,
+                             NodeFT_isFile(oNNode),
+                             NodeFT_getFileSize(oNNode));
+        if (iAction == FT_WALK_STOP)
+            break;
+        /* a directory is opened only on the step after it is yielded,
+           so one left unopened costs nothing below it */
+        if (iAction == FT_WALK_SKIP_SUBTREE)
+            oIter->oNToOpen = NULL;
     }
+    return FT_iterEnd(oIter);
+}
 
-    /* no ancestor node found, and File cannot be root */
-    if (oNCurr == NULL) {
-        Path_free(oPPath);
-        return CONFLICTING_PATH;
+int FT_statTreeIn(FT_T oFT, const char *pcPath, size_t *pulFiles,
+                  size_t *pulDirs, size_t *pulBytes) {
+    struct FTReader *psReader;
+    struct NodeFTTotals sTotals;
+    NodeFT_T oNFound = NULL;
+    NodeFT_T oNLocked = NULL;
+    FTIter_T oIter;
+    int iStatus;
+
+    assert(oFT != NULL);
+    assert(pcPath != NULL);
+    assert(pulFiles != NULL);
+    assert(pulDirs != NULL);
+    assert(pulBytes != NULL);
+
+    if (oFT->bLockDirs) {
+        /* a fine-grained FT keeps no totals: count them on a walk */
+        iStatus = FT_iterBeginIn(oFT, pcPath, &oIter);
+        if (iStatus != SUCCESS)
+            return iStatus;
+        sTotals.ulFiles = 0;
+        sTotals.ulDirs = 0;
+        sTotals.ulBytes = 0;
+        while ((oNFound = FT_stepIter(oIter)) != NULL) {
+            if (NodeFT_isFile(oNFound)) {
+                sTotals.ulFiles++;
+                sTotals.ulBytes += NodeFT_getFileSize(oNFound);
+            } else
+                sTotals.ulDirs++;
+        }
+        iStatus = FT_iterEnd(oIter);
+    } else {
+        psReader = FT_lockRead(oFT);
+        iStatus = FT_findNode(oFT, psReader, pcPath, strlen(pcPath),
+                              FALSE, &oNFound, &oNLocked);
+        if (iStatus == SUCCESS) {
+            NodeFT_getTotals(oNFound, &sTotals);
+            FT_unlockDir(oFT, oNLocked);
+        }
+        FT_unlockRead(oFT, psReader);
     }
+    if (iStatus != SUCCESS)
+        return iStatus;
 
-    /* cannot add something to a file */
-    if (oNCurr != NULL && NodeFT_isFile(oNCurr)) {
-        Path_free(oPPath);
+    /* the totals count the subtree's root, which is no directory if
+       pcPath is a file */
+    if (sTotals.ulDirs == 0)
         return NOT_A_DIRECTORY;
-    }
+    *pulFiles = sTotals.ulFiles;
+    *pulDirs = sTotals.ulDirs - 1;
+    *pulBytes = sTotals.ulBytes;
+    return SUCCESS;
+}
 
-    ulDepth = Path_getDepth(oPPath);
-    ulIndex = Path_getDepth(NodeFT_getPath(oNCurr)) + 1;
+/*
+  Appends the ulLength bytes at pcData to the FTString *pvExtra, a
+  piece of FT_toStringIn's output, or only counts them while it is
+  being measured. Returns SUCCESS.
+*/
+static int FT_appendPiece(void *pvExtra, const char *pcData,
+                          size_t ulLength) {
+    struct FTString *psString = pvExtra;
 
-    /* oNCurr is the node we're trying to insert */
-    if (ulIndex == ulDepth + 1 && !Path_comparePath(oPPath,
-                                                    NodeFT_getPath(
-                                                            oNCurr))) {
-        Path_free(oPPath);
-        return ALREADY_IN_TREE;
-    }
+    assert(psString != NULL);
+    assert(pcData != NULL);
 
-    /* starting at oNCurr, build rest of the path one level at a time */
-    while (ulIndex <= ulDepth) {
-        Path_T oPPrefix = NULL;
-        NodeFT_T oNNewNode = NULL;
+    if (psString->pcResult != NULL)
+        memcpy(psString->pcResult + psString->ulLength, pcData,
+               ulLength);
+    psString->ulLength += ulLength;
+    return SUCCESS;
+}
 
-        /* generate a Path_T for this level */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            if (oNFirstNew != NULL)
-                (void) NodeFT_free(oNFirstNew);
-            assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-            return iStatus;
-        }
+char *FT_toStringIn(FT_T oFT) {
+    struct FTReader *psReader;
+    struct FTString sString;
+    int iStatus;
 
-        /* insert the new node for this level */
-        iStatus = NodeFT_new(oNCurr, oPPrefix, pvContents,
-                             ulLength,
-                             (boolean)(ulIndex == ulDepth),
-                             &oNNewNode);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if (oNFirstNew != NULL)
-                (void) NodeFT_free(oNFirstNew);
-            assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-            return iStatus;
-        }
+    assert(oFT != NULL);
+
+    /* measure, then copy into a string of just that size, both under
+       the one lock so the FT cannot change in between */
+    psReader = FT_lockToString(oFT);
+    sString.pcResult = NULL;
+    sString.ulLength = 0;
+    iStatus = FT_serializeLocked(oFT, FT_appendPiece, &sString);
+    if (iStatus == SUCCESS) {
+        sString.pcResult = malloc(sString.ulLength + 1);
+        if (sString.pcResult == NULL)
+            iStatus = MEMORY_ERROR;
+    }
+    if (iStatus == SUCCESS) {
+        sString.ulLength = 0;
+        iStatus = FT_serializeLocked(oFT, FT_appendPiece, &sString);
+    }
+    FT_unlockToString(oFT, psReader);
 
-        /* set up for next level */
-        Path_free(oPPrefix);
-        oNCurr = oNNewNode;
-        ulNewNodes++;
-        if (oNFirstNew == NULL)
-            oNFirstNew = oNCurr;
-        ulIndex++;
+    if (iStatus != SUCCESS) {
+        free(sString.pcResult);
+        return NULL;
     }
+    sString.pcResult[sString.ulLength] = '\0';
+    return sString.pcResult;
+}
 
-    Path_free(oPPath);
-    /* update FT state variables to reflect insertion */
-    if (oNRoot == NULL)
-        oNRoot = oNFirstNew;
-    ulCount += ulNewNodes;
+/*--------------------------------------------------------------------*/
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-    return SUCCESS;
-}
+/** Global Interface Functions **/
 
-boolean FT_containsFile(const char *pcPath) {
-    int iStatus;
-    NodeFT_T oNFound = NULL;
+int FT_insertDir(const char *pcPath) {
+    assert(pcPath != NULL);
+
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_insertDirIn(oFTDefault, pcPath);
+}
 
+boolean FT_containsDir(const char *pcPath) {
     assert(pcPath != NULL);
 
-    iStatus = FT_findNode(pcPath, &oNFound);
+    if (oFTDefault == NULL)
+        return FALSE;
+    return FT_containsDirIn(oFTDefault, pcPath);
+}
+
+int FT_rmDir(const char *pcPath) {
+    assert(pcPath != NULL);
 
-    return (boolean) (iStatus == SUCCESS
-                      && NodeFT_isFile(oNFound) == TRUE);
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_rmDirIn(oFTDefault, pcPath);
 }
 
-int FT_rmFile(const char *pcPath) {
-    int iStatus;
-    NodeFT_T oNFound = NULL;
+int FT_rename(const char *pcSrc, const char *pcDst) {
+    assert(pcSrc != NULL);
+    assert(pcDst != NULL);
+
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_renameIn(oFTDefault, pcSrc, pcDst);
+}
 
+int FT_insertFile(const char *pcPath, void *pvContents,
+                  size_t ulLength) {
     assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
 
-    iStatus = FT_findNode(pcPath, &oNFound);
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_insertFileIn(oFTDefault, pcPath, pvContents, ulLength);
+}
 
-    if (iStatus != SUCCESS)
-        return iStatus;
+boolean FT_containsFile(const char *pcPath) {
+    assert(pcPath != NULL);
 
-    if (NodeFT_isFile(oNFound) == FALSE)
-        return NOT_A_FILE;
+    if (oFTDefault == NULL)
+        return FALSE;
+    return FT_containsFileIn(oFTDefault, pcPath);
+}
 
-    ulCount -= NodeFT_free(oNFound);
-    if (ulCount == 0)
-        oNRoot = NULL;
+int FT_rmFile(const char *pcPath) {
+    assert(pcPath != NULL);
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-    return SUCCESS;
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_rmFileIn(oFTDefault, pcPath);
 }
 
 void *FT_getFileContents(const char *pcPath) {
-    int iStatus;
-    NodeFT_T oNFound = NULL;
-    void *pvContents = NULL;
-
     assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
 
-    iStatus = FT_findNode(pcPath, &oNFound);
-    if (iStatus != SUCCESS) {
+    if (oFTDefault == NULL)
         return NULL;
-    }
+    return FT_getFileContentsIn(oFTDefault, pcPath);
+}
 
-    pvContents = NodeFT_getContents(oNFound);
+void *FT_getFileContentsBuffer(const char *pcPath, size_t ulLength) {
+    assert(pcPath != NULL);
 
-    return pvContents;
+    if (oFTDefault == NULL)
+        return NULL;
+    return FT_getFileContentsBufferIn(oFTDefault, pcPath, ulLength);
 }
 
 void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
                              size_t ulNewLength) {
-
-    int iStatus;
-    NodeFT_T oNFound = NULL;
-    void *pvContents = NULL;
-
     assert(pcPath != NULL);
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
 
-    iStatus = FT_findNode(pcPath, &oNFound);
-
-    if (iStatus != SUCCESS) {
+    if (oFTDefault == NULL)
         return NULL;
-    }
-
-    pvContents = NodeFT_setContents(oNFound, pvNewContents,
+    return FT_replaceFileContentsIn(oFTDefault, pcPath, pvNewContents,
                                     ulNewLength);
-
-    return pvContents;
 }
 
 int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
-    int iStatus;
-    NodeFT_T oNFound = NULL;
+    assert(pcPath != NULL);
+
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_statIn(oFTDefault, pcPath, pbIsFile, pulSize);
+}
 
+int FT_statBuffer(const char *pcPath, size_t ulLength,
+                  boolean *pbIsFile, size_t *pulSize) {
     assert(pcPath != NULL);
-    assert(pbIsFile != NULL);
-    assert(pulSize != NULL);
 
-    iStatus = FT_findNode(pcPath, &oNFound);
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_statBufferIn(oFTDefault, pcPath, ulLength, pbIsFile,
+                           pulSize);
+}
 
-    if (iStatus != SUCCESS) {
-        return iStatus;
-    }
+int FT_listFiles(const char *pcPath, const char *pcFirst,
+                 const char *pcLast, char **ppcResult) {
+    assert(pcPath != NULL);
+    assert(ppcResult != NULL);
 
-    if (NodeFT_isFile(oNFound)) {
-        *pbIsFile = TRUE;
-        *pulSize = NodeFT_getFileSize(oNFound);
-    } else {
-        *pbIsFile = FALSE;
+    if (oFTDefault == NULL) {
+        *ppcResult = NULL;
+        return INITIALIZATION_ERROR;
     }
-    return SUCCESS;
+    return FT_listFilesIn(oFTDefault, pcPath, pcFirst, pcLast,
+                          ppcResult);
 }
 
-int FT_init(void) {
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+int FT_bulkLoad(const struct FTRecord *psRecords, size_t ulCount) {
+    assert(psRecords != NULL || ulCount == 0);
 
-    if (bIsInitialized)
+    if (oFTDefault == NULL)
         return INITIALIZATION_ERROR;
+    return FT_bulkLoadIn(oFTDefault, psRecords, ulCount);
+}
 
-    bIsInitialized = TRUE;
-    oNRoot = NULL;
-    ulCount = 0;
+int FT_bulkLoadStream(boolean (*pfNext)(void *pvExtra,
+                                        struct FTRecord *psRecord),
+                      void *pvExtra) {
+    assert(pfNext != NULL);
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
-    return SUCCESS;
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_bulkLoadStreamIn(oFTDefault, pfNext, pvExtra);
 }
 
-int FT_destroy(void) {
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+int FT_parallelLoad(const struct FTRecord *psRecords, size_t ulCount,
+                    size_t ulThreads) {
+    assert(psRecords != NULL || ulCount == 0);
 
-    if (!bIsInitialized)
+    if (oFTDefault == NULL)
         return INITIALIZATION_ERROR;
+    return FT_parallelLoadIn(oFTDefault, psRecords, ulCount, ulThreads);
+}
 
-    if (oNRoot) {
-        ulCount -= NodeFT_free(oNRoot);
-        oNRoot = NULL;
-    }
+int FT_applyBatch(const struct FTOp *psOps, size_t ulCount,
+                  struct FTOpResult *psResults) {
+    assert(psOps != NULL || ulCount == 0);
+    assert(psResults != NULL || ulCount == 0);
+
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_applyBatchIn(oFTDefault, psOps, ulCount, psResults);
+}
 
-    bIsInitialized = FALSE;
+int FT_setCacheCapacity(size_t ulCapacity) {
+    if (oFTDefault != NULL
+        && FT_setCacheCapacityIn(oFTDefault, ulCapacity) != SUCCESS)
+        return MEMORY_ERROR;
 
-    assert(CheckerFT_isValid(bIsInitialized, oNRoot, ulCount));
+    ulCacheCapacity = ulCapacity;
     return SUCCESS;
 }
 
-/*--------------------------------------------------------------------*/
+int FT_setFilter(boolean bEnabled) {
+    bFilterEnabled = bEnabled;
+    if (oFTDefault == NULL)
+        return SUCCESS;
+    return FT_setFilterIn(oFTDefault, bEnabled);
+}
 
-/** toString Functions **/
+void FT_setReclaimBudget(size_t ulBudget) {
+    ulReclaimBudget = ulBudget;
+    if (oFTDefault != NULL)
+        FT_setReclaimBudgetIn(oFTDefault, ulBudget);
+}
 
-/*
-  Performs a pre-order traversal of the tree rooted at oNParent,
-  inserting each payload to DynArray_T oDNodes beginning at index
-  ulIndex.
+int FT_getFilterStats(struct FTFilterStats *psStats) {
+    assert(psStats != NULL);
 
-  Returns the next unused index in oDNodes after the insertion(s).
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    FT_getFilterStatsIn(oFTDefault, psStats);
+    return SUCCESS;
+}
 
-  Precondition:
-  * oDNodes cannot be NULL
+/*
+   Makes the default FT with pfNew, one of FT_new, FT_newConcurrent and
+   FT_newFineGrained. Returns as FT_init does.
 */
+static int FT_initDefault(FT_T (*pfNew)(void)) {
+    FT_T oFT;
 
-static size_t FT_preOrderTraversal(NodeFT_T oNParent,
-                                   DynArray_T oDNodes, size_t ulIndex) {
-    size_t c;
-    int iStatus;
-
-    assert(oDNodes != NULL);
-
-    if (oNParent == NULL) {
-        return ulIndex;
-    }
+    assert(pfNew != NULL);
 
-    (void) DynArray_set(oDNodes, ulIndex, oNParent);
-    ulIndex++;
+    if (oFTDefault != NULL)
+        return INITIALIZATION_ERROR;
 
-    if (NodeFT_isFile(oNParent) == TRUE) {
-        return ulIndex;
-    }
+    oFT = pfNew();
+    if (oFT == NULL)
+        return MEMORY_ERROR;
 
-    /* collect children that are FILES before DIRECTORIES */
-    for (c = 0; c < NodeFT_getNumChildren(oNParent, TRUE); c++) {
-        NodeFT_T oNChild = NULL;
-        iStatus = NodeFT_getChild(oNParent, c, TRUE, &oNChild);
-        assert(iStatus == SUCCESS);
-        ulIndex = FT_preOrderTraversal(oNChild, oDNodes, ulIndex);
-    }
-    for (c = 0; c < NodeFT_getNumChildren(oNParent, FALSE); c++) {
-        NodeFT_T oNChild = NULL;
-        iStatus = NodeFT_getChild(oNParent, c, FALSE, &oNChild);
-        assert(iStatus == SUCCESS);
-        ulIndex = FT_preOrderTraversal(oNChild, oDNodes, ulIndex);
+    /* apply the settings made while the default FT did not exist */
+    if ((ulCacheCapacity != FT_DEFAULT_CACHE_CAPACITY
+         && FT_setCacheCapacityIn(oFT, ulCacheCapacity) != SUCCESS)
+        || FT_setFilterIn(oFT, bFilterEnabled) != SUCCESS) {
+        FT_free(oFT);
+        return MEMORY_ERROR;
     }
+    FT_setReclaimBudgetIn(oFT, ulReclaimBudget);
 
-    return ulIndex;
+    oFTDefault = oFT;
+    return SUCCESS;
 }
 
-/*
-  Alternate version of strlen that uses pulAcc as an in-out parameter
-  to accumulate a string length, rather than returning the length of
-  oNNode's path, and also always adds one addition byte to the sum.
-
-  Precondition:
-  * pulAcc cannot be NULL
-*/
-static void FT_strlenAccumulate(NodeFT_T oNNode, size_t *pulAcc) {
-    assert(pulAcc != NULL);
+int FT_init(void) {
+    return FT_initDefault(FT_new);
+}
 
-    if (oNNode != NULL)
-        *pulAcc += (Path_getStrLength(NodeFT_getPath(oNNode)) + 1);
+int FT_initConcurrent(void) {
+    return FT_initDefault(FT_newConcurrent);
 }
 
-/*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+int FT_initFineGrained(void) {
+    return FT_initDefault(FT_newFineGrained);
+}
 
-  Precondition:
-  * pulAcc cannot be NULL
-*/
-static void FT_strcatAccumulate(NodeFT_T oNNode, char *pcAcc) {
-    assert(pcAcc != NULL);
+int FT_destroy(void) {
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
 
-    if (oNNode != NULL) {
-        strcat(pcAcc, Path_getPathname(NodeFT_getPath(oNNode)));
-        strcat(pcAcc, "\n");
-    }
+    FT_free(oFTDefault);
+    oFTDefault = NULL;
+    return SUCCESS;
 }
 
 char *FT_toString(void) {
-    DynArray_T nodes;
-    size_t totalStrlen = 1;
-    char *result = NULL;
-
-    if (!bIsInitialized)
+    if (oFTDefault == NULL)
         return NULL;
+    return FT_toStringIn(oFTDefault);
+}
 
-    nodes = DynArray_new(ulCount);
-    (void) FT_preOrderTraversal(oNRoot, nodes, 0);
+int FT_serialize(int (*pfWrite)(void *pvExtra, const char *pcData,
+                                size_t ulLength),
+                 void *pvExtra) {
+    assert(pfWrite != NULL);
 
-    DynArray_map(nodes, (void (*)(void *, void *)) FT_strlenAccumulate,
-                 (void *) &totalStrlen);
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_serializeIn(oFTDefault, pfWrite, pvExtra);
+}
 
-    result = malloc(totalStrlen);
-    if (result == NULL) {
-        DynArray_free(nodes);
-        return NULL;
+int FT_writeTo(int iFd) {
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_writeToIn(oFTDefault, iFd);
+}
+
+int FT_iterBegin(const char *pcPath, FTIter_T *poIter) {
+    assert(pcPath != NULL);
+    assert(poIter != NULL);
+
+    if (oFTDefault == NULL) {
+        *poIter = NULL;
+        return INITIALIZATION_ERROR;
     }
-    *result = '\0';
+    return FT_iterBeginIn(oFTDefault, pcPath, poIter);
+}
+
+int FT_walk(const char *pcPath,
+            int (*pfVisit)(void *pvExtra, const char *pcPath,
+                           boolean bIsFile, size_t ulSize),
+            void *pvExtra) {
+    assert(pcPath != NULL);
+    assert(pfVisit != NULL);
+
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_walkIn(oFTDefault, pcPath, pfVisit, pvExtra);
+}
 
-    DynArray_map(nodes, (void (*)(void *, void *)) FT_strcatAccumulate,
-                 (void *) result);
+int FT_statTree(const char *pcPath, size_t *pulFiles, size_t *pulDirs,
+                size_t *pulBytes) {
+    assert(pcPath != NULL);
 
-    DynArray_free(nodes);
+    if (oFTDefault == NULL)
+        return INITIALIZATION_ERROR;
+    return FT_statTreeIn(oFTDefault, pcPath, pulFiles, pulDirs,
+                         pulBytes);
+}
 
-    return result;
+FT_T FT_snapshot(void) {
+    if (oFTDefault == NULL)
+        return NULL;
+    return FT_snapshotIn(oFTDefault);
 }
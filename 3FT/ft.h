@@ -83,6 +83,28 @@ boolean FT_containsFile(const char *pcPath);
 */
 int FT_rmFile(const char *pcPath);
 
+/*
+  Moves the file or directory with absolute path pcSrc, with all that
+  lies beneath it, to absolute path pcDst, making any of pcDst's
+  ancestors that do not exist as directories, as FT_insertDir would.
+  Takes time proportional to the depths of the two paths, however
+  large the subtree moved.
+  Returns SUCCESS if moved. Otherwise, returns, leaving the FT as it
+  was:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcSrc or pcDst does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcSrc
+                     or pcDst, if pcSrc is the root, or if pcDst lies
+                     beneath pcSrc
+  * NO_SUCH_PATH if absolute path pcSrc does not exist in the FT
+  * NOT_A_DIRECTORY if pcDst or a proper prefix of it exists as a
+                    file, as for an insertion at pcDst
+  * ALREADY_IN_TREE if pcDst is already in the FT as a directory, as
+                    it is if pcDst is pcSrc, a directory
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_rename(const char *pcSrc, const char *pcDst);
+
 /*
   Returns the contents of the file with absolute path pcPath.
   Returns NULL if unable to complete the request for any reason.
@@ -92,6 +114,13 @@ int FT_rmFile(const char *pcPath);
 */
 void *FT_getFileContents(const char *pcPath);
 
+/*
+  Like FT_getFileContents, but the absolute path is the ulLength
+  characters at pcPath, which need not be '\0'-terminated (e.g. a
+  slice of a larger buffer). The characters are not copied.
+*/
+void *FT_getFileContentsBuffer(const char *pcPath, size_t ulLength);
+
 /*
   Replaces current contents of the file with absolute path pcPath with
   the parameter pvNewContents of size ulNewLength bytes.
@@ -119,14 +148,282 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
 */
 int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 
+/*
+  Like FT_stat, but the absolute path is the ulLength characters at
+  pcPath, which need not be '\0'-terminated (e.g. a slice of a larger
+  buffer). The characters are not copied.
+*/
+int FT_statBuffer(const char *pcPath, size_t ulLength,
+                  boolean *pbIsFile, size_t *pulSize);
+
+/*
+  Totals up the subtree of directory pcPath, as du would: sets *pulFiles
+  and *pulDirs to the number of files and of directories beneath it,
+  itself excluded, and *pulBytes to the total length of those files'
+  contents. The FT keeps these totals in every directory as it
+  changes, so the answer takes time proportional to the depth of
+  pcPath, except in a fine-grained FT, which keeps none and so walks
+  the subtree.
+
+  Returns one of the following statuses, setting the totals only on
+  SUCCESS:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath is not well-formatted
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
+  * NOT_A_DIRECTORY if pcPath is in the hierarchy as a file not a
+    directory
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * SUCCESS if the totals were set
+*/
+int FT_statTree(const char *pcPath, size_t *pulFiles, size_t *pulDirs,
+                size_t *pulBytes);
+
+/*
+  Lists the FILES directly inside directory pcPath whose names lie
+  between pcFirst and pcLast, inclusive, in the order of strcmp. A NULL
+  pcFirst or pcLast leaves that end of the range open. Takes time
+  logarithmic in the width of the directory, plus time for the
+  children passed over.
+
+  Returns SUCCESS and sets *ppcResult to a string holding the files'
+  absolute paths in lexicographic order, each followed by a newline.
+  Allocates memory for the string, which is then owned by client!
+  Otherwise, sets *ppcResult to NULL and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_DIRECTORY if pcPath is in the FT as a file not a directory
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_listFiles(const char *pcPath, const char *pcFirst,
+                 const char *pcLast, char **ppcResult);
+
+/* One path for FT_bulkLoad to load, and what to load there */
+struct FTRecord {
+    /* the absolute path */
+    const char *pcPath;
+    /* whether to load a file (TRUE) or a directory (FALSE) there */
+    boolean bIsFile;
+    /* a file's contents and their size in bytes; a directory's are
+       ignored */
+    void *pvContents;
+    size_t ulLength;
+};
+
+/*
+  Loads the ulCount records at psRecords into the FT, as if by calling
+  FT_insertFile or FT_insertDir for each in turn, so a directory need
+  have no record of its own if a path below it has one. Loading stops
+  at the first record that cannot be loaded.
+
+  Loading into an empty FT is fastest with the records in path order:
+  each path before the paths below it, and the paths in a directory
+  ordered by strcmp on their last components (which is not strcmp on
+  the whole paths: "a/b/c" comes before "a/b.c", since "b" comes
+  before "b.c"). Each record then reuses the directories it shares with
+  the record before, and each directory is indexed once, in one go,
+  when the records below it end, so the load takes time linear in the
+  total length of the paths. A record out of order is still loaded,
+  but from then on each record is inserted one by one.
+
+  Returns SUCCESS if every record is loaded. Otherwise, returns the
+  status that inserting the first record that could not be loaded
+  returned, as documented for FT_insertFile and FT_insertDir, with the
+  records before it loaded. The exception is MEMORY_ERROR, which may
+  also leave out some of those.
+*/
+int FT_bulkLoad(const struct FTRecord *psRecords, size_t ulCount);
+
+/*
+  Like FT_bulkLoad, but takes the records from function *pfNext, which
+  it calls with pvExtra until it returns FALSE: each call returning
+  TRUE fills in *psRecord with the next record, whose path need only
+  last until the next call. So records can be streamed from a file,
+  say, without all being held at once.
+*/
+int FT_bulkLoadStream(boolean (*pfNext)(void *pvExtra,
+                                        struct FTRecord *psRecord),
+                      void *pvExtra);
+
+/*
+  Like FT_bulkLoad, with the same result and status, but loads into an
+  empty FT with up to ulThreads threads, the calling one included.
+  With the records in path order, all lie below the directories that
+  the first and last share. The records down to those directories are
+  loaded in order. The rest are split into a few ranges per thread,
+  each made of whole subtrees of the deepest shared directory, so the
+  threads can load the ranges into separate forests without waiting
+  on each other. The forests are then linked in under that directory.
+  A subtree is never split, so a load that is mostly one subtree
+  gains little. For records not in path order, the rest are loaded as
+  FT_bulkLoad would. With fewer than 2 threads, or into an FT that is
+  not empty, this is FT_bulkLoad.
+*/
+int FT_parallelLoad(const struct FTRecord *psRecords, size_t ulCount,
+                    size_t ulThreads);
+
+/* The kinds of operation FT_applyBatch can apply, each named after the
+   function it stands for */
+enum {
+    FT_OP_INSERT_DIR, FT_OP_RM_DIR, FT_OP_INSERT_FILE, FT_OP_RM_FILE,
+    FT_OP_GET_FILE_CONTENTS, FT_OP_REPLACE_FILE_CONTENTS, FT_OP_STAT
+};
+
+/* One operation for FT_applyBatch to apply */
+struct FTOp {
+    /* the kind of operation, one of the FT_OP_ constants */
+    int iKind;
+    /* the absolute path to apply it at */
+    const char *pcPath;
+    /* for FT_OP_INSERT_FILE and FT_OP_REPLACE_FILE_CONTENTS, the new
+       contents and their size in bytes; otherwise ignored */
+    void *pvContents;
+    size_t ulLength;
+};
+
+/* The outcome of one operation applied by FT_applyBatch */
+struct FTOpResult {
+    /* the status the operation's function returns; or, for those that
+       return contents, SUCCESS if they found a file and otherwise the
+       reason they return NULL, NOT_A_FILE for a directory */
+    int iStatus;
+    /* for FT_OP_STAT, what FT_stat sets *pbIsFile and *pulSize to, and
+       otherwise FALSE and 0 */
+    boolean bIsFile;
+    size_t ulSize;
+    /* for FT_OP_GET_FILE_CONTENTS and FT_OP_REPLACE_FILE_CONTENTS, the
+       contents returned, and otherwise NULL */
+    void *pvContents;
+};
+
+/*
+  Applies the ulCount operations at psOps to the FT, storing the
+  outcome of psOps[i] in psResults[i], as if by calling their functions
+  one by one, not in the order given but in path order (as for
+  FT_bulkLoad), operations on the same path keeping their order. So
+  sorted, the batch is applied in one walk: each operation starts from
+  the directories its path shares with the one before, and a burst of
+  operations in one directory walks down to it only once. Other
+  threads see the whole batch applied at once or not at all.
+
+  Returns SUCCESS once the operations are applied, whatever their
+  outcomes. Otherwise, applies none of them and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_applyBatch(const struct FTOp *psOps, size_t ulCount,
+                  struct FTOpResult *psResults);
+
+/*
+  The number of absolute paths the FT remembers the nodes of, unless
+  FT_setCacheCapacity says otherwise.
+*/
+enum { FT_DEFAULT_CACHE_CAPACITY = 1024 };
+
+/*
+  Sets to ulCapacity the number of recently looked-up absolute paths
+  whose nodes the FT remembers, so that looking one up again skips the
+  walk down the hierarchy. A capacity of 0 turns the cache off. The
+  capacity applies to the current FT, if initialized, whose cache is
+  emptied, and to every later one. A concurrent FT has a cache of this
+  capacity for each processor; a fine-grained FT has none.
+  Returns MEMORY_ERROR, leaving the cache as it was, if memory could
+  not be allocated to complete request, and SUCCESS otherwise.
+*/
+int FT_setCacheCapacity(size_t ulCapacity);
+
+/*
+  Turns on (if bEnabled is TRUE) or off the FT's path filter, a Bloom
+  filter over the absolute paths in the FT that lets most lookups of
+  paths not in the FT (by FT_contains*, FT_stat and the like) fail
+  without walking the hierarchy. The filter is on unless turned off.
+  The setting applies to the current FT, if initialized, and to every
+  later one, except that a fine-grained FT never has a filter.
+  Returns MEMORY_ERROR if memory could not be allocated to complete
+  request, in which case the FT is correct but unfiltered until memory
+  allows, and SUCCESS otherwise.
+*/
+int FT_setFilter(boolean bEnabled);
+
+/*
+  Sets to ulBudget the most nodes of removed directories that each
+  change to the FT frees before it returns. With a budget of 0, the
+  default, FT_rmDir frees the whole subtree it removes, in time linear
+  in its size. With a budget, FT_rmDir unlinks the subtree and counts
+  it out of the FT in time proportional to its depth, leaving it to be
+  freed a budget at a time by the changes that follow, this one
+  included; FT_destroy frees whatever is left. So no change takes
+  longer for the size of a directory removed, at the cost of holding
+  its memory a while. Setting a budget of 0 frees every node left. The
+  setting applies to the current FT, if initialized, and to every later
+  one, except that a fine-grained FT always frees at once.
+*/
+void FT_setReclaimBudget(size_t ulBudget);
+
+/* Statistics on how well the FT's path filter is doing */
+struct FTFilterStats {
+    /* the number of paths in the filter, counting removed ones */
+    size_t ulPaths;
+    /* the number of bits in the filter */
+    size_t ulBits;
+    /* the probability that the filter lets through a path not in it,
+       estimated from how full it is */
+    double dEstimatedRate;
+    /* the number of lookups the filter turned away */
+    size_t ulRejected;
+    /* the number of lookups the filter let through that then found
+       nothing, so the observed false-positive rate among misses it
+       saw is ulFalsePositives / (ulFalsePositives + ulRejected) */
+    size_t ulFalsePositives;
+};
+
+/*
+  Fills in *psStats with statistics on the FT's path filter since
+  FT_init. Sizes and the estimated rate are 0 if there is no filter.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state, and SUCCESS otherwise.
+*/
+int FT_getFilterStats(struct FTFilterStats *psStats);
+
 /*
   Sets the FT data structure to an initialized state.
   The data structure is initially empty.
   Returns INITIALIZATION_ERROR if already initialized,
+  MEMORY_ERROR if memory could not be allocated to complete request,
   and SUCCESS otherwise.
 */
 int FT_init(void);
 
+/*
+  Like FT_init, but makes an FT that may be used by many threads at
+  once: any number of them may look paths up, list or print it while
+  one at a time changes it. Lookups on different processors contend
+  for no shared memory, as each processor has its own slot of the lock
+  and its own path cache, so reads scale with the number of
+  processors; a change waits for all reads in progress and holds off
+  new ones until done. Each lookup is a little dearer than with
+  FT_init, so prefer that for single-threaded use.
+  Returns as FT_init does.
+*/
+int FT_initConcurrent(void);
+
+/*
+  Like FT_initConcurrent, but makes an FT that many threads may also
+  change at once. Each directory has a lock of its own, and every
+  operation walks down its path hand over hand, locking a directory
+  before releasing its parent, so changes in disjoint subtrees (say,
+  ingest threads each writing under a top-level directory of its own)
+  proceed in parallel; only making or removing the root, and
+  FT_toString, shut every other thread out. Lookups pay a lock per
+  level instead of one, and the FT keeps neither path cache nor path
+  filter, since their entries would let a lookup skip those locks, so
+  prefer FT_initConcurrent when changes are rare.
+  Returns as FT_init does.
+*/
+int FT_initFineGrained(void);
+
 /*
   Removes all contents of the data structure and
   returns it to an uninitialized state.
@@ -149,4 +446,243 @@ int FT_destroy(void);
 */
 char *FT_toString(void);
 
+/*
+  The status FT_writeTo returns, beyond those of a4def.h, when write
+  fails.
+*/
+enum { FT_WRITE_ERROR = MEMORY_ERROR + 1 };
+
+/*
+  Like FT_toString, but hands the representation to function *pfWrite
+  in pieces rather than building it whole: each call
+  (*pfWrite)(pvExtra, pcData, ulLength) passes the next ulLength bytes
+  at pcData, which are no longer valid once it returns. The pieces
+  are at most a few kilobytes, and FT_serialize's memory beyond them
+  grows with the depth of the hierarchy, not its size, so the time it
+  takes is proportional to the length of the representation. The FT
+  is locked as FT_toString locks it, so *pfWrite must not use it.
+
+  *pfWrite returns SUCCESS to go on, or any other status to stop, and
+  FT_serialize then returns that status. Otherwise, returns
+  INITIALIZATION_ERROR if not initialized, MEMORY_ERROR if memory
+  could not be allocated, and SUCCESS if every piece was handed on.
+  Either way, the pieces handed on are never taken back.
+*/
+int FT_serialize(int (*pfWrite)(void *pvExtra, const char *pcData,
+                                size_t ulLength),
+                 void *pvExtra);
+
+/*
+  Like FT_serialize, but writes the representation to file descriptor
+  iFd, retrying writes that are interrupted or write only part of a
+  piece. Returns as FT_serialize does, or FT_WRITE_ERROR, with errno
+  saying why, if write fails.
+*/
+int FT_writeTo(int iFd);
+
+/* An iteration over part of an FT */
+typedef struct FTIter *FTIter_T;
+
+/*
+  Begins an iteration over the subtree at absolute path pcPath, which
+  yields the nodes in the order FT_toString prints them, starting with
+  that at pcPath, and sets *poIter to it. The iteration holds the FT
+  locked as FT_toString does until FT_iterEnd, so the thread holding
+  it must not use the FT meanwhile but through it, and other threads
+  may only look paths up (and not at all in a fine-grained FT).
+
+  Returns SUCCESS if the iteration began. Otherwise, sets *poIter to
+  NULL and returns as FT_stat does.
+*/
+int FT_iterBegin(const char *pcPath, FTIter_T *poIter);
+
+/*
+  Moves oIter on to its next node, setting *ppcPath to the node's
+  absolute path, *pbIsFile to whether it is a file, and *pulSize to its
+  size in bytes (0 for a directory), and returns TRUE. The path is
+  oIter's, valid until the next call. Returns FALSE once there are no
+  more nodes, or if memory could not be allocated to go on. A step
+  neither recurses nor allocates, except to grow the path or the list
+  of open directories past the deepest so far, so any depth is safe.
+*/
+boolean FT_iterNext(FTIter_T oIter, const char **ppcPath,
+                    boolean *pbIsFile, size_t *pulSize);
+
+/*
+  Ends iteration oIter, at its end or before, unlocking the FT and
+  freeing oIter. Returns MEMORY_ERROR if FT_iterNext stopped for want
+  of memory, and SUCCESS otherwise.
+*/
+int FT_iterEnd(FTIter_T oIter);
+
+/* What the visitor of FT_walk returns for each node it is passed */
+enum {
+    /* go on to the next node, below this one if it is a directory */
+    FT_WALK_CONTINUE,
+    /* go on to the next node not below this one */
+    FT_WALK_SKIP_SUBTREE,
+    /* visit no more nodes */
+    FT_WALK_STOP
+};
+
+/*
+  Visits the subtree at absolute path pcPath in the order of an
+  iteration begun there, calling (*pfVisit)(pvExtra, pcPath, bIsFile,
+  ulSize) for each node with what FT_iterNext would yield for it,
+  until the visitor returns FT_WALK_STOP. A directory for which it
+  returns FT_WALK_SKIP_SUBTREE is never opened, so a walk takes time
+  proportional to the nodes visited, however large the subtrees
+  skipped. The FT is locked as FT_iterBegin locks it, so *pfVisit must
+  not use it.
+
+  Returns as FT_iterBegin does if the walk cannot begin, MEMORY_ERROR
+  if it could not go on for want of memory, and SUCCESS otherwise,
+  whether or not it was stopped.
+*/
+int FT_walk(const char *pcPath,
+            int (*pfVisit)(void *pvExtra, const char *pcPath,
+                           boolean bIsFile, size_t ulSize),
+            void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/*
+  The functions above all work on one default FT. The ones below work
+  on any number of independent FTs, each named by a handle: an FT_T is
+  in an initialized state from FT_new (or FT_newConcurrent, or
+  FT_newFineGrained) until
+  FT_free, and different FTs may be used concurrently by different
+  threads.
+
+  Each FT_xxxIn(oFT, ...) behaves as FT_xxx(...) would on oFT, except
+  that it never returns INITIALIZATION_ERROR. oFT cannot be NULL.
+*/
+typedef struct FT *FT_T;
+
+/*
+  Returns a new, empty FT, with a path cache of
+  FT_DEFAULT_CACHE_CAPACITY paths and a path filter, or NULL if memory
+  could not be allocated.
+*/
+FT_T FT_new(void);
+
+/*
+  Like FT_new, but returns an FT that may be used by many threads at
+  once, as by FT_initConcurrent.
+*/
+FT_T FT_newConcurrent(void);
+
+/*
+  Like FT_new, but returns an FT that many threads may use and change
+  at once, as by FT_initFineGrained.
+*/
+FT_T FT_newFineGrained(void);
+
+/*
+  Frees oFT and all of its contents, or releases oFT if it is a
+  snapshot (see FT_snapshotIn). An FT must outlive its snapshots.
+*/
+void FT_free(FT_T oFT);
+
+/*
+  The status changes to a snapshot return, beyond those of a4def.h.
+*/
+enum { FT_READ_ONLY = MEMORY_ERROR + 2 };
+
+/*
+  Returns a snapshot of oFT: a handle on oFT's hierarchy as it is now,
+  which it keeps, unchanged, whatever changes oFT goes through after.
+  The snapshot shares every node with oFT, so taking one takes
+  constant time; from then on, each change to oFT first copies the
+  nodes on its path that a snapshot still shares (each directory in
+  time linear in its number of children), leaving the snapshots the
+  originals, so the rest of the hierarchy is never copied.
+
+  The lookups and traversals work on a snapshot as on an FT:
+  FT_containsDirIn, FT_containsFileIn, FT_getFileContentsIn,
+  FT_getFileContentsBufferIn, FT_statIn, FT_statBufferIn,
+  FT_statTreeIn, FT_listFilesIn, FT_toStringIn, FT_serializeIn,
+  FT_writeToIn, FT_iterBeginIn, FT_walkIn, and FT_applyBatchIn with
+  lookups only. Changes return FT_READ_ONLY, or NULL for
+  FT_replaceFileContentsIn. Reading a snapshot takes none of oFT's
+  locks, so it neither waits for oFT's writers nor holds them up, and
+  a snapshot of a concurrent FT may be read by many threads at once.
+  A snapshot has path caches of its own, but no path filter unless
+  FT_setFilterIn gives it one.
+
+  Snapshots are freed with FT_free, in any order, and each before oFT;
+  the nodes only it held are then freed as oFT frees removed subtrees
+  (see FT_setReclaimBudget). A snapshot of a snapshot is another of
+  the same hierarchy.
+
+  Returns NULL if memory could not be allocated, or if oFT is
+  fine-grained, as its changes, made side by side, could not each copy
+  the directories above them.
+*/
+FT_T FT_snapshotIn(FT_T oFT);
+
+/*
+  Returns a snapshot of the default FT, as FT_snapshotIn does, or NULL
+  if the FT is not in an initialized state. Each snapshot must be
+  freed with FT_free before FT_destroy.
+*/
+FT_T FT_snapshot(void);
+
+int FT_insertDirIn(FT_T oFT, const char *pcPath);
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath);
+int FT_rmDirIn(FT_T oFT, const char *pcPath);
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength);
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath);
+int FT_rmFileIn(FT_T oFT, const char *pcPath);
+int FT_renameIn(FT_T oFT, const char *pcSrc, const char *pcDst);
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath);
+void *FT_getFileContentsBufferIn(FT_T oFT, const char *pcPath,
+                                 size_t ulLength);
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength);
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize);
+int FT_statBufferIn(FT_T oFT, const char *pcPath, size_t ulLength,
+                    boolean *pbIsFile, size_t *pulSize);
+int FT_statTreeIn(FT_T oFT, const char *pcPath, size_t *pulFiles,
+                  size_t *pulDirs, size_t *pulBytes);
+int FT_listFilesIn(FT_T oFT, const char *pcPath, const char *pcFirst,
+                   const char *pcLast, char **ppcResult);
+int FT_bulkLoadIn(FT_T oFT, const struct FTRecord *psRecords,
+                  size_t ulCount);
+int FT_bulkLoadStreamIn(FT_T oFT,
+                        boolean (*pfNext)(void *pvExtra,
+                                          struct FTRecord *psRecord),
+                        void *pvExtra);
+int FT_parallelLoadIn(FT_T oFT, const struct FTRecord *psRecords,
+                      size_t ulCount, size_t ulThreads);
+int FT_applyBatchIn(FT_T oFT, const struct FTOp *psOps, size_t ulCount,
+                    struct FTOpResult *psResults);
+char *FT_toStringIn(FT_T oFT);
+int FT_serializeIn(FT_T oFT,
+                   int (*pfWrite)(void *pvExtra, const char *pcData,
+                                  size_t ulLength),
+                   void *pvExtra);
+int FT_writeToIn(FT_T oFT, int iFd);
+int FT_iterBeginIn(FT_T oFT, const char *pcPath, FTIter_T *poIter);
+int FT_walkIn(FT_T oFT, const char *pcPath,
+              int (*pfVisit)(void *pvExtra, const char *pcPath,
+                             boolean bIsFile, size_t ulSize),
+              void *pvExtra);
+
+/*
+  Like FT_setCacheCapacity, FT_setFilter and FT_setReclaimBudget, but
+  affecting oFT alone.
+*/
+int FT_setCacheCapacityIn(FT_T oFT, size_t ulCapacity);
+int FT_setFilterIn(FT_T oFT, boolean bEnabled);
+void FT_setReclaimBudgetIn(FT_T oFT, size_t ulBudget);
+
+/*
+  Like FT_getFilterStats, which on oFT can only succeed.
+*/
+void FT_getFilterStatsIn(FT_T oFT, struct FTFilterStats *psStats);
+
 #endif
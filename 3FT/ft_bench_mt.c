@@ -0,0 +1,387 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench_mt.c                                                      */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/* The shape of the benchmark tree, and the work of each run */
+enum {
+    BENCH_DIRS = 64,
+    BENCH_FILES_PER_DIR = 256,
+    BENCH_PATHS = BENCH_DIRS * BENCH_FILES_PER_DIR,
+    BENCH_PATH_LENGTH = 32,
+    BENCH_READS_PER_THREAD = 2000000,
+    BENCH_MAX_THREADS = 64,
+    BENCH_WRITE_PAUSE_NS = 20000,
+    BENCH_TIMED_READS_PER_THREAD = 20000,
+    BENCH_DOOMED_DIRS = 64,
+    BENCH_DOOMED_FILES_PER_DIR = 512,
+    BENCH_INGEST_FILES_PER_THREAD = 20000
+};
+
+/* The FT being read, and the file paths in it */
+static FT_T oFTBench;
+static char acPaths[BENCH_PATHS][BENCH_PATH_LENGTH];
+
+/* The FT being written by the ingest writers */
+static FT_T oFTIngest;
+
+/* The latency of each timed read, in nanoseconds, by thread */
+static double
+adLatencies[BENCH_MAX_THREADS][BENCH_TIMED_READS_PER_THREAD];
+
+/* Tells the writer to stop, guarded by its mutex */
+static int iWriterStop;
+static pthread_mutex_t sWriterStopMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+  Returns the current time in seconds.
+*/
+static double Bench_now(void) {
+    struct timespec sTime;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &sTime);
+    return (double) sTime.tv_sec + (double) sTime.tv_nsec / 1e9;
+}
+
+/*
+  Returns the next number from the generator whose state is *pulSeed.
+*/
+static unsigned long Bench_random(unsigned long *pulSeed) {
+    assert(pulSeed != NULL);
+
+    *pulSeed = *pulSeed * 1103515245UL + 12345UL;
+    return (*pulSeed >> 8) & 0xffffffUL;
+}
+
+/*
+  Reads BENCH_READS_PER_THREAD random paths, mixing FT_containsFile,
+  FT_stat and FT_getFileContents. pvSeed points to the seed.
+*/
+static void *Bench_reader(void *pvSeed) {
+    unsigned long ulSeed = *(unsigned long *) pvSeed;
+    const char *pcPath;
+    boolean bIsFile;
+    size_t ulSize;
+    size_t ulFound = 0;
+    long i;
+
+    for (i = 0; i < BENCH_READS_PER_THREAD; i++) {
+        pcPath = acPaths[Bench_random(&ulSeed) % BENCH_PATHS];
+        switch (i % 3) {
+        case 0:
+            ulFound += FT_containsFileIn(oFTBench, pcPath) == TRUE;
+            break;
+        case 1:
+            ulFound += FT_statIn(oFTBench, pcPath, &bIsFile, &ulSize)
+                       == SUCCESS;
+            break;
+        default:
+            ulFound += FT_getFileContentsIn(oFTBench, pcPath) != NULL;
+            break;
+        }
+    }
+
+    return (void *) ulFound;
+}
+
+/*
+  Until told to stop, removes and reinserts random files and replaces
+  the contents of others, as a single writer would, pausing between
+  updates so that they arrive at a steady rate.
+*/
+static void *Bench_writer(void *pvUnused) {
+    unsigned long ulSeed = 4242;
+    const char *pcPath;
+    struct timespec sPause;
+    int iStop = 0;
+
+    sPause.tv_sec = 0;
+    sPause.tv_nsec = BENCH_WRITE_PAUSE_NS;
+
+    while (!iStop) {
+        pcPath = acPaths[Bench_random(&ulSeed) % BENCH_PATHS];
+        (void) FT_rmFileIn(oFTBench, pcPath);
+        (void) FT_insertFileIn(oFTBench, pcPath, acPaths, 1);
+        pcPath = acPaths[Bench_random(&ulSeed) % BENCH_PATHS];
+        (void) FT_replaceFileContentsIn(oFTBench, pcPath, acPaths, 2);
+        (void) nanosleep(&sPause, NULL);
+
+        (void) pthread_mutex_lock(&sWriterStopMutex);
+        iStop = iWriterStop;
+        (void) pthread_mutex_unlock(&sWriterStopMutex);
+    }
+
+    return pvUnused;
+}
+
+/*
+  Reads BENCH_TIMED_READS_PER_THREAD random paths with FT_stat, timing
+  each into the row of adLatencies that pvRow points to.
+*/
+static void *Bench_timedReader(void *pvRow) {
+    double *pdRow = (double *) pvRow;
+    unsigned long ulSeed = (unsigned long) (pdRow - adLatencies[0]) + 1;
+    boolean bIsFile;
+    size_t ulSize;
+    double dStart;
+    long i;
+
+    for (i = 0; i < BENCH_TIMED_READS_PER_THREAD; i++) {
+        dStart = Bench_now();
+        (void) FT_statIn(oFTBench,
+                         acPaths[Bench_random(&ulSeed) % BENCH_PATHS],
+                         &bIsFile, &ulSize);
+        pdRow[i] = (Bench_now() - dStart) * 1e9;
+    }
+
+    return NULL;
+}
+
+/*
+  Until told to stop, builds a large subtree, of BENCH_DOOMED_DIRS
+  directories of BENCH_DOOMED_FILES_PER_DIR files each, and removes
+  it with one FT_rmDir.
+*/
+static void *Bench_deleter(void *pvUnused) {
+    char acPath[BENCH_PATH_LENGTH];
+    int iDir, iFile;
+    int iStop = 0;
+
+    while (!iStop) {
+        for (iDir = 0; iDir < BENCH_DOOMED_DIRS; iDir++) {
+            for (iFile = 0; iFile < BENCH_DOOMED_FILES_PER_DIR;
+                 iFile++) {
+                sprintf(acPath, "root/doomed/d%02d/f%03d", iDir, iFile);
+                (void) FT_insertFileIn(oFTBench, acPath, acPaths, 1);
+            }
+        }
+        (void) FT_rmDirIn(oFTBench, "root/doomed");
+
+        (void) pthread_mutex_lock(&sWriterStopMutex);
+        iStop = iWriterStop;
+        (void) pthread_mutex_unlock(&sWriterStopMutex);
+    }
+
+    return pvUnused;
+}
+
+/*
+  Inserts BENCH_INGEST_FILES_PER_THREAD files, BENCH_FILES_PER_DIR to
+  a directory, into a subtree of oFTIngest that no other writer
+  touches, named by the number pvThread points to.
+*/
+static void *Bench_ingester(void *pvThread) {
+    int iThread = *(int *) pvThread;
+    char acPath[BENCH_PATH_LENGTH];
+    long i;
+
+    for (i = 0; i < BENCH_INGEST_FILES_PER_THREAD; i++) {
+        sprintf(acPath, "ingest/t%02d/d%03ld/f%03ld", iThread,
+                i / BENCH_FILES_PER_DIR, i % BENCH_FILES_PER_DIR);
+        (void) FT_insertFileIn(oFTIngest, acPath, acPaths, 1);
+    }
+
+    return NULL;
+}
+
+/*
+  Runs ulThreads ingest writers on a new FT made by pfNew, and returns
+  their total inserts per second, or a negative number if the FT could
+  not be built.
+*/
+static double Bench_ingestRun(FT_T (*pfNew)(void), size_t ulThreads) {
+    pthread_t asWriters[BENCH_MAX_THREADS];
+    int aiThreads[BENCH_MAX_THREADS];
+    double dStart, dElapsed;
+    size_t i;
+
+    assert(pfNew != NULL);
+    assert(ulThreads <= BENCH_MAX_THREADS);
+
+    oFTIngest = pfNew();
+    if (oFTIngest == NULL)
+        return -1.0;
+    if (FT_insertDirIn(oFTIngest, "ingest") != SUCCESS) {
+        FT_free(oFTIngest);
+        return -1.0;
+    }
+
+    dStart = Bench_now();
+    for (i = 0; i < ulThreads; i++) {
+        aiThreads[i] = (int) i;
+        (void) pthread_create(&asWriters[i], NULL, Bench_ingester,
+                              &aiThreads[i]);
+    }
+    for (i = 0; i < ulThreads; i++)
+        (void) pthread_join(asWriters[i], NULL);
+    dElapsed = Bench_now() - dStart;
+
+    FT_free(oFTIngest);
+    return (double) ulThreads * BENCH_INGEST_FILES_PER_THREAD
+           / dElapsed;
+}
+
+/*
+  Compares the doubles at pvFirst and pvSecond, for qsort.
+*/
+static int Bench_compareDoubles(const void *pvFirst,
+                                const void *pvSecond) {
+    double dFirst = *(const double *) pvFirst;
+    double dSecond = *(const double *) pvSecond;
+
+    return (dFirst > dSecond) - (dFirst < dSecond);
+}
+
+/*
+  Runs ulThreads timed readers while a writer repeatedly builds and
+  removes a large subtree, then prints the median, 99th percentile,
+  99.9th percentile and worst latency of their reads.
+*/
+static void Bench_latencyRun(size_t ulThreads) {
+    pthread_t asReaders[BENCH_MAX_THREADS];
+    pthread_t sWriter;
+    double *pdAll = adLatencies[0];
+    size_t ulReads = ulThreads * BENCH_TIMED_READS_PER_THREAD;
+    size_t i;
+
+    assert(ulThreads <= BENCH_MAX_THREADS);
+
+    iWriterStop = 0;
+    (void) pthread_create(&sWriter, NULL, Bench_deleter, NULL);
+    for (i = 0; i < ulThreads; i++)
+        (void) pthread_create(&asReaders[i], NULL, Bench_timedReader,
+                              adLatencies[i]);
+    for (i = 0; i < ulThreads; i++)
+        (void) pthread_join(asReaders[i], NULL);
+
+    (void) pthread_mutex_lock(&sWriterStopMutex);
+    iWriterStop = 1;
+    (void) pthread_mutex_unlock(&sWriterStopMutex);
+    (void) pthread_join(sWriter, NULL);
+
+    /* the rows are contiguous, so sort them all as one */
+    qsort(pdAll, ulReads, sizeof(double), Bench_compareDoubles);
+    printf("%8lu %10.0f %10.0f %10.0f %10.0f\n",
+           (unsigned long) ulThreads, pdAll[ulReads / 2],
+           pdAll[ulReads - ulReads / 100],
+           pdAll[ulReads - ulReads / 1000], pdAll[ulReads - 1]);
+}
+
+/*
+  Runs ulThreads readers, with a writer alongside if bWriter, and
+  returns their total reads per second.
+*/
+static double Bench_run(size_t ulThreads, boolean bWriter) {
+    pthread_t asReaders[BENCH_MAX_THREADS];
+    unsigned long aulSeeds[BENCH_MAX_THREADS];
+    pthread_t sWriter;
+    double dStart, dElapsed;
+    size_t i;
+
+    assert(ulThreads <= BENCH_MAX_THREADS);
+
+    iWriterStop = 0;
+    if (bWriter)
+        (void) pthread_create(&sWriter, NULL, Bench_writer, NULL);
+
+    dStart = Bench_now();
+    for (i = 0; i < ulThreads; i++) {
+        aulSeeds[i] = 1 + i;
+        (void) pthread_create(&asReaders[i], NULL, Bench_reader,
+                              &aulSeeds[i]);
+    }
+    for (i = 0; i < ulThreads; i++)
+        (void) pthread_join(asReaders[i], NULL);
+    dElapsed = Bench_now() - dStart;
+
+    if (bWriter) {
+        (void) pthread_mutex_lock(&sWriterStopMutex);
+        iWriterStop = 1;
+        (void) pthread_mutex_unlock(&sWriterStopMutex);
+        (void) pthread_join(sWriter, NULL);
+    }
+
+    return (double) ulThreads * BENCH_READS_PER_THREAD / dElapsed;
+}
+
+/* Measures how the read throughput of a concurrent FT scales with the
+   number of reader threads, with and without a writer running
+   alongside, doubling from 1 up to the thread count given as the
+   first argument (32 by default). Then measures the latency of reads
+   while a writer repeatedly removes large subtrees. Last, measures how
+   the insert throughput of as many writers, each on a subtree of its
+   own, scales with a concurrent FT's single lock and with a
+   fine-grained FT's per-directory locks. Returns 0, or 1 if an FT
+   could not be built. */
+int main(int argc, char *argv[]) {
+    size_t ulMaxThreads = 32;
+    size_t ulThreads;
+    double dBase = 0.0;
+    double dRate, dRateWriter;
+    double dRateOne, dRateFine;
+    int iDir, iFile;
+
+    if (argc > 1)
+        ulMaxThreads = (size_t) atoi(argv[1]);
+    if (ulMaxThreads < 1 || ulMaxThreads > BENCH_MAX_THREADS)
+        ulMaxThreads = BENCH_MAX_THREADS;
+
+    oFTBench = FT_newConcurrent();
+    if (oFTBench == NULL || FT_insertDirIn(oFTBench, "root") != SUCCESS)
+        return 1;
+    for (iDir = 0; iDir < BENCH_DIRS; iDir++) {
+        for (iFile = 0; iFile < BENCH_FILES_PER_DIR; iFile++) {
+            char *pcPath = acPaths[iDir * BENCH_FILES_PER_DIR + iFile];
+            sprintf(pcPath, "root/d%02d/f%03d", iDir, iFile);
+            if (FT_insertFileIn(oFTBench, pcPath, acPaths, 1)
+                != SUCCESS)
+                return 1;
+        }
+    }
+
+    printf("%8s %14s %9s %14s\n", "threads", "reads/s", "speedup",
+           "with writer");
+    for (ulThreads = 1; ulThreads <= ulMaxThreads; ulThreads *= 2) {
+        dRate = Bench_run(ulThreads, FALSE);
+        dRateWriter = Bench_run(ulThreads, TRUE);
+        if (ulThreads == 1)
+            dBase = dRate;
+        printf("%8lu %14.0f %8.2fx %14.0f\n", (unsigned long) ulThreads,
+               dRate, dRate / dBase, dRateWriter);
+    }
+
+    printf("\nread latency (ns) during removals of %d-node subtrees\n",
+           BENCH_DOOMED_DIRS * (BENCH_DOOMED_FILES_PER_DIR + 1) + 1);
+    printf("%8s %10s %10s %10s %10s\n", "threads", "p50", "p99",
+           "p99.9", "max");
+    for (ulThreads = 1; ulThreads <= ulMaxThreads; ulThreads *= 2)
+        Bench_latencyRun(ulThreads);
+    FT_free(oFTBench);
+
+    printf("\ninserts/s of writers on disjoint subtrees\n");
+    printf("%8s %14s %14s %9s\n", "threads", "one lock",
+           "per-directory", "speedup");
+    for (ulThreads = 1; ulThreads <= ulMaxThreads; ulThreads *= 2) {
+        dRateOne = Bench_ingestRun(FT_newConcurrent, ulThreads);
+        dRateFine = Bench_ingestRun(FT_newFineGrained, ulThreads);
+        if (dRateOne < 0.0 || dRateFine < 0.0)
+            return 1;
+        if (ulThreads == 1)
+            dBase = dRateFine;
+        printf("%8lu %14.0f %14.0f %8.2fx\n",
+               (unsigned long) ulThreads, dRateOne, dRateFine,
+               dRateFine / dBase);
+    }
+
+    return 0;
+}
@@ -3,13 +3,71 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include "ft.h"
 
+/* A buffer for FT_serialize's pieces: its bytes, how many it holds,
+   and how many it has room for */
+struct Sink {
+  char *pcData;
+  size_t ulLength;
+  size_t ulCapacity;
+};
+
+/* Appends the ulLength bytes at pcData to the Sink *pvExtra.
+   Returns SUCCESS, or MEMORY_ERROR if there is no room for them. */
+static int appendPiece(void *pvExtra, const char *pcData,
+                       size_t ulLength) {
+  struct Sink *psSink = pvExtra;
+  if (ulLength > psSink->ulCapacity - psSink->ulLength)
+    return MEMORY_ERROR;
+  memcpy(psSink->pcData + psSink->ulLength, pcData, ulLength);
+  psSink->ulLength += ulLength;
+  return SUCCESS;
+}
+
+/* Appends pcPath and a newline to the Sink *pvExtra, a node visited
+   by FT_walk. Returns FT_WALK_SKIP_SUBTREE for a directory named m,
+   FT_WALK_STOP for a file of 5 bytes, and FT_WALK_CONTINUE
+   otherwise. */
+static int visitNode(void *pvExtra, const char *pcPath,
+                     boolean bIsFile, size_t ulSize) {
+  const char *pcName = strrchr(pcPath, '/');
+  (void) appendPiece(pvExtra, pcPath, strlen(pcPath));
+  (void) appendPiece(pvExtra, "\n", 1);
+  if (!bIsFile && pcName != NULL && !strcmp(pcName, "/m"))
+    return FT_WALK_SKIP_SUBTREE;
+  if (bIsFile && ulSize == 5)
+    return FT_WALK_STOP;
+  return FT_WALK_CONTINUE;
+}
+
+/* The number of times each reader of a snapshot looks up each of the
+   snapshot's files */
+enum {SNAPSHOT_READS = 200};
+
+/* Looks up, SNAPSHOT_READS times over, each file 17r/dN/f, for N from
+   0 to 49, in the snapshot pvSnapshot, which must find them all and
+   nothing added after it was taken, whatever changes its FT goes
+   through meanwhile. Returns NULL. */
+static void *readSnapshot(void *pvSnapshot) {
+  char acPath[16];
+  size_t i;
+  for (i = 0; i < 50 * SNAPSHOT_READS; i++) {
+    sprintf(acPath, "17r/d%lu/f", (unsigned long) (i % 50));
+    assert(FT_containsFileIn(pvSnapshot, acPath) == TRUE);
+    assert(FT_containsDirIn(pvSnapshot, "17r/new") == FALSE);
+  }
+  return NULL;
+}
+
 /* Tests the FT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
    Returns 0. */
@@ -178,6 +236,24 @@ int main(void) {
   assert(FT_stat("1root/H", &bIsFile, &l) == SUCCESS);
   assert(bIsFile == TRUE);
   assert(l == (strlen("hello, world!")+1));
+
+  /* the *Buffer variants only look at the given number of characters,
+     which need not be followed by a '\0' */
+  bIsFile = FALSE;
+  l = 0;
+  assert(FT_statBuffer("1root/H/extra", strlen("1root/H"),
+                       &bIsFile, &l) == SUCCESS);
+  assert(bIsFile == TRUE);
+  assert(l == (strlen("hello, world!")+1));
+  assert(FT_statBuffer("1root/H/extra", strlen("1root/"),
+                       &bIsFile, &l) == BAD_PATH);
+  assert(FT_statBuffer("1root\0H", strlen("1root/H"),
+                       &bIsFile, &l) == BAD_PATH);
+  assert(!strcmp(FT_getFileContentsBuffer("1root/Hello",
+                                          strlen("1root/H")),
+                 "hello, world!"));
+  assert(FT_getFileContentsBuffer("1root/Hello", strlen("1root/He"))
+         == NULL);
   assert(!strcmp(FT_replaceFileContents("1root/H","Kernighan",
                                         strlen("Kernighan")+1),
                  "hello, world!"));
@@ -235,11 +311,750 @@ int main(void) {
   fprintf(stderr, "Checkpoint 4.5:\n%s\n", temp);
   free(temp);
 
+  /* files can be listed by a range of names within one directory */
+  assert(FT_listFiles("1root/y", NULL, NULL, &temp) == SUCCESS);
+  assert(!strcmp(temp, "1root/y/CHILD1FILE\n1root/y/CHILD2FILE\n"));
+  free(temp);
+  assert(FT_listFiles("1root/y", "CHILD1", "CHILD2", &temp) == SUCCESS);
+  assert(!strcmp(temp, "1root/y/CHILD1FILE\n"));
+  free(temp);
+  assert(FT_listFiles("1root/y", "CHILD2FILE", "CHILD3DIR", &temp)
+         == SUCCESS);
+  assert(!strcmp(temp, "1root/y/CHILD2FILE\n"));
+  free(temp);
+  assert(FT_listFiles("1root/y", "D", NULL, &temp) == SUCCESS);
+  assert(!strcmp(temp, ""));
+  free(temp);
+  assert(FT_listFiles("1root/x/C", NULL, NULL, &temp)
+         == NOT_A_DIRECTORY);
+  assert(temp == NULL);
+  assert(FT_listFiles("1root/z", NULL, NULL, &temp) == NO_SUCH_PATH);
+
+  /* the same holds for a directory far too wide for a sorted array */
+  for (l = 0; l < 500; l++) {
+    sprintf(arr, "1root/w/%c%03lu", (l % 3 == 0) ? 'd' : 'f',
+            (unsigned long) l);
+    if (l % 3 == 0)
+      assert(FT_insertDir(arr) == SUCCESS);
+    else
+      assert(FT_insertFile(arr, NULL, 0) == SUCCESS);
+  }
+  assert(FT_listFiles("1root/w", "f100", "f106", &temp) == SUCCESS);
+  assert(!strcmp(temp, "1root/w/f100\n1root/w/f101\n1root/w/f103\n"
+                       "1root/w/f104\n1root/w/f106\n"));
+  free(temp);
+  for (l = 0; l < 500; l += 2) {
+    sprintf(arr, "1root/w/%c%03lu", (l % 3 == 0) ? 'd' : 'f',
+            (unsigned long) l);
+    if (l % 3 == 0)
+      assert(FT_rmDir(arr) == SUCCESS);
+    else
+      assert(FT_rmFile(arr) == SUCCESS);
+  }
+  assert(FT_listFiles("1root/w", "f100", "f106", &temp) == SUCCESS);
+  assert(!strcmp(temp, "1root/w/f101\n1root/w/f103\n"));
+  free(temp);
+  assert(FT_rmDir("1root/w") == SUCCESS);
+  arr[0] = '\0';
+
+  /* cached lookups must not outlive the nodes they name */
+  assert(FT_insertFile("1root/c/d/f", "old", 4) == SUCCESS);
+  assert(!strcmp(FT_getFileContents("1root/c/d/f"), "old"));
+  assert(FT_containsDir("1root/c/d") == TRUE);
+  assert(FT_rmFile("1root/c/d/f") == SUCCESS);
+  assert(FT_containsFile("1root/c/d/f") == FALSE);
+  assert(FT_getFileContents("1root/c/d/f") == NULL);
+  assert(FT_insertFile("1root/c/d/f", "new", 4) == SUCCESS);
+  assert(!strcmp(FT_getFileContents("1root/c/d/f"), "new"));
+  assert(FT_rmDir("1root/c") == SUCCESS);
+  assert(FT_containsDir("1root/c/d") == FALSE);
+  assert(FT_stat("1root/c/d/f", &bIsFile, &l) == NO_SUCH_PATH);
+  assert(FT_insertDir("1root/c/d/f") == SUCCESS);
+  assert(FT_containsFile("1root/c/d/f") == FALSE);
+  assert(FT_containsDir("1root/c/d/f") == TRUE);
+
+  /* the same holds however small the cache, or with none at all */
+  assert(FT_setCacheCapacity(2) == SUCCESS);
+  assert(FT_insertFile("1root/c/e", NULL, 0) == SUCCESS);
+  assert(FT_containsDir("1root/c/d") == TRUE);
+  assert(FT_containsFile("1root/c/e") == TRUE);
+  assert(FT_containsDir("1root/c/d/f") == TRUE);
+  assert(FT_rmDir("1root/c/d") == SUCCESS);
+  assert(FT_containsDir("1root/c/d/f") == FALSE);
+  assert(FT_containsFile("1root/c/e") == TRUE);
+  assert(FT_setCacheCapacity(0) == SUCCESS);
+  assert(FT_containsFile("1root/c/e") == TRUE);
+  assert(FT_rmDir("1root/c") == SUCCESS);
+  assert(FT_containsFile("1root/c/e") == FALSE);
+  assert(FT_setCacheCapacity(FT_DEFAULT_CACHE_CAPACITY) == SUCCESS);
+
+  /* misses under the root are mostly turned away by the path filter,
+     which never turns away a path that is present */
+  {
+    struct FTFilterStats sStats;
+    assert(FT_getFilterStats(&sStats) == SUCCESS);
+    assert(sStats.ulBits > 0);
+    for (l = 0; l < 200; l++) {
+      sprintf(arr, "1root/g/%03lu", (unsigned long) l);
+      assert(FT_insertFile(arr, NULL, 0) == SUCCESS);
+    }
+    for (l = 0; l < 200; l++) {
+      sprintf(arr, "1root/g/%03lu", (unsigned long) l);
+      assert(FT_containsFile(arr) == TRUE);
+      sprintf(arr, "1root/g/%03lu/x", (unsigned long) l);
+      assert(FT_stat(arr, &bIsFile, &l) == NO_SUCH_PATH);
+      sprintf(arr, "1root/h/%03lu", (unsigned long) l);
+      assert(FT_containsDir(arr) == FALSE);
+    }
+    assert(FT_stat("2root/g", &bIsFile, &l) == CONFLICTING_PATH);
+    assert(FT_stat("1root//g", &bIsFile, &l) == BAD_PATH);
+    assert(FT_getFilterStats(&sStats) == SUCCESS);
+    assert(sStats.ulPaths >= 201);
+    assert(sStats.ulRejected + sStats.ulFalsePositives >= 400);
+    assert(sStats.ulFalsePositives < 40);
+    assert(sStats.dEstimatedRate > 0 && sStats.dEstimatedRate < 0.1);
+    assert(FT_rmDir("1root/g") == SUCCESS);
+    assert(FT_containsFile("1root/g/000") == FALSE);
+    assert(FT_setFilter(FALSE) == SUCCESS);
+    assert(FT_getFilterStats(&sStats) == SUCCESS);
+    assert(sStats.ulBits == 0);
+    assert(FT_containsFile("1root/y/CHILD1FILE") == TRUE);
+    assert(FT_setFilter(TRUE) == SUCCESS);
+    assert(FT_containsFile("1root/y/CHILD1FILE") == TRUE);
+    assert(FT_containsFile("1root/y/CHILD9FILE") == FALSE);
+  }
+
+  /* FTs made with FT_new are independent of each other and of the
+     default FT */
+  {
+    FT_T oFT1, oFT2;
+    assert((oFT1 = FT_new()) != NULL);
+    assert((oFT2 = FT_new()) != NULL);
+    assert(FT_insertFileIn(oFT1, "1root/a", "one", 4)
+           == CONFLICTING_PATH);
+    assert(FT_insertDirIn(oFT1, "1root") == SUCCESS);
+    assert(FT_insertFileIn(oFT1, "1root/a", "one", 4) == SUCCESS);
+    assert(FT_insertDirIn(oFT2, "2root/a") == SUCCESS);
+    assert(FT_containsFileIn(oFT1, "1root/a") == TRUE);
+    assert(FT_containsDirIn(oFT2, "2root/a") == TRUE);
+    assert(FT_containsDirIn(oFT2, "1root") == FALSE);
+    assert(FT_containsFile("1root/a") == FALSE);
+    assert(FT_containsFile("1root/y/CHILD1FILE") == TRUE);
+    assert(FT_containsFileIn(oFT1, "1root/y/CHILD1FILE") == FALSE);
+    assert(FT_statIn(oFT2, "1root", &bIsFile, &l) == CONFLICTING_PATH);
+    assert(FT_statIn(oFT1, "1root/a", &bIsFile, &l) == SUCCESS);
+    assert(bIsFile == TRUE && l == 4);
+    assert(!strcmp(FT_replaceFileContentsIn(oFT1, "1root/a", "two", 4),
+                   "one"));
+    assert(!strcmp(FT_getFileContentsIn(oFT1, "1root/a"), "two"));
+    assert((temp = FT_toStringIn(oFT2)) != NULL);
+    assert(!strcmp(temp, "2root\n2root/a\n"));
+    free(temp);
+    assert(FT_rmDirIn(oFT2, "2root") == SUCCESS);
+    assert(FT_containsDirIn(oFT2, "2root/a") == FALSE);
+    FT_free(oFT2);
+    assert(FT_rmFileIn(oFT1, "1root/a") == SUCCESS);
+    assert(FT_containsDir("1root") == TRUE);
+    FT_free(oFT1);
+  }
+
+  /* a concurrent FT behaves as any other, with every reader's cache
+     kept in step with removals */
+  {
+    FT_T oFT;
+    struct FTFilterStats sStats;
+    assert((oFT = FT_newConcurrent()) != NULL);
+    assert(FT_insertDirIn(oFT, "3root") == SUCCESS);
+    assert(FT_insertFileIn(oFT, "3root/a/b", "bee", 4) == SUCCESS);
+    assert(FT_containsFileIn(oFT, "3root/a/b") == TRUE);
+    assert(FT_rmFileIn(oFT, "3root/a/b") == SUCCESS);
+    assert(FT_containsFileIn(oFT, "3root/a/b") == FALSE);
+    assert(FT_insertFileIn(oFT, "3root/a/b", "bee", 4) == SUCCESS);
+    assert(FT_containsDirIn(oFT, "3root/a") == TRUE);
+    assert(FT_rmDirIn(oFT, "3root/a") == SUCCESS);
+    assert(FT_containsDirIn(oFT, "3root/a") == FALSE);
+    assert(FT_statIn(oFT, "3root/a/b", &bIsFile, &l) == NO_SUCH_PATH);
+    assert(FT_setCacheCapacityIn(oFT, 16) == SUCCESS);
+    assert(FT_containsDirIn(oFT, "3root") == TRUE);
+    FT_getFilterStatsIn(oFT, &sStats);
+    assert(sStats.ulRejected + sStats.ulFalsePositives >= 2);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    assert(!strcmp(temp, "3root\n"));
+    free(temp);
+    assert(FT_rmDirIn(oFT, "3root") == SUCCESS);
+    assert(FT_containsDirIn(oFT, "3root") == FALSE);
+    assert(FT_insertDirIn(oFT, "4root") == SUCCESS);
+    FT_free(oFT);
+  }
+
+  /* so does a fine-grained FT, whose changes below the root take only
+     directory locks, and which keeps no filter */
+  {
+    FT_T oFT;
+    struct FTFilterStats sStats;
+    char *pcListing = NULL;
+    assert((oFT = FT_newFineGrained()) != NULL);
+    assert(FT_insertFileIn(oFT, "5root/a", NULL, 0) == CONFLICTING_PATH);
+    assert(FT_insertDirIn(oFT, "5root/a/b") == SUCCESS);
+    assert(FT_insertDirIn(oFT, "5root/a/b") == ALREADY_IN_TREE);
+    assert(FT_insertFileIn(oFT, "5root/a/b/c/d", "dee", 4) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "5root/a/b/c/d/e", NULL, 0)
+           == NOT_A_DIRECTORY);
+    assert(FT_insertFileIn(oFT, "5root/a/f", "eff", 4) == SUCCESS);
+    assert(FT_insertDirIn(oFT, "6root") == CONFLICTING_PATH);
+    assert(FT_statIn(oFT, "5root/a/b/c/d", &bIsFile, &l) == SUCCESS);
+    assert(bIsFile == TRUE && l == 4);
+    assert(!strcmp(FT_replaceFileContentsIn(oFT, "5root/a/f", "ef", 3),
+                   "eff"));
+    assert(!strcmp(FT_getFileContentsIn(oFT, "5root/a/f"), "ef"));
+    assert(FT_listFilesIn(oFT, "5root/a", NULL, NULL, &pcListing)
+           == SUCCESS);
+    assert(!strcmp(pcListing, "5root/a/f\n"));
+    free(pcListing);
+    assert(FT_rmFileIn(oFT, "5root/a/b") == NOT_A_FILE);
+    assert(FT_rmDirIn(oFT, "5root/a/b/c/d") == NOT_A_DIRECTORY);
+    assert(FT_rmFileIn(oFT, "5root/a/f") == SUCCESS);
+    assert(FT_rmDirIn(oFT, "5root/a/b") == SUCCESS);
+    assert(FT_containsFileIn(oFT, "5root/a/b/c/d") == FALSE);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    assert(!strcmp(temp, "5root\n5root/a\n"));
+    free(temp);
+    assert(FT_setFilterIn(oFT, TRUE) == SUCCESS);
+    FT_getFilterStatsIn(oFT, &sStats);
+    assert(sStats.ulBits == 0);
+    assert(FT_rmDirIn(oFT, "5root") == SUCCESS);
+    assert(FT_containsDirIn(oFT, "5root") == FALSE);
+    assert(FT_insertFileIn(oFT, "6root/x", NULL, 0) == CONFLICTING_PATH);
+    assert(FT_insertDirIn(oFT, "6root/x") == SUCCESS);
+    FT_free(oFT);
+  }
+
+  /* a bulk load in path order behaves as inserting each record in
+     turn, as does one out of order, and stops at the first record
+     that cannot be inserted */
+  {
+    FT_T oFT;
+    struct FTRecord asRecords[200];
+    char acNames[100][8];
+    size_t i;
+    assert((oFT = FT_new()) != NULL);
+    asRecords[0].pcPath = "7root";
+    asRecords[1].pcPath = "7root/b/c";
+    asRecords[2].pcPath = "7root/b.c";
+    asRecords[3].pcPath = "7root/d/e";
+    asRecords[4].pcPath = "7root/d/f";
+    asRecords[5].pcPath = "7root/a";
+    asRecords[6].pcPath = "7root/a";
+    asRecords[7].pcPath = "7root/g";
+    for (i = 0; i < 8; i++) {
+      asRecords[i].bIsFile = (boolean) (i == 2 || i == 3 || i == 5);
+      asRecords[i].pvContents = "data";
+      asRecords[i].ulLength = 5;
+    }
+    assert(FT_bulkLoadIn(oFT, asRecords, 5) == SUCCESS);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    assert(!strcmp(temp, "7root\n7root/b.c\n7root/b\n7root/b/c\n"
+                   "7root/d\n7root/d/e\n7root/d/f\n"));
+    free(temp);
+    assert(FT_statIn(oFT, "7root/d/e", &bIsFile, &l) == SUCCESS);
+    assert(bIsFile == TRUE && l == 5);
+    assert(FT_bulkLoadIn(oFT, asRecords + 5, 3) == NOT_A_DIRECTORY);
+    assert(FT_containsFileIn(oFT, "7root/a") == TRUE);
+    assert(FT_containsDirIn(oFT, "7root/g") == FALSE);
+    FT_free(oFT);
+
+    /* a directory too wide for a sorted array is indexed in one go */
+    assert((oFT = FT_new()) != NULL);
+    for (i = 0; i < 100; i++) {
+      sprintf(acNames[i], "8r/%03lu", (unsigned long) i);
+      asRecords[i].pcPath = acNames[i];
+      asRecords[i].bIsFile = (boolean) (i % 2);
+      asRecords[i].pvContents = NULL;
+      asRecords[i].ulLength = 0;
+    }
+    assert(FT_bulkLoadIn(oFT, asRecords, 100) == SUCCESS);
+    assert(FT_containsDirIn(oFT, "8r/042") == TRUE);
+    assert(FT_containsFileIn(oFT, "8r/099") == TRUE);
+    assert(FT_rmDirIn(oFT, "8r/050") == SUCCESS);
+    assert(FT_insertFileIn(oFT, "8r/0505", NULL, 0) == SUCCESS);
+    assert(FT_listFilesIn(oFT, "8r", "097", NULL, &temp) == SUCCESS);
+    assert(!strcmp(temp, "8r/097\n8r/099\n"));
+    free(temp);
+    FT_free(oFT);
+  }
+
+  /* a parallel load builds the same tree as a serial one, and falls
+     back to inserting records once one is out of order */
+  {
+    FT_T oFT;
+    struct FTRecord asRecords[100];
+    char acNames[100][16];
+    char *pcSerial;
+    size_t i;
+    asRecords[0].pcPath = "9r";
+    asRecords[1].pcPath = "9r/s";
+    for (i = 2; i < 100; i++) {
+      sprintf(acNames[i], "9r/s/%lu/%02lu", (unsigned long) i / 10,
+              (unsigned long) i);
+      asRecords[i].pcPath = acNames[i];
+    }
+    for (i = 0; i < 100; i++) {
+      asRecords[i].bIsFile = (boolean) (i > 1 && i % 3 != 0);
+      asRecords[i].pvContents = NULL;
+      asRecords[i].ulLength = i;
+    }
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_bulkLoadIn(oFT, asRecords, 100) == SUCCESS);
+    assert((pcSerial = FT_toStringIn(oFT)) != NULL);
+    FT_free(oFT);
+    assert((oFT = FT_newFineGrained()) != NULL);
+    assert(FT_parallelLoadIn(oFT, asRecords, 100, 4) == SUCCESS);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    assert(!strcmp(temp, pcSerial));
+    free(temp);
+    free(pcSerial);
+    assert(FT_statIn(oFT, "9r/s/5/52", &bIsFile, &l) == SUCCESS);
+    assert(bIsFile == TRUE && l == 52);
+    assert(FT_rmDirIn(oFT, "9r/s/4") == SUCCESS);
+    assert(FT_insertFileIn(oFT, "9r/s/4", NULL, 0) == SUCCESS);
+    FT_free(oFT);
+
+    asRecords[60].pcPath = "9r/s/0/00";
+    asRecords[61].pcPath = "9r/s/5/59/x";
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_parallelLoadIn(oFT, asRecords, 100, 3)
+           == NOT_A_DIRECTORY);
+    assert(FT_containsDirIn(oFT, "9r/s/0/00") == TRUE);
+    assert(FT_containsFileIn(oFT, "9r/s/5/59") == TRUE);
+    assert(FT_containsDirIn(oFT, "9r/s/6") == FALSE);
+    FT_free(oFT);
+  }
+
+  /* a batch applies its operations in path order, those on one path
+     in the order given, each with the outcome of its own call */
+  {
+    FT_T oFT;
+    struct FTOp asOps[14];
+    struct FTOpResult asResults[14];
+    const char *apcPaths[14] = {
+      "10r/d/b", "10r/d/b", "10r/d/a", "10r/d/a", "10r/d/a/x", "10r/c",
+      "10r/c", "10r/d/b", "10r/d/b", "11r", "10r//d", "10r/c", "10r/c",
+      "10r/d"
+    };
+    int aiKinds[14] = {
+      FT_OP_INSERT_FILE, FT_OP_STAT, FT_OP_INSERT_FILE, FT_OP_RM_DIR,
+      FT_OP_INSERT_DIR, FT_OP_INSERT_DIR, FT_OP_RM_FILE,
+      FT_OP_GET_FILE_CONTENTS, FT_OP_REPLACE_FILE_CONTENTS, FT_OP_STAT,
+      FT_OP_STAT, FT_OP_RM_DIR, FT_OP_STAT, FT_OP_GET_FILE_CONTENTS
+    };
+    int aiStatuses[14] = {
+      SUCCESS, SUCCESS, SUCCESS, NOT_A_DIRECTORY, NOT_A_DIRECTORY,
+      SUCCESS, NOT_A_FILE, SUCCESS, SUCCESS, CONFLICTING_PATH, BAD_PATH,
+      SUCCESS, NO_SUCH_PATH, NOT_A_FILE
+    };
+    char *pcX = "x";
+    char *pcY = "y";
+    size_t i;
+    for (i = 0; i < 14; i++) {
+      asOps[i].iKind = aiKinds[i];
+      asOps[i].pcPath = apcPaths[i];
+      asOps[i].pvContents = (i == 8) ? pcY : pcX;
+      asOps[i].ulLength = 2;
+    }
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_insertDirIn(oFT, "10r/d") == SUCCESS);
+    assert(FT_applyBatchIn(oFT, asOps, 14, asResults) == SUCCESS);
+    for (i = 0; i < 14; i++)
+      assert(asResults[i].iStatus == aiStatuses[i]);
+    assert(asResults[1].bIsFile == TRUE && asResults[1].ulSize == 2);
+    assert(asResults[7].pvContents == pcX);
+    assert(asResults[8].pvContents == pcX);
+    assert(asResults[13].pvContents == NULL);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    assert(!strcmp(temp, "10r\n10r/d\n10r/d/a\n10r/d/b\n"));
+    free(temp);
+    assert(FT_getFileContentsIn(oFT, "10r/d/b") == pcY);
+    FT_free(oFT);
+  }
+
+  /* serializing hands on what toString returns, in pieces, whatever
+     the length of the paths; a writer can stop it */
+  {
+    FT_T oFT;
+    struct Sink sSink;
+    char acPath[4000];
+    size_t i;
+    for (i = 0; i < 1999; i++) {
+      acPath[2 * i] = 'd';
+      acPath[2 * i + 1] = '/';
+    }
+    strcpy(acPath + 3998, "f");
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_serializeIn(oFT, appendPiece, &sSink) == SUCCESS);
+    assert(FT_insertDirIn(oFT, "d") == SUCCESS);
+    assert(FT_insertFileIn(oFT, acPath, NULL, 0) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "d/f", NULL, 0) == SUCCESS);
+    assert(FT_insertDirIn(oFT, "d/e/g") == SUCCESS);
+    assert((temp = FT_toStringIn(oFT)) != NULL);
+    sSink.ulCapacity = strlen(temp);
+    assert((sSink.pcData = malloc(sSink.ulCapacity)) != NULL);
+    sSink.ulLength = 0;
+    assert(FT_serializeIn(oFT, appendPiece, &sSink) == SUCCESS);
+    assert(sSink.ulLength == sSink.ulCapacity);
+    assert(!memcmp(sSink.pcData, temp, sSink.ulLength));
+    sSink.ulLength = 0;
+    sSink.ulCapacity /= 2;
+    assert(FT_serializeIn(oFT, appendPiece, &sSink) == MEMORY_ERROR);
+    assert(FT_writeToIn(oFT, -1) == FT_WRITE_ERROR);
+    free(sSink.pcData);
+    free(temp);
+    FT_free(oFT);
+  }
+
+  /* an iteration yields the nodes of a subtree in toString's order,
+     files first, and then stops */
+  {
+    FT_T oFT;
+    FTIter_T oIter;
+    const char *pcPath;
+    size_t ulSize;
+    size_t i;
+    const char *apcExpected[4] = {
+      "11r/a", "11r/a/f", "11r/a/b", "11r/a/b/g"
+    };
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_insertDirIn(oFT, "11r/a/b") == SUCCESS);
+    assert(FT_insertFileIn(oFT, "11r/a/b/g", NULL, 0) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "11r/a/f", "xyz", 4) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "11r/h", NULL, 0) == SUCCESS);
+    assert(FT_iterBeginIn(oFT, "11r/a", &oIter) == SUCCESS);
+    for (i = 0; i < 4; i++) {
+      assert(FT_iterNext(oIter, &pcPath, &bIsFile, &ulSize) == TRUE);
+      assert(!strcmp(pcPath, apcExpected[i]));
+      assert(bIsFile == (boolean) (i % 2 == 1));
+      assert(ulSize == (i == 1 ? 4 : 0));
+    }
+    assert(FT_iterNext(oIter, &pcPath, &bIsFile, &ulSize) == FALSE);
+    assert(FT_iterEnd(oIter) == SUCCESS);
+    assert(FT_iterBeginIn(oFT, "11r/h", &oIter) == SUCCESS);
+    assert(FT_iterNext(oIter, &pcPath, &bIsFile, &ulSize) == TRUE);
+    assert(!strcmp(pcPath, "11r/h") && bIsFile == TRUE);
+    assert(FT_iterNext(oIter, &pcPath, &bIsFile, &ulSize) == FALSE);
+    assert(FT_iterEnd(oIter) == SUCCESS);
+    assert(FT_iterBeginIn(oFT, "11r/x", &oIter) == NO_SUCH_PATH);
+    assert(oIter == NULL);
+    assert(FT_iterBeginIn(oFT, "11r//a", &oIter) == BAD_PATH);
+    /* the lock is released at the end, so changes go on */
+    assert(FT_rmDirIn(oFT, "11r/a") == SUCCESS);
+    FT_free(oFT);
+  }
+
+  /* a walk skips the subtrees its visitor prunes and ends where the
+     visitor stops it */
+  {
+    FT_T oFT;
+    struct Sink sSink;
+    char acVisited[100];
+    assert((oFT = FT_new()) != NULL);
+    assert(FT_insertDirIn(oFT, "12r/a/m/n") == SUCCESS);
+    assert(FT_insertFileIn(oFT, "12r/a/m/f", NULL, 0) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "12r/a/g", NULL, 0) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "12r/b/stop", "stop", 5) == SUCCESS);
+    assert(FT_insertFileIn(oFT, "12r/c/h", NULL, 0) == SUCCESS);
+    sSink.pcData = acVisited;
+    sSink.ulLength = 0;
+    sSink.ulCapacity = sizeof(acVisited);
+    assert(FT_walkIn(oFT, "12r", visitNode, &sSink) == SUCCESS);
+    assert(sSink.ulLength == strlen("12r\n12r/a\n12r/a/g\n12r/a/m\n"
+                                    "12r/b\n12r/b/stop\n"));
+    assert(!strncmp(acVisited, "12r\n12r/a\n12r/a/g\n12r/a/m\n"
+                    "12r/b\n12r/b/stop\n", sSink.ulLength));
+    sSink.ulLength = 0;
+    assert(FT_walkIn(oFT, "12r/a/m", visitNode, &sSink) == SUCCESS);
+    assert(sSink.ulLength == strlen("12r/a/m\n"));
+    assert(FT_walkIn(oFT, "12r/d", visitNode, &sSink) == NO_SUCH_PATH);
+    FT_free(oFT);
+  }
+
+  /* with a reclaim budget, a removed directory is gone at once though
+     its nodes are freed a few at a time by the changes that follow */
+  {
+    FT_T oFT;
+    assert((oFT = FT_new()) != NULL);
+    FT_setReclaimBudgetIn(oFT, 3);
+    assert(FT_insertDirIn(oFT, "13r/b/c") == SUCCESS);
+    for (l = 0; l < 40; l++) {
+      sprintf(arr, "13r/a/%02lu/f", (unsigned long) l);
+      assert(FT_insertFileIn(oFT, arr, NULL, 0) == SUCCESS);
+    }
+    assert(FT_rmDirIn(oFT, "13r/a") == SUCCESS);
+    assert(FT_containsDirIn(oFT, "13r/a") == FALSE);
+    assert(FT_containsFileIn(oFT, "13r/a/00/f") == FALSE);
+    assert(FT_insertFileIn(oFT, "13r/a/00/f", NULL, 0) == SUCCESS);
+    assert(FT_rmDirIn(oFT, "13r/b") == SUCCESS);
+    temp = FT_toStringIn(oFT);
+    assert(temp != NULL);
+    assert(!strcmp(temp, "13r\n13r/a\n13r/a/00\n13r/a/00/f\n"));
+    free(temp);
+    FT_setReclaimBudgetIn(oFT, 0);
+    assert(FT_rmDirIn(oFT, "13r") == SUCCESS);
+    assert(FT_insertDirIn(oFT, "13r") == SUCCESS);
+    assert(FT_rmDirIn(oFT, "13r") == SUCCESS);
+    FT_setReclaimBudgetIn(oFT, 1);
+    assert(FT_insertDirIn(oFT, "13r/x/y/z") == SUCCESS);
+    assert(FT_rmDirIn(oFT, "13r/x") == SUCCESS);
+    FT_free(oFT);
+  }
+
+  /* a directory's totals follow every change beneath it, in an FT that
+     keeps them and in a fine-grained one that walks for them */
+  {
+    FT_T oFT;
+    size_t ulFiles, ulDirs, ulBytes;
+    for (l = 0; l < 2; l++) {
+      assert((oFT = l == 0 ? FT_new() : FT_newFineGrained()) != NULL);
+      assert(FT_statTreeIn(oFT, "14r", &ulFiles, &ulDirs, &ulBytes)
+             == NO_SUCH_PATH);
+      assert(FT_insertDirIn(oFT, "14r/a/b") == SUCCESS);
+      assert(FT_insertFileIn(oFT, "14r/a/b/f", "abc", 3) == SUCCESS);
+      assert(FT_insertFileIn(oFT, "14r/a/g", "abcdefg", 7) == SUCCESS);
+      assert(FT_insertFileIn(oFT, "14r/c/h", NULL, 0) == SUCCESS);
+      assert(FT_statTreeIn(oFT, "14r", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 3 && ulDirs == 3 && ulBytes == 10);
+      assert(FT_statTreeIn(oFT, "14r/a", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 2 && ulDirs == 1 && ulBytes == 10);
+      assert(FT_replaceFileContentsIn(oFT, "14r/a/b/f", "a", 1) != NULL);
+      assert(FT_replaceFileContentsIn(oFT, "14r/c/h", "abcd", 40)
+             == NULL);
+      assert(FT_statTreeIn(oFT, "14r", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 3 && ulDirs == 3 && ulBytes == 48);
+      assert(FT_rmDirIn(oFT, "14r/a/b") == SUCCESS);
+      assert(FT_rmFileIn(oFT, "14r/c/h") == SUCCESS);
+      assert(FT_statTreeIn(oFT, "14r", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 1 && ulDirs == 2 && ulBytes == 7);
+      assert(FT_statTreeIn(oFT, "14r/c", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 0 && ulDirs == 0 && ulBytes == 0);
+      assert(FT_statTreeIn(oFT, "14r/a/g", &ulFiles, &ulDirs, &ulBytes)
+             == NOT_A_DIRECTORY);
+      assert(FT_statTreeIn(oFT, "14r//a", &ulFiles, &ulDirs, &ulBytes)
+             == BAD_PATH);
+      FT_free(oFT);
+    }
+  }
+
+  /* a move relinks a whole subtree at its new path, making missing
+     directories on the way, and fails as an insertion there would */
+  {
+    FT_T oFT;
+    struct FTFilterStats sStats;
+    size_t ulFiles, ulDirs, ulBytes;
+    for (l = 0; l < 2; l++) {
+      assert((oFT = l == 0 ? FT_new() : FT_newFineGrained()) != NULL);
+      assert(FT_insertDirIn(oFT, "15r/a/c") == SUCCESS);
+      assert(FT_insertFileIn(oFT, "15r/a/b/f", "abc", 4) == SUCCESS);
+      assert(FT_insertFileIn(oFT, "15r/g", NULL, 0) == SUCCESS);
+      assert(FT_renameIn(oFT, "15r/a", "15r/d/e/a2") == SUCCESS);
+      assert(FT_containsDirIn(oFT, "15r/a") == FALSE);
+      assert(FT_containsFileIn(oFT, "15r/a/b/f") == FALSE);
+      assert(FT_containsDirIn(oFT, "15r/d/e/a2/c") == TRUE);
+      assert(!strcmp(FT_getFileContentsIn(oFT, "15r/d/e/a2/b/f"),
+                     "abc"));
+      temp = FT_toStringIn(oFT);
+      assert(temp != NULL);
+      assert(!strcmp(temp, "15r\n15r/g\n15r/d\n15r/d/e\n"
+                     "15r/d/e/a2\n15r/d/e/a2/b\n15r/d/e/a2/b/f\n"
+                     "15r/d/e/a2/c\n"));
+      free(temp);
+      assert(FT_statTreeIn(oFT, "15r/d", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 1 && ulDirs == 4 && ulBytes == 4);
+
+      assert(FT_renameIn(oFT, "15r", "15r/x") == CONFLICTING_PATH);
+      assert(FT_renameIn(oFT, "15r/d", "15r/d/e/z")
+             == CONFLICTING_PATH);
+      assert(FT_renameIn(oFT, "15r/d", "16r/d") == CONFLICTING_PATH);
+      assert(FT_renameIn(oFT, "15r/a", "15r/z") == NO_SUCH_PATH);
+      assert(FT_renameIn(oFT, "15r/d", "15r/g/d") == NOT_A_DIRECTORY);
+      assert(FT_renameIn(oFT, "15r/d", "15r/g") == NOT_A_DIRECTORY);
+      assert(FT_renameIn(oFT, "15r/g", "15r/d/e") == ALREADY_IN_TREE);
+      assert(FT_renameIn(oFT, "15r/d", "15r/d") == ALREADY_IN_TREE);
+      assert(FT_renameIn(oFT, "15r/d", "15r//z") == BAD_PATH);
+      assert(FT_containsDirIn(oFT, "15r/d/e/a2") == TRUE);
+
+      /* a file moves too, keeping its contents */
+      assert(FT_renameIn(oFT, "15r/d/e/a2/b/f", "15r/f2") == SUCCESS);
+      assert(!strcmp(FT_getFileContentsIn(oFT, "15r/f2"), "abc"));
+      assert(FT_containsFileIn(oFT, "15r/d/e/a2/b/f") == FALSE);
+
+      /* lookups beneath moved directories still succeed, however
+         many moves there have been */
+      assert(FT_insertFileIn(oFT, "15r/m/f", NULL, 0) == SUCCESS);
+      for (ulFiles = 0; ulFiles < 20; ulFiles++) {
+        sprintf(arr, "15r/m%02lu", (unsigned long) ulFiles);
+        assert(FT_renameIn(oFT, "15r/m", arr) == SUCCESS);
+        strcat(arr, "/f");
+        assert(FT_containsFileIn(oFT, arr) == TRUE);
+        assert(FT_renameIn(oFT, arr, "15r/f3") == SUCCESS);
+        assert(FT_renameIn(oFT, "15r/f3", arr) == SUCCESS);
+        arr[strlen(arr) - 2] = '\0';
+        assert(FT_renameIn(oFT, arr, "15r/m") == SUCCESS);
+        assert(FT_containsFileIn(oFT, "15r/m/f") == TRUE);
+      }
+
+      /* and once more have moved than the filter can track, it is
+         rebuilt to turn misses away again */
+      FT_getFilterStatsIn(oFT, &sStats);
+      ulDirs = sStats.ulRejected;
+      ulBytes = sStats.ulFalsePositives;
+      for (ulFiles = 0; ulFiles < 10; ulFiles++) {
+        sprintf(arr, "15r/none%02lu", (unsigned long) ulFiles);
+        assert(FT_containsFileIn(oFT, arr) == FALSE);
+      }
+      FT_getFilterStatsIn(oFT, &sStats);
+      assert(l == 1 || (sStats.ulRejected == ulDirs + 10
+                        && sStats.ulFalsePositives == ulBytes));
+      FT_free(oFT);
+    }
+  }
+
+  /* a snapshot keeps the hierarchy as it was, whatever changes the FT
+     goes through after, and refuses changes of its own */
+  {
+    FT_T oFT, oFTSnap, oFTSnap2;
+    struct FTOp sOp;
+    struct FTOpResult sResult;
+    size_t ulFiles, ulDirs, ulBytes;
+    for (l = 0; l < 2; l++) {
+      assert((oFT = l == 0 ? FT_new() : FT_newConcurrent()) != NULL);
+      assert(FT_insertDirIn(oFT, "16r/a/b") == SUCCESS);
+      assert(FT_insertFileIn(oFT, "16r/a/f", "abc", 4) == SUCCESS);
+      assert(FT_insertFileIn(oFT, "16r/c/g", NULL, 0) == SUCCESS);
+      assert((oFTSnap = FT_snapshotIn(oFT)) != NULL);
+
+      assert(FT_insertFileIn(oFT, "16r/a/b/h", "xy", 2) == SUCCESS);
+      assert(FT_rmFileIn(oFT, "16r/c/g") == SUCCESS);
+      assert(FT_replaceFileContentsIn(oFT, "16r/a/f", "z", 2) != NULL);
+      assert((oFTSnap2 = FT_snapshotIn(oFTSnap)) != NULL);
+      assert(FT_renameIn(oFT, "16r/a", "16r/d/a") == SUCCESS);
+      assert(FT_rmDirIn(oFT, "16r/c") == SUCCESS);
+
+      temp = FT_toStringIn(oFTSnap);
+      assert(temp != NULL);
+      assert(!strcmp(temp, "16r\n16r/a\n16r/a/f\n16r/a/b\n16r/c\n"
+                     "16r/c/g\n"));
+      free(temp);
+      assert(!strcmp(FT_getFileContentsIn(oFTSnap, "16r/a/f"), "abc"));
+      assert(FT_containsFileIn(oFTSnap2, "16r/c/g") == TRUE);
+      assert(FT_containsDirIn(oFTSnap2, "16r/d") == FALSE);
+      assert(FT_statTreeIn(oFTSnap, "16r", &ulFiles, &ulDirs, &ulBytes)
+             == SUCCESS);
+      assert(ulFiles == 2 && ulDirs == 3 && ulBytes == 4);
+      temp = FT_toStringIn(oFT);
+      assert(temp != NULL);
+      assert(!strcmp(temp, "16r\n16r/d\n16r/d/a\n16r/d/a/f\n"
+                     "16r/d/a/b\n16r/d/a/b/h\n"));
+      free(temp);
+      assert(!strcmp(FT_getFileContentsIn(oFT, "16r/d/a/f"), "z"));
+
+      assert(FT_insertDirIn(oFTSnap, "16r/x") == FT_READ_ONLY);
+      assert(FT_rmDirIn(oFTSnap2, "16r/a") == FT_READ_ONLY);
+      assert(FT_replaceFileContentsIn(oFTSnap, "16r/a/f", "q", 2)
+             == NULL);
+      sOp.iKind = FT_OP_RM_FILE;
+      sOp.pcPath = "16r/a/f";
+      assert(FT_applyBatchIn(oFTSnap, &sOp, 1, &sResult)
+             == FT_READ_ONLY);
+      sOp.iKind = FT_OP_STAT;
+      assert(FT_applyBatchIn(oFTSnap, &sOp, 1, &sResult) == SUCCESS);
+      assert(sResult.iStatus == SUCCESS && sResult.ulSize == 4);
+      assert(FT_containsFileIn(oFTSnap, "16r/a/f") == TRUE);
+
+      /* releasing the snapshots leaves the FT as it is */
+      FT_free(oFTSnap);
+      assert(FT_containsFileIn(oFTSnap2, "16r/a/f") == TRUE);
+      FT_free(oFTSnap2);
+      assert(FT_rmDirIn(oFT, "16r/d/a/b") == SUCCESS);
+      assert(FT_containsFileIn(oFT, "16r/d/a/f") == TRUE);
+      FT_free(oFT);
+    }
+    assert((oFT = FT_newFineGrained()) != NULL);
+    assert(FT_snapshotIn(oFT) == NULL);
+    FT_free(oFT);
+    assert((oFTSnap = FT_snapshot()) != NULL);
+    FT_free(oFTSnap);
+  }
+
+  /* threads may read a snapshot while its FT changes and is
+     snapshotted again */
+  {
+    FT_T oFT, oFTSnap, oFTSnap2;
+    pthread_t aThreads[2];
+    assert((oFT = FT_newConcurrent()) != NULL);
+    assert(FT_insertDirIn(oFT, "17r") == SUCCESS);
+    for (l = 0; l < 50; l++) {
+      sprintf(arr, "17r/d%lu/f", (unsigned long) l);
+      assert(FT_insertFileIn(oFT, arr, NULL, 0) == SUCCESS);
+    }
+    assert((oFTSnap = FT_snapshotIn(oFT)) != NULL);
+    for (l = 0; l < 2; l++)
+      assert(pthread_create(&aThreads[l], NULL, readSnapshot, oFTSnap)
+             == 0);
+    for (l = 0; l < 200; l++) {
+      sprintf(arr, "17r/d%lu/f", (unsigned long) (l % 50));
+      assert(FT_insertDirIn(oFT, "17r/new") == SUCCESS);
+      assert((oFTSnap2 = FT_snapshotIn(oFT)) != NULL);
+      assert(FT_rmFileIn(oFT, arr) == SUCCESS);
+      assert(FT_renameIn(oFT, "17r/new", arr) == SUCCESS);
+      FT_free(oFTSnap2);
+      assert(FT_rmDirIn(oFT, arr) == SUCCESS);
+      assert(FT_insertFileIn(oFT, arr, NULL, 0) == SUCCESS);
+    }
+    for (l = 0; l < 2; l++)
+      assert(pthread_join(aThreads[l], NULL) == 0);
+    FT_free(oFTSnap);
+    assert(FT_containsFileIn(oFT, "17r/d49/f") == TRUE);
+    FT_free(oFT);
+  }
+
   assert(FT_destroy() == SUCCESS);
   assert(FT_destroy() == INITIALIZATION_ERROR);
   assert(FT_containsDir("1root") == FALSE);
   assert(FT_containsFile("1root") == FALSE);
   assert((temp = FT_toString()) == NULL);
+  assert(FT_bulkLoad(NULL, 0) == INITIALIZATION_ERROR);
+  assert(FT_parallelLoad(NULL, 0, 2) == INITIALIZATION_ERROR);
+  assert(FT_applyBatch(NULL, 0, NULL) == INITIALIZATION_ERROR);
+  assert(FT_serialize(appendPiece, NULL) == INITIALIZATION_ERROR);
+  assert(FT_writeTo(1) == INITIALIZATION_ERROR);
+  assert(FT_statTree("1root", &l, &l, &l) == INITIALIZATION_ERROR);
+  assert(FT_rename("1root/a", "1root/b") == INITIALIZATION_ERROR);
+  assert(FT_snapshot() == NULL);
+  {
+    FTIter_T oIter;
+    assert(FT_iterBegin("1root", &oIter) == INITIALIZATION_ERROR);
+    assert(FT_walk("1root", visitNode, NULL) == INITIALIZATION_ERROR);
+    assert(oIter == NULL);
+  }
+
+  /* the default FT can be made concurrent too */
+  assert(FT_initConcurrent() == SUCCESS);
+  assert(FT_init() == INITIALIZATION_ERROR);
+  assert(FT_initConcurrent() == INITIALIZATION_ERROR);
+  assert(FT_insertDir("1root/x") == SUCCESS);
+  assert(FT_containsDir("1root/x") == TRUE);
+  assert(FT_destroy() == SUCCESS);
+
+  assert(FT_initFineGrained() == SUCCESS);
+  assert(FT_initConcurrent() == INITIALIZATION_ERROR);
+  assert(FT_insertDir("1root/x") == SUCCESS);
+  assert(FT_insertFile("1root/x/y", "why", 4) == SUCCESS);
+  assert(FT_containsFile("1root/x/y") == TRUE);
+  assert(FT_destroy() == SUCCESS);
 
   return 0;
 }
@@ -6,7 +6,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include "dynarray.h"
+#include "dirIndex.h"
+#include "dirLock.h"
 #include "nodeFT.h"
 #include "checkerFT.h"
 
@@ -16,22 +17,62 @@
    A node in a FT that can represent either a directory or file. If the
    node represents a directory, then the subdirectories are populated.
    If the node represents a file, then contents and size are populated.
+
+   A node does not store its absolute path, only its own name: the
+   final component of that path. The name's characters and terminating
+   '\0' are allocated together with the struct, immediately after it,
+   so a node at any depth costs a single allocation of its name's
+   length. Absolute paths are rebuilt from the chain of parent links.
+   Nodes, like their child indexes, are allocated from their tree's
+   arena.
+
+   A node may be shared by several versions of a tree (see
+   NodeFT_share): it counts the references to it, one from each parent
+   index or version root that holds it, and is freed only once the
+   last is dropped. A node reached through a shared node is itself
+   shared, however few references it has, and no shared node changes.
+   Only the latest version's parent links are kept: a node's parent is
+   its parent there, so a version other than the latest is only read
+   downwards, through the children of its nodes. The latest version's
+   writers alone read or write a node's references and parent link,
+   which a shared node's other fields never depend on, so the readers
+   of other versions need not wait for them.
+
+   A directory indexes all of its children, files and directories
+   alike, in a single DirIndex_T keyed by name, so any child is found
+   with one search whatever its type; each child's bIsFile serves as
+   the type tag. The index is a sorted array while small, and once
+   wide a hash table for lookups with a B+-tree for name order.
+   Files-before-directories order is produced by NodeFT_nextChild,
+   which filters the index's name order by type.
 */
 struct NodeFT {
     /** Common Variables **/
-    /* the object corresponding to a node's absolute path */
-    Path_T oPPath;
     /* a node's parent */
     NodeFT_T oNParent;
+    /* the number of references to the node: parent indexes holding
+       it, and version roots it is */
+    size_t ulRefs;
     /* indicates whether a node is a file (TRUE) or a directory (FALSE) */
     boolean bIsFile;
+    /* the node's name: stored immediately after the struct, unless the
+       node has been renamed, which leaves the name it was made with
+       there, so that the block's size is still known */
+    char *pcName;
+    /* the totals over the subtree rooted here, this node included;
+       not kept below a directory with a lock, whose tree may be
+       changed in several places at once */
+    struct NodeFTTotals sTotals;
 
     /** Directory Variables **/
-    /* subdirectory of a node that stores files lexicographically */
-    DynArray_T oDFiles;
-    /* subdirectory of a node that stores directories
-       lexicographically */
-    DynArray_T oDDirs;
+    /* children of a node, both files and directories, indexed by
+       name */
+    DirIndex_T oIChildren;
+    /* how many of the children are files */
+    size_t ulNumFiles;
+    /* the lock guarding the children, or NULL if the tree does not
+       lock its directories */
+    DirLock_T oLock;
 
     /** File Variables **/
     /* pointer to a file contents of the node - can be null */
@@ -57,17 +98,20 @@ static int NodeFT_isValid(NodeFT_T oNNode)
 {
     if (oNNode == NULL) return 0;
 
-    /* if node is FILE, then subdirectories should be NULL */
+    /* if node is FILE, then children should be NULL */
     if (oNNode->bIsFile) {
-        if (oNNode->oDFiles != NULL || oNNode->oDDirs != NULL) return 0;
+        if (oNNode->oIChildren != NULL) return 0;
     }
-    /* if node is DIRECTORY, then subdirectories should not be NULL */
+    /* if node is DIRECTORY, then children should not be NULL, and
+       cannot include more files than children */
     else {
-        if (oNNode->oDFiles == NULL || oNNode->oDDirs == NULL) return 0;
+        if (oNNode->oIChildren == NULL) return 0;
+        if (oNNode->ulNumFiles > DirIndex_getLength(oNNode->oIChildren))
+            return 0;
     }
 
-    /* path should not be NULL */
-    if (oNNode->oPPath == NULL) return 0;
+    /* name should not be empty */
+    if (*NodeFT_getName(oNNode) == '\0') return 0;
 
     return 1;
 }
@@ -76,215 +120,180 @@ static int NodeFT_isValid(NodeFT_T oNNode)
 #endif
 
 /*
-   Compares the string representation of the absolute path of oNFirst
-   with string pcSecond (which represents another Node's path).
-
-   Returns:
-   * <0 if oNFirst is "less than" pcSecond
-   * 0 if oNFirst is "equal to" pcSecond
-   * >0 if oNFirst is "greater than" pcSecond
-
-   Precondition:
-   * oNFirst cannot be NULL
-   * pcSecond cannot be NULL
+   Returns the number of bytes allocated for a node whose name has
+   ulNameLength characters: the struct followed by the name and its
+   terminating '\0'.
 */
-static int NodeFT_compareString(const NodeFT_T oNFirst,
-                                const char *pcSecond) {
-    assert(oNFirst != NULL);
-    assert(pcSecond != NULL);
-    assert(NodeFT_isValid(oNFirst));
-
-    return Path_compareString(oNFirst->oPPath, pcSecond);
+static size_t NodeFT_blockSize(size_t ulNameLength) {
+    return sizeof(struct NodeFT) + ulNameLength + 1;
 }
 
 /*
-   Retrieves the "correct" subdirectory of oNNode based on the value of
-   bIsFile.
-
-   Returns:
-   * The FILES subdirectory of oNNode when bIsFile is TRUE
-   * The DIRS subdirectory of oNNode when bIsFile is FALSE
-
-   Preconditions:
-   * oNNode cannot be NULL
-   * oNNode is a directory node
+   Returns the name of oNNode, typed as a DirIndex_T entry.
 */
-static DynArray_T NodeFT_getChildDynArray(NodeFT_T oNNode,
-                                          boolean bIsFile) {
-    assert(oNNode != NULL);
-    assert(NodeFT_isValid(oNNode));
-    assert(NodeFT_isFile(oNNode) == FALSE);
+static const char *NodeFT_getEntryName(const void *pvNode) {
+    assert(pvNode != NULL);
 
-    if (bIsFile == TRUE)
-        return oNNode->oDFiles;
+    return NodeFT_getName((NodeFT_T) pvNode);
+}
 
-    return oNNode->oDDirs;
+/*
+   Adds *psDelta to (if bAdd) or subtracts it from the totals of oNDir
+   and of each of its ancestors, stopping at the first with a lock, or
+   at the root. Takes time proportional to the depth of oNDir.
+*/
+static void NodeFT_countUp(NodeFT_T oNDir,
+                           const struct NodeFTTotals *psDelta,
+                           boolean bAdd) {
+    assert(psDelta != NULL);
+
+    for (; oNDir != NULL && oNDir->oLock == NULL;
+         oNDir = oNDir->oNParent) {
+        if (bAdd) {
+            oNDir->sTotals.ulFiles += psDelta->ulFiles;
+            oNDir->sTotals.ulDirs += psDelta->ulDirs;
+            oNDir->sTotals.ulBytes += psDelta->ulBytes;
+        } else {
+            oNDir->sTotals.ulFiles -= psDelta->ulFiles;
+            oNDir->sTotals.ulDirs -= psDelta->ulDirs;
+            oNDir->sTotals.ulBytes -= psDelta->ulBytes;
+        }
+    }
 }
 
 /*
-   Links child oNChild into the correct subdirectory of oNParent at
-   ulIndex.
+   Returns a new, empty index for the children of a directory, in
+   oArena, or NULL if memory could not be allocated.
+*/
+static DirIndex_T NodeFT_newIndex(Arena_T oArena) {
+    assert(oArena != NULL);
 
-   Returns:
-   * SUCCESS when oNChild is correctly and successfully inserted
-   * MEMORY_ERROR if memory allocation fails for inserting oNChild
+    return DirIndex_new(
+            oArena, NodeFT_getEntryName,
+            (int (*)(const void *, const void *)) NodeFT_compare,
+            (boolean (*)(const void *)) NodeFT_isFile);
+}
 
-   Precondition:
-   * oNParent cannot be NULL
-   * oNChild cannot be NULL
-   * oNParent is a directory node
+/*
+   Releases to oArena the name of oNNode if it was given by a rename,
+   rather than stored with the node.
 */
-static int NodeFT_addChild(NodeFT_T oNParent, NodeFT_T oNChild) {
-    DynArray_T oDChildren;
-    size_t ulIndex = 0;
-
-    assert(oNParent != NULL);
-    assert(oNChild != NULL);
-    assert(NodeFT_isValid(oNParent));
-    assert(NodeFT_isFile(oNParent) == FALSE);
+static void NodeFT_releaseName(Arena_T oArena, NodeFT_T oNNode) {
+    assert(oArena != NULL);
+    assert(oNNode != NULL);
 
+    if (oNNode->pcName != (char *) (oNNode + 1))
+        Arena_release(oArena, oNNode->pcName,
+                      strlen(oNNode->pcName) + 1);
+}
 
-    oDChildren = NodeFT_getChildDynArray(oNParent, oNChild->bIsFile);
+/*
+   Pushes oNNode onto the list *poNPending of nodes NodeFT_freeRetired
+   has yet to free, linked through their parent fields, which nodes
+   about to be freed no longer need.
+*/
+static void NodeFT_pushPending(NodeFT_T oNNode, NodeFT_T *poNPending) {
+    assert(oNNode != NULL);
+    assert(poNPending != NULL);
+    assert(oNNode->ulRefs == 0);
 
-    /* get which index to add child at */
-    DynArray_bsearch(
-            oDChildren, oNChild,
-            &ulIndex,
-            (int (*)(const void *, const void *)) NodeFT_compare);
+    oNNode->oNParent = *poNPending;
+    *poNPending = oNNode;
+}
 
-    if (DynArray_addAt(oDChildren, ulIndex, oNChild))
-        return SUCCESS;
+/*
+   Drops a reference to oNNode, pushing it onto *poNPending (as
+   NodeFT_pushPending does) if that was the last. A node still
+   referenced keeps its parent link, which may be in use.
+*/
+static void NodeFT_release(NodeFT_T oNNode, NodeFT_T *poNPending) {
+    assert(oNNode != NULL);
+    assert(poNPending != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(oNNode->ulRefs > 0);
 
-    return MEMORY_ERROR;
+    if (--oNNode->ulRefs == 0)
+        NodeFT_pushPending(oNNode, poNPending);
 }
 
 /*--------------------------------------------------------------------*/
 
-int NodeFT_new(NodeFT_T oNParent, Path_T oPPath, void *pvContents,
+int NodeFT_new(Arena_T oArena, NodeFT_T oNParent, const char *pcName,
+               size_t ulNameLength, void *pvContents,
                size_t ulLength, boolean bIsFile,
                NodeFT_T *poNResult) {
     struct NodeFT *psNew;
-    Path_T oPParentPath = NULL;
-    Path_T oPNewPath = NULL;
-    size_t ulParentDepth;
-    size_t ulIndex;
+    char *pcNewName;
     int iStatus;
 
-    assert(oPPath != NULL);
+    assert(oArena != NULL);
+    assert(pcName != NULL);
+    assert(ulNameLength > 0);
+    assert(poNResult != NULL);
     assert(oNParent == NULL || NodeFT_isValid(oNParent));
     assert(oNParent == NULL || CheckerFT_Node_isValid(oNParent));
 
-    /* allocate space for a new node */
-    psNew = malloc(sizeof(struct NodeFT));
+    /* allocate space for a new node and its name */
+    psNew = Arena_alloc(oArena, NodeFT_blockSize(ulNameLength));
     if (psNew == NULL) {
-        *poNResult = NULL;
         *poNResult = NULL;
         return MEMORY_ERROR;
     }
 
-    /* set the new node's path */
-    iStatus = Path_dup(oPPath, &oPNewPath);
-    if (iStatus != SUCCESS) {
-        free(psNew);
-        *poNResult = NULL;
-        return iStatus;
-    }
-    psNew->oPPath = oPNewPath;
-
-    /* validate and set the new node's parent */
-    if (oNParent != NULL) {
-        size_t ulSharedDepth;
-
-        oPParentPath = oNParent->oPPath;
-        ulParentDepth = Path_getDepth(oPParentPath);
-        ulSharedDepth = Path_getSharedPrefixDepth(psNew->oPPath,
-                                                  oPParentPath);
-        /* parent must be an ancestor of child */
-        if (ulSharedDepth < ulParentDepth) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return CONFLICTING_PATH;
-        }
-
-        /* parent must be exactly one level up from child */
-        if (Path_getDepth(psNew->oPPath) != ulParentDepth + 1) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return NO_SUCH_PATH;
-        }
-
-        /* parent must not already have child with this path */
-        if (NodeFT_hasFile(oNParent, oPPath, &ulIndex)) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return ALREADY_IN_TREE;
-        }
-
-        /* parent must not already have child with this path */
-        if (NodeFT_hasDir(oNParent, oPPath, &ulIndex)) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return ALREADY_IN_TREE;
-        }
-    } else {
-        /* new node must be root */
-        /* can only create one "level" at a time */
-        if (Path_getDepth(psNew->oPPath) != 1) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return NO_SUCH_PATH;
-        }
-    }
+    /* set the new node's name */
+    pcNewName = (char *) (psNew + 1);
+    memcpy(pcNewName, pcName, ulNameLength);
+    pcNewName[ulNameLength] = '\0';
 
+    psNew->pcName = pcNewName;
     psNew->oNParent = oNParent;
+    psNew->ulRefs = 1;
+    psNew->sTotals.ulFiles = (size_t) (bIsFile == TRUE);
+    psNew->sTotals.ulDirs = (size_t) (bIsFile == FALSE);
+    psNew->sTotals.ulBytes = (bIsFile == TRUE) ? ulLength : 0;
 
     /* initialize node as directory */
     if (bIsFile == FALSE) {
         /* initialize the new node */
-        psNew->oDDirs = DynArray_new(0);
-        if (psNew->oDDirs == NULL) {
-            Path_free(psNew->oPPath);
-            free(psNew);
-            *poNResult = NULL;
-            return MEMORY_ERROR;
-        }
-
-        /* initialize the new node */
-        psNew->oDFiles = DynArray_new(0);
-        if (psNew->oDFiles == NULL) {
-            Path_free(psNew->oPPath);
-            free(psNew);
+        psNew->oIChildren = NodeFT_newIndex(oArena);
+        if (psNew->oIChildren == NULL) {
+            Arena_release(oArena, psNew,
+                          NodeFT_blockSize(ulNameLength));
             *poNResult = NULL;
             return MEMORY_ERROR;
         }
 
+        psNew->ulNumFiles = 0;
+        psNew->oLock = NULL;
         psNew->bIsFile = FALSE;
         psNew->pvContents = NULL;
         psNew->ulFileLength = 0;
     }
     /* initialize node as file */
     else {
-        psNew->oDFiles = NULL;
-        psNew->oDDirs = NULL;
+        psNew->oIChildren = NULL;
+        psNew->ulNumFiles = 0;
+        psNew->oLock = NULL;
         psNew->bIsFile = TRUE;
         psNew->pvContents = pvContents;
         psNew->ulFileLength = ulLength;
     }
 
-    /* link into parent's children list */
+    /* link into parent's children list, which fails if the parent
+       already has a child with this name */
     if (oNParent != NULL) {
-        iStatus = NodeFT_addChild(oNParent, psNew);
+        iStatus = DirIndex_insert(oNParent->oIChildren, psNew);
         if (iStatus != SUCCESS) {
-            Path_free(psNew->oPPath);
-            free(psNew);
+            if (bIsFile == FALSE)
+                DirIndex_free(psNew->oIChildren);
+            Arena_release(oArena, psNew,
+                          NodeFT_blockSize(ulNameLength));
             *poNResult = NULL;
             return iStatus;
         }
+        if (bIsFile == TRUE)
+            oNParent->ulNumFiles++;
+        NodeFT_countUp(oNParent, &psNew->sTotals, TRUE);
     }
 
     *poNResult = psNew;
@@ -296,86 +305,426 @@ int NodeFT_new(NodeFT_T oNParent, Path_T oPPath, void *pvContents,
     return SUCCESS;
 }
 
-size_t NodeFT_free(NodeFT_T oNNode) {
-    size_t ulIndex = 0;
-    size_t ulCount = 0;
+size_t NodeFT_free(Arena_T oArena, NodeFT_T oNNode) {
+    NodeFT_T oNPending = NULL;
 
+    assert(oArena != NULL);
     assert(oNNode != NULL);
     assert(NodeFT_isValid(oNNode));
     assert(CheckerFT_Node_isValid(oNNode));
 
-    /* remove from parent's list */
-    if (oNNode->oNParent != NULL) {
-        if (DynArray_bsearch(
-                NodeFT_getChildDynArray(oNNode->oNParent,
-                                        oNNode->bIsFile),
-                oNNode, &ulIndex,
-                (int (*)(const void *, const void *)) NodeFT_compare)
-                )
-            (void) DynArray_removeAt(
-                    NodeFT_getChildDynArray(oNNode->oNParent,
-                                            oNNode->bIsFile),
-                    ulIndex);
+    NodeFT_detach(oNNode);
+    NodeFT_retire(oNNode, &oNPending);
+    return NodeFT_freeRetired(oArena, &oNPending, (size_t) -1);
+}
+
+void NodeFT_detach(NodeFT_T oNNode) {
+    NodeFT_T oNParent;
+
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(CheckerFT_Node_isValid(oNNode));
+
+    oNParent = oNNode->oNParent;
+    if (oNParent == NULL)
+        return;
+
+    if (DirIndex_remove(oNParent->oIChildren, oNNode)
+        && oNNode->bIsFile == TRUE)
+        oNParent->ulNumFiles--;
+    oNNode->oNParent = NULL;
+    NodeFT_countUp(oNParent, &oNNode->sTotals, FALSE);
+}
+
+void NodeFT_retire(NodeFT_T oNNode, NodeFT_T *poNRetired) {
+    assert(oNNode != NULL);
+    assert(poNRetired != NULL);
+    assert(oNNode->oNParent == NULL);
+
+    NodeFT_release(oNNode, poNRetired);
+}
+
+size_t NodeFT_freeRetired(Arena_T oArena, NodeFT_T *poNRetired,
+                          size_t ulBudget) {
+    NodeFT_T oNNode;
+    NodeFT_T oNChild;
+    size_t ulLength;
+    size_t ulCount = 0;
+    size_t ulWork = 0;
+
+    assert(oArena != NULL);
+    assert(poNRetired != NULL);
+
+    /* free the nodes one at a time, parents before children: each
+       directory's children are released, and pushed onto the list if
+       no other version holds them, before its index goes, so the
+       teardown neither recurses nor allocates, and no child is
+       unlinked on its own. Releasing a child counts against the
+       budget as freeing a node does. */
+    while (*poNRetired != NULL && ulWork < ulBudget) {
+        oNNode = *poNRetired;
+        if (oNNode->bIsFile == FALSE) {
+            ulLength = DirIndex_getLength(oNNode->oIChildren);
+            if (ulLength > ulBudget - ulWork) {
+                /* too wide to empty within the budget: release its
+                   last child alone, onto the list just behind it */
+                oNChild = DirIndex_getAt(oNNode->oIChildren,
+                                         ulLength - 1);
+                (void) DirIndex_remove(oNNode->oIChildren, oNChild);
+                if (oNChild->bIsFile == TRUE)
+                    oNNode->ulNumFiles--;
+                *poNRetired = oNNode->oNParent;
+                NodeFT_release(oNChild, poNRetired);
+                oNNode->oNParent = *poNRetired;
+                *poNRetired = oNNode;
+                ulWork++;
+                continue;
+            }
+            *poNRetired = oNNode->oNParent;
+            DirIndex_map(oNNode->oIChildren,
+                         (void (*)(void *, void *)) NodeFT_release,
+                         poNRetired);
+            DirIndex_free(oNNode->oIChildren);
+            if (oNNode->oLock != NULL)
+                DirLock_free(oArena, oNNode->oLock);
+            ulWork += ulLength;
+        } else
+            *poNRetired = oNNode->oNParent;
+
+        /* free the struct node (and with it, the name it was made
+           with, and any it was given since) */
+        NodeFT_releaseName(oArena, oNNode);
+        Arena_release(oArena, oNNode,
+                      NodeFT_blockSize(strlen((char *) (oNNode + 1))));
+        ulCount++;
+        ulWork++;
     }
+    return ulCount;
+}
+
+int NodeFT_link(NodeFT_T oNParent, NodeFT_T oNChild) {
+    int iStatus;
+
+    assert(oNParent != NULL);
+    assert(oNChild != NULL);
+    assert(oNParent->bIsFile == FALSE);
+    assert(oNChild->oNParent == NULL);
+
+    iStatus = DirIndex_insert(oNParent->oIChildren, oNChild);
+    if (iStatus != SUCCESS)
+        return iStatus;
+
+    oNChild->oNParent = oNParent;
+    if (oNChild->bIsFile == TRUE)
+        oNParent->ulNumFiles++;
+    NodeFT_countUp(oNParent, &oNChild->sTotals, TRUE);
+    return SUCCESS;
+}
+
+int NodeFT_move(Arena_T oArena, NodeFT_T oNNode, NodeFT_T oNNewParent,
+                const char *pcName, size_t ulNameLength) {
+    NodeFT_T oNOldParent;
+    char *pcOldName;
+    char *pcNewName;
+    int iStatus;
+    int iRelinked;
+
+    assert(oArena != NULL);
+    assert(oNNode != NULL);
+    assert(oNNode->oNParent != NULL);
+    assert(oNNewParent != NULL);
+    assert(oNNewParent->bIsFile == FALSE);
+    assert(pcName != NULL);
+    assert(ulNameLength > 0);
+
+    oNOldParent = oNNode->oNParent;
+    pcOldName = oNNode->pcName;
+
+    /* allocate the new name before anything changes */
+    pcNewName = pcOldName;
+    if (strlen(pcOldName) != ulNameLength
+        || strncmp(pcOldName, pcName, ulNameLength) != 0) {
+        pcNewName = Arena_alloc(oArena, ulNameLength + 1);
+        if (pcNewName == NULL)
+            return MEMORY_ERROR;
+        memcpy(pcNewName, pcName, ulNameLength);
+        pcNewName[ulNameLength] = '\0';
+    }
+
+    NodeFT_detach(oNNode);
+    oNNode->pcName = pcNewName;
+    iStatus = NodeFT_link(oNNewParent, oNNode);
+    if (iStatus != SUCCESS) {
+        /* put it back: the old parent's index has just had room for it
+           freed, so relinking cannot fail */
+        if (pcNewName != pcOldName)
+            Arena_release(oArena, pcNewName, ulNameLength + 1);
+        oNNode->pcName = pcOldName;
+        iRelinked = NodeFT_link(oNOldParent, oNNode);
+        assert(iRelinked == SUCCESS);
+        (void) iRelinked;
+        return iStatus;
+    }
+
+    if (pcNewName != pcOldName) {
+        oNNode->pcName = pcOldName;
+        NodeFT_releaseName(oArena, oNNode);
+        oNNode->pcName = pcNewName;
+    }
+    return SUCCESS;
+}
+
+void NodeFT_share(NodeFT_T oNNode) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(oNNode->ulRefs > 0);
+
+    oNNode->ulRefs++;
+}
+
+boolean NodeFT_isShared(NodeFT_T oNNode) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(oNNode->ulRefs > 0);
+
+    return (boolean) (oNNode->ulRefs > 1);
+}
 
+int NodeFT_unshare(Arena_T oArena, NodeFT_T oNNode,
+                   NodeFT_T *poNResult) {
+    struct NodeFT *psCopy;
+    NodeFT_T *poNChildren = NULL;
+    struct DirIndexCursor sCursor;
+    size_t ulNameLength;
+    size_t ulLength = 0;
+    size_t i;
+
+    assert(oArena != NULL);
+    assert(oNNode != NULL);
+    assert(poNResult != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(oNNode->ulRefs > 1);
+    assert(oNNode->oLock == NULL);
+
+    *poNResult = NULL;
+
+    ulNameLength = strlen(oNNode->pcName);
+    psCopy = Arena_alloc(oArena, NodeFT_blockSize(ulNameLength));
+    if (psCopy == NULL)
+        return MEMORY_ERROR;
+    *psCopy = *oNNode;
+    psCopy->pcName = (char *) (psCopy + 1);
+    memcpy(psCopy->pcName, oNNode->pcName, ulNameLength + 1);
+    psCopy->ulRefs = 1;
+
+    /* the copy's index holds the same children, in name order */
     if (oNNode->bIsFile == FALSE) {
-        /* recursively remove FILES */
-        while (DynArray_getLength(oNNode->oDFiles) != 0) {
-            ulCount += NodeFT_free(DynArray_get(oNNode->oDFiles, 0));
+        ulLength = DirIndex_getLength(oNNode->oIChildren);
+        if (ulLength > 0)
+            poNChildren = malloc(ulLength * sizeof(NodeFT_T));
+        psCopy->oIChildren = NodeFT_newIndex(oArena);
+        if ((ulLength > 0 && poNChildren == NULL)
+            || psCopy->oIChildren == NULL) {
+            if (psCopy->oIChildren != NULL)
+                DirIndex_free(psCopy->oIChildren);
+            free(poNChildren);
+            Arena_release(oArena, psCopy,
+                          NodeFT_blockSize(ulNameLength));
+            return MEMORY_ERROR;
         }
-
-        /* recursively remove DIRECTORIES */
-        while (DynArray_getLength(oNNode->oDDirs) != 0) {
-            ulCount += NodeFT_free(DynArray_get(oNNode->oDDirs, 0));
+        DirIndex_seek(oNNode->oIChildren, NULL, 0, &sCursor);
+        for (i = 0; i < ulLength; i++)
+            poNChildren[i] = DirIndex_next(oNNode->oIChildren,
+                                           &sCursor);
+        if (DirIndex_fill(psCopy->oIChildren, (void **) poNChildren,
+                          ulLength) != SUCCESS) {
+            DirIndex_free(psCopy->oIChildren);
+            free(poNChildren);
+            Arena_release(oArena, psCopy,
+                          NodeFT_blockSize(ulNameLength));
+            return MEMORY_ERROR;
         }
-
-        DynArray_free(oNNode->oDFiles);
-        DynArray_free(oNNode->oDDirs);
+        for (i = 0; i < ulLength; i++) {
+            poNChildren[i]->ulRefs++;
+            poNChildren[i]->oNParent = psCopy;
+        }
+        free(poNChildren);
     }
 
-    /* remove path */
-    Path_free(oNNode->oPPath);
+    /* nothing can fail from here on: the copy takes the node's place
+       in its parent, which keeps the name and so the shape of its
+       index */
+    if (oNNode->oNParent != NULL)
+        DirIndex_replace(oNNode->oNParent->oIChildren, oNNode, psCopy);
+    oNNode->ulRefs--;
+    oNNode->oNParent = NULL;
 
-    /* finally, free the struct node */
-    free(oNNode);
-    ulCount++;
-    return ulCount;
+    *poNResult = psCopy;
+    assert(NodeFT_isValid(*poNResult));
+    return SUCCESS;
+}
+
+int NodeFT_setChildren(NodeFT_T oNParent, NodeFT_T *poNChildren,
+                       size_t ulNumChildren) {
+    struct NodeFTTotals sAdded = {0, 0, 0};
+    size_t i;
 
+    assert(oNParent != NULL);
+    assert(poNChildren != NULL || ulNumChildren == 0);
+    assert(oNParent->bIsFile == FALSE);
+    assert(DirIndex_getLength(oNParent->oIChildren) == 0);
+
+    if (DirIndex_fill(oNParent->oIChildren, (void **) poNChildren,
+                      ulNumChildren) != SUCCESS)
+        return MEMORY_ERROR;
+
+    for (i = 0; i < ulNumChildren; i++) {
+        assert(poNChildren[i]->oNParent == NULL);
+        assert(i == 0 || NodeFT_compare(poNChildren[i - 1],
+                                        poNChildren[i]) < 0);
+        poNChildren[i]->oNParent = oNParent;
+        if (poNChildren[i]->bIsFile == TRUE)
+            oNParent->ulNumFiles++;
+        sAdded.ulFiles += poNChildren[i]->sTotals.ulFiles;
+        sAdded.ulDirs += poNChildren[i]->sTotals.ulDirs;
+        sAdded.ulBytes += poNChildren[i]->sTotals.ulBytes;
+    }
+    NodeFT_countUp(oNParent, &sAdded, TRUE);
+
+    assert(NodeFT_isValid(oNParent));
+    return SUCCESS;
 }
 
 boolean
 NodeFT_hasFile(NodeFT_T oNParent, Path_T oPPath, size_t *pulChildId) {
+    const char *pcName;
+    size_t ulNameLength = 0;
+    NodeFT_T oNChild = NULL;
+
     assert(oNParent != NULL);
     assert(oPPath != NULL);
     assert(pulChildId != NULL);
     assert(NodeFT_isValid(oNParent));
 
-    return (DynArray_bsearch(oNParent->oDFiles,
-                             (char *) Path_getPathname(oPPath),
-                             pulChildId,
-                             (int (*)(const void *,
-                                      const void *)) NodeFT_compareString));
+    pcName = Path_getComponentSpan(oPPath, Path_getDepth(oPPath) - 1,
+                                   &ulNameLength);
+    if (!DirIndex_search(oNParent->oIChildren, pcName, ulNameLength,
+                         pulChildId))
+        return FALSE;
+    (void) NodeFT_getChildAt(oNParent, *pulChildId, &oNChild);
+    return oNChild->bIsFile;
 }
 
 boolean
 NodeFT_hasDir(NodeFT_T oNParent, Path_T oPPath, size_t *pulChildId) {
+    const char *pcName;
+    size_t ulNameLength = 0;
+    NodeFT_T oNChild = NULL;
+
     assert(oNParent != NULL);
     assert(oPPath != NULL);
     assert(pulChildId != NULL);
     assert(NodeFT_isValid(oNParent));
 
-    return (DynArray_bsearch(oNParent->oDDirs,
-                             (char *) Path_getPathname(oPPath),
-                             pulChildId,
-                             (int (*)(const void *,
-                                      const void *)) NodeFT_compareString));
+    pcName = Path_getComponentSpan(oPPath, Path_getDepth(oPPath) - 1,
+                                   &ulNameLength);
+    if (!DirIndex_search(oNParent->oIChildren, pcName, ulNameLength,
+                         pulChildId))
+        return FALSE;
+    (void) NodeFT_getChildAt(oNParent, *pulChildId, &oNChild);
+    return (boolean) !oNChild->bIsFile;
 }
 
-Path_T NodeFT_getPath(NodeFT_T oNNode) {
+NodeFT_T NodeFT_findChild(NodeFT_T oNParent, const char *pcName,
+                          size_t ulNameLength) {
+    assert(oNParent != NULL);
+    assert(pcName != NULL);
+    assert(NodeFT_isValid(oNParent));
+    assert(NodeFT_isFile(oNParent) == FALSE);
+
+    return DirIndex_find(oNParent->oIChildren, pcName, ulNameLength);
+}
+
+int NodeFT_getPath(NodeFT_T oNNode, Path_T *poPResult) {
+    char *pcPath;
+    size_t ulLength;
+    int iStatus;
+
     assert(oNNode != NULL);
+    assert(poPResult != NULL);
     assert(NodeFT_isValid(oNNode));
 
-    return oNNode->oPPath;
+    pcPath = NodeFT_toString(oNNode);
+    if (pcPath == NULL) {
+        *poPResult = NULL;
+        return MEMORY_ERROR;
+    }
+    ulLength = strlen(pcPath);
+
+    iStatus = Path_newFromBuffer(pcPath, ulLength, poPResult);
+    free(pcPath);
+    return iStatus;
+}
+
+const char *NodeFT_getName(NodeFT_T oNNode) {
+    assert(oNNode != NULL);
+
+    return oNNode->pcName;
+}
+
+size_t NodeFT_getDepth(NodeFT_T oNNode) {
+    size_t ulDepth = 0;
+
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+
+    while (oNNode != NULL) {
+        ulDepth++;
+        oNNode = oNNode->oNParent;
+    }
+    return ulDepth;
+}
+
+size_t NodeFT_getPathLength(NodeFT_T oNNode) {
+    size_t ulLength;
+
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+
+    /* each ancestor contributes its name plus a '/' delimiter */
+    ulLength = strlen(NodeFT_getName(oNNode));
+    for (oNNode = oNNode->oNParent; oNNode != NULL;
+         oNNode = oNNode->oNParent)
+        ulLength += strlen(NodeFT_getName(oNNode)) + 1;
+    return ulLength;
+}
+
+size_t NodeFT_writePath(NodeFT_T oNNode, char *pcDest) {
+    size_t ulLength;
+    size_t ulNameLength;
+    char *pcInsert;
+
+    assert(oNNode != NULL);
+    assert(pcDest != NULL);
+    assert(NodeFT_isValid(oNNode));
+
+    /* fill the string from its end, walking up towards the root */
+    ulLength = NodeFT_getPathLength(oNNode);
+    pcInsert = pcDest + ulLength;
+    *pcInsert = '\0';
+    for (;;) {
+        ulNameLength = strlen(NodeFT_getName(oNNode));
+        pcInsert -= ulNameLength;
+        memcpy(pcInsert, NodeFT_getName(oNNode), ulNameLength);
+        oNNode = oNNode->oNParent;
+        if (oNNode == NULL)
+            break;
+        pcInsert--;
+        *pcInsert = '/';
+    }
+
+    assert(pcInsert == pcDest);
+    return ulLength;
 }
 
 size_t NodeFT_getNumChildren(NodeFT_T oNParent, boolean bIsFile) {
@@ -384,8 +733,9 @@ size_t NodeFT_getNumChildren(NodeFT_T oNParent, boolean bIsFile) {
     assert(NodeFT_isFile(oNParent) == FALSE);
 
     if (bIsFile == TRUE)
-        return DynArray_getLength(oNParent->oDFiles);
-    return DynArray_getLength(oNParent->oDDirs);
+        return oNParent->ulNumFiles;
+    return DirIndex_getLength(oNParent->oIChildren)
+           - oNParent->ulNumFiles;
 }
 
 int NodeFT_getChild(NodeFT_T oNParent, size_t ulChildId,
@@ -398,11 +748,53 @@ int NodeFT_getChild(NodeFT_T oNParent, size_t ulChildId,
         *poNResult = NULL;
         return NO_SUCH_PATH;
     }
-    *poNResult = DynArray_get(
-            NodeFT_getChildDynArray(oNParent, bIsFile), ulChildId);
+
+    *poNResult = DirIndex_getAtOfType(oNParent->oIChildren, ulChildId,
+                                      bIsFile);
+    assert(*poNResult != NULL);
     return SUCCESS;
 }
 
+int NodeFT_getChildAt(NodeFT_T oNParent, size_t ulChildId,
+                      NodeFT_T *poNResult) {
+    assert(oNParent != NULL);
+    assert(NodeFT_isValid(oNParent));
+    assert(NodeFT_isFile(oNParent) == FALSE);
+    assert(poNResult != NULL);
+
+    *poNResult = DirIndex_getAt(oNParent->oIChildren, ulChildId);
+    if (*poNResult == NULL)
+        return NO_SUCH_PATH;
+    return SUCCESS;
+}
+
+void NodeFT_seekChild(NodeFT_T oNParent, const char *pcName,
+                      size_t ulNameLength,
+                      struct DirIndexCursor *psCursor) {
+    assert(oNParent != NULL);
+    assert(NodeFT_isValid(oNParent));
+    assert(NodeFT_isFile(oNParent) == FALSE);
+    assert(psCursor != NULL);
+
+    DirIndex_seek(oNParent->oIChildren, pcName, ulNameLength, psCursor);
+}
+
+NodeFT_T NodeFT_nextChild(NodeFT_T oNParent, boolean bIsFile,
+                          struct DirIndexCursor *psCursor) {
+    NodeFT_T oNChild;
+
+    assert(oNParent != NULL);
+    assert(NodeFT_isValid(oNParent));
+    assert(NodeFT_isFile(oNParent) == FALSE);
+    assert(psCursor != NULL);
+
+    while ((oNChild = DirIndex_next(oNParent->oIChildren, psCursor))
+           != NULL)
+        if (oNChild->bIsFile == bIsFile)
+            return oNChild;
+    return NULL;
+}
+
 NodeFT_T NodeFT_getParent(NodeFT_T oNNode) {
     assert(oNNode != NULL);
     assert(NodeFT_isValid(oNNode));
@@ -410,6 +802,37 @@ NodeFT_T NodeFT_getParent(NodeFT_T oNNode) {
     return oNNode->oNParent;
 }
 
+size_t NodeFT_getSubtreeSize(NodeFT_T oNNode) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+
+    return oNNode->sTotals.ulFiles + oNNode->sTotals.ulDirs;
+}
+
+void NodeFT_getTotals(NodeFT_T oNNode, struct NodeFTTotals *psTotals) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(psTotals != NULL);
+
+    *psTotals = oNNode->sTotals;
+}
+
+void NodeFT_setLock(NodeFT_T oNNode, DirLock_T oLock) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+    assert(oNNode->bIsFile == FALSE);
+    assert(oNNode->oLock == NULL);
+
+    oNNode->oLock = oLock;
+}
+
+DirLock_T NodeFT_getLock(NodeFT_T oNNode) {
+    assert(oNNode != NULL);
+    assert(NodeFT_isValid(oNNode));
+
+    return oNNode->oLock;
+}
+
 void *NodeFT_getContents(NodeFT_T oNNode) {
     assert(oNNode != NULL);
     assert(NodeFT_isValid(oNNode));
@@ -421,11 +844,23 @@ void *NodeFT_getContents(NodeFT_T oNNode) {
 void *NodeFT_setContents(NodeFT_T oNNode, void *pvContents,
                          size_t ulNewLength) {
     void *pvPrevContents;
+    struct NodeFTTotals sChange;
 
     assert(oNNode != NULL);
     assert(NodeFT_isValid(oNNode));
     assert(oNNode->bIsFile == TRUE);
 
+    /* carry the change in length up to the ancestors' totals */
+    sChange.ulFiles = 0;
+    sChange.ulDirs = 0;
+    if (ulNewLength >= oNNode->ulFileLength) {
+        sChange.ulBytes = ulNewLength - oNNode->ulFileLength;
+        NodeFT_countUp(oNNode, &sChange, TRUE);
+    } else {
+        sChange.ulBytes = oNNode->ulFileLength - ulNewLength;
+        NodeFT_countUp(oNNode, &sChange, FALSE);
+    }
+
     pvPrevContents = oNNode->pvContents;
     oNNode->pvContents = pvContents;
     oNNode->ulFileLength = ulNewLength;
@@ -453,7 +888,7 @@ int NodeFT_compare(NodeFT_T oNFirst, NodeFT_T oNSecond) {
     assert(NodeFT_isValid(oNFirst));
     assert(NodeFT_isValid(oNSecond));
 
-    return Path_comparePath(oNFirst->oPPath, oNSecond->oPPath);
+    return strcmp(NodeFT_getName(oNFirst), NodeFT_getName(oNSecond));
 }
 
 char *NodeFT_toString(NodeFT_T oNNode) {
@@ -461,10 +896,10 @@ char *NodeFT_toString(NodeFT_T oNNode) {
 
     assert(oNNode != NULL);
 
-    copyPath = malloc(Path_getStrLength(NodeFT_getPath(oNNode)) + 1);
+    copyPath = malloc(NodeFT_getPathLength(oNNode) + 1);
     if (copyPath == NULL)
         return NULL;
-    else
-        return strcpy(copyPath,
-                      Path_getPathname(NodeFT_getPath(oNNode)));
+
+    (void) NodeFT_writePath(oNNode, copyPath);
+    return copyPath;
 }
\ No newline at end of file
@@ -8,54 +8,219 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "arena.h"
+#include "dirLock.h"
+#include "dirIndex.h"
 #include "path.h"
 
 
 /* A NodeFT_T is a node in a File Tree */
 typedef struct NodeFT *NodeFT_T;
 
+/* The totals a node keeps over the subtree rooted at it */
+struct NodeFTTotals {
+    /* the number of files, the node included if it is one */
+    size_t ulFiles;
+    /* the number of directories, the node included if it is one */
+    size_t ulDirs;
+    /* the total length of the files' contents */
+    size_t ulBytes;
+};
+
 /*
-   Creates a new node with path oPPath and parent oNParent. If bIsFile
-   is TRUE, then the file characteristics - pvContents and ulLength -
-   are stored in the node.
+   Creates a new node named by the ulNameLength characters at pcName
+   (which need not be '\0'-terminated) as a child of oNParent, or as a
+   root if oNParent is NULL. The node stores only its own name and a
+   link to its parent; its absolute path is rebuilt from the chain of
+   names on demand. If bIsFile is TRUE, then the file characteristics -
+   pvContents and ulLength - are stored in the node. All of the node's
+   memory is allocated from oArena.
 
    Returns status SUCCESS and sets *poNResult to new node if successful,
    OR
    Sets *poNResult to NULL and returns status:
    * MEMORY_ERROR if memory could not be allocated to complete request
-   * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
-   * NO_SUCH_PATH if oPPath is of depth 0
-                  or oNParent's path is not oPPath's direct parent
-                  or oNParent is NULL but oPPath is not of depth 1
-   * ALREADY_IN_TREE if oNParent already has a child with this path
+   * ALREADY_IN_TREE if oNParent already has a child with this name
 
    Precondition:
-   * oNParent cannot be NULL
-   * oPPath cannot be NULL
+   * oArena cannot be NULL, and is the arena of oNParent's tree
+   * oNParent is NULL or is a directory node
+   * pcName cannot be NULL
+   * pcName is a well-formatted, non-empty component: it contains
+     neither '/' nor '\0'
 */
-int NodeFT_new(NodeFT_T oNParent, Path_T oPPath, void *pvContents,
+int NodeFT_new(Arena_T oArena, NodeFT_T oNParent, const char *pcName,
+               size_t ulNameLength, void *pvContents,
                size_t ulLength, boolean bIsFile,
                NodeFT_T *poNResult);
 
 /*
-   Destroys and frees all memory allocated for oNNode and the nodes
-   within the subtree with root oNNode.
+   Destroys and releases to oArena all memory allocated for oNNode and
+   the nodes within the subtree with root oNNode, locks included, none
+   of which may be held: NodeFT_detach, then NodeFT_freeRetired with
+   no budget. Nodes another version of the tree still shares (see
+   NodeFT_share) are only let go of, not freed. (Freeing a whole tree
+   is faster done by freeing its arena.)
 
    Returns the number of nodes "deleted".
 
+   Precondition:
+   * oArena cannot be NULL, and is the arena oNNode was allocated from
+   * oNNode cannot be NULL
+*/
+size_t NodeFT_free(Arena_T oArena, NodeFT_T oNNode);
+
+/*
+   Unlinks oNNode from its parent, if it has one, in time independent
+   of the size of oNNode's subtree, leaving oNNode the root of a tree
+   of its own. Its subtree is untouched, so no one who can no longer
+   reach it needs to wait while it is later freed with NodeFT_free.
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+void NodeFT_detach(NodeFT_T oNNode);
+
+/*
+   Drops the caller's reference to oNNode, the root of a tree of its
+   own, and adds it to the list *poNRetired of subtrees to be freed by
+   NodeFT_freeRetired, in constant time, unless another version of the
+   tree still shares it. The list is threaded through the nodes
+   themselves; *poNRetired is NULL for an empty list.
+
+   Precondition:
+   * oNNode cannot be NULL, and has no parent
+   * poNRetired cannot be NULL
+*/
+void NodeFT_retire(NodeFT_T oNNode, NodeFT_T *poNRetired);
+
+/*
+   Frees to oArena, as NodeFT_free does, nodes of the subtrees on the
+   list *poNRetired, leaving the rest on the list, and returns the
+   number freed. Freeing a node and letting go of a child of a freed
+   directory, which joins the list unless it is still shared, each
+   count one step, and no more than
+   ulBudget steps are taken, so a list may be freed a little at a time
+   in time linear in ulBudget, with neither recursion nor allocation,
+   however wide or deep the subtrees are: a directory too wide for the
+   steps left gives up its children one at a time, each in time
+   logarithmic in its width.
+
+   Precondition:
+   * oArena cannot be NULL, and is the arena the nodes were allocated
+     from
+   * poNRetired cannot be NULL
+*/
+size_t NodeFT_freeRetired(Arena_T oArena, NodeFT_T *poNRetired,
+                          size_t ulBudget);
+
+/*
+   Makes oNChild, the root of a tree of its own, a child of directory
+   oNParent, in time proportional to the depth of oNParent.
+
+   Returns SUCCESS, ALREADY_IN_TREE (leaving both unchanged) if
+   oNParent has a child of that name, or MEMORY_ERROR if memory could
+   not be allocated.
+
+   Precondition:
+   * oNParent cannot be NULL, and is a directory
+   * oNChild cannot be NULL, and has no parent
+*/
+int NodeFT_link(NodeFT_T oNParent, NodeFT_T oNChild);
+
+/*
+   Moves oNNode, with its subtree, from its parent to directory
+   oNNewParent, renaming it to the ulNameLength characters at pcName
+   (which need not be '\0'-terminated). Takes time proportional to the
+   depths of the two parents, however large the subtree: no node below
+   oNNode changes, as none stores more than its own name.
+
+   Returns SUCCESS, or, leaving oNNode where and as it was:
+   * ALREADY_IN_TREE if oNNewParent has a child of that name
+   * MEMORY_ERROR if memory could not be allocated
+
+   Precondition:
+   * oArena cannot be NULL, and is the arena of oNNode's tree
+   * oNNode cannot be NULL, and has a parent
+   * oNNewParent cannot be NULL, is a directory and does not lie in
+     the subtree of oNNode
+   * pcName cannot be NULL, and is a well-formatted, non-empty
+     component
+*/
+int NodeFT_move(Arena_T oArena, NodeFT_T oNNode, NodeFT_T oNNewParent,
+                const char *pcName, size_t ulNameLength);
+
+/*
+   Adds a reference to oNNode, on behalf of a new version of its tree
+   that has oNNode as its root and that NodeFT_retire will let go of.
+   oNNode and every node below it are then shared, and must not change
+   until unshared with NodeFT_unshare.
+
    Precondition:
    * oNNode cannot be NULL
 */
-size_t NodeFT_free(NodeFT_T oNNode);
+void NodeFT_share(NodeFT_T oNNode);
+
+/*
+   Returns TRUE if more than one reference is held to oNNode, so that
+   it may be in a version of its tree other than the latest, and FALSE
+   otherwise. A node below a shared node is shared too, whatever this
+   says of it.
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+boolean NodeFT_isShared(NodeFT_T oNNode);
+
+/*
+   Makes a copy of the shared node oNNode for the latest version of its
+   tree alone, which takes oNNode's place in its parent, if it has
+   one, and lets go of oNNode, which the other versions keep. The copy
+   of a directory has the same children, which it shares with oNNode
+   and which take it for their parent, so copying takes time linear in
+   the number of children, and the rest of the tree is not copied.
+
+   Returns SUCCESS and sets *poNResult to the copy, or, leaving
+   everything unchanged, sets *poNResult to NULL and returns
+   MEMORY_ERROR if memory could not be allocated.
+
+   Precondition:
+   * oArena cannot be NULL, and is the arena of oNNode's tree
+   * oNNode cannot be NULL, has no lock and is shared, but not its
+     parent: to change a node, unshare the shared nodes on its path
+     from the root down
+   * poNResult cannot be NULL
+*/
+int NodeFT_unshare(Arena_T oArena, NodeFT_T oNNode,
+                   NodeFT_T *poNResult);
+
+/*
+   Makes the ulNumChildren nodes at poNChildren, which must be roots of
+   trees of their own and in strictly increasing name order, the
+   children of the childless directory oNParent, indexing them all at
+   once (see DirIndex_fill).
+
+   Returns SUCCESS, or MEMORY_ERROR (leaving every node unchanged) if
+   memory could not be allocated.
+
+   Precondition:
+   * oNParent cannot be NULL, and must be a directory with no children
+   * poNChildren cannot be NULL unless ulNumChildren is 0
+*/
+int NodeFT_setChildren(NodeFT_T oNParent, NodeFT_T *poNChildren,
+                       size_t ulNumChildren);
 
 /*
    Checks whether oNParent has a child that is a FILE with path oPPath.
+   Only oPPath's final component is compared, so oPPath is assumed to
+   extend oNParent's path by exactly one level.
 
    Returns:
    * TRUE if the child exists and stores the child's identifier in
-          pulChildID (as used in Node_getChild).
-   * FALSE if it does not exist and stores the child's _would be_
-           identifier in pulChildID if it is inserted.
+          pulChildID (as used in NodeFT_getChildAt).
+   * FALSE if it does not exist and stores the identifier of the
+           child with that name if there is one of the other type, or
+           else its _would be_ identifier if it is inserted.
 
    Precondition:
    * oNParent cannot be NULL
@@ -67,13 +232,15 @@ boolean NodeFT_hasFile(NodeFT_T oNParent, Path_T oPPath,
 
 /*
    Checks whether oNParent has a child that is a DIRECTORY with path
-   oPPath.
+   oPPath. Only oPPath's final component is compared, so oPPath is
+   assumed to extend oNParent's path by exactly one level.
 
    Returns:
    * TRUE if the child exists and stores the child's identifier in
-          pulChildID (as used in Node_getChild).
-   * FALSE if it does not exist and stores the child's _would be_
-           identifier in pulChildID if it is inserted.
+          pulChildID (as used in NodeFT_getChildAt).
+   * FALSE if it does not exist and stores the identifier of the
+           child with that name if there is one of the other type, or
+           else its _would be_ identifier if it is inserted.
 
    Precondition:
    * oNParent cannot be NULL
@@ -83,14 +250,81 @@ boolean NodeFT_hasFile(NodeFT_T oNParent, Path_T oPPath,
 boolean NodeFT_hasDir(NodeFT_T oNParent, Path_T oPPath,
                       size_t *pulChildId);
 
+/*
+   Finds the child, FILE or DIRECTORY, of oNParent whose final path
+   component is the ulNameLength characters at pcName, which need not
+   be '\0'-terminated. Files and directories share one index, so this
+   is a single search, in constant expected time once the directory is
+   wide; the caller learns the child's type from NodeFT_isFile. Unlike
+   NodeFT_hasFile and NodeFT_hasDir, the caller does not need to build
+   a Path_T for the child, and no identifier is computed.
+
+   Returns the child, or NULL if oNParent has no child with that name.
+
+   Precondition:
+   * oNParent cannot be NULL
+   * oNParent is a directory node
+   * pcName cannot be NULL
+*/
+NodeFT_T NodeFT_findChild(NodeFT_T oNParent, const char *pcName,
+                          size_t ulNameLength);
+
+
+/*
+   Builds a new path object representing oNNode's absolute path from
+   the names of oNNode and its ancestors.
+
+   Returns SUCCESS and sets *poPResult to the new path, which is then
+   OWNED BY THE CALLER, or sets *poPResult to NULL and returns
+   MEMORY_ERROR if memory could not be allocated.
+
+   Precondition:
+   * oNNode cannot be NULL
+   * poPResult cannot be NULL
+*/
+int NodeFT_getPath(NodeFT_T oNNode, Path_T *poPResult);
+
+/*
+   Returns oNNode's name: the final component of its absolute path.
+   The string belongs to oNNode and lives as long as it does, or until
+   NodeFT_move renames it.
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+const char *NodeFT_getName(NodeFT_T oNNode);
+
+/*
+   Returns the depth of oNNode: 1 for a root, 2 for its children, etc.
+   Takes time proportional to that depth.
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+size_t NodeFT_getDepth(NodeFT_T oNNode);
 
 /*
-   Returns the path object representing oNNode's absolute path.
+   Returns the length (not including trailing '\0') of the string
+   representation of oNNode's absolute path. Takes time proportional
+   to oNNode's depth.
 
    Precondition:
    * oNNode cannot be NULL
 */
-Path_T NodeFT_getPath(NodeFT_T oNNode);
+size_t NodeFT_getPathLength(NodeFT_T oNNode);
+
+/*
+   Writes the string representation of oNNode's absolute path,
+   followed by a '\0', into pcDest, which must have room for at least
+   NodeFT_getPathLength(oNNode) + 1 characters.
+
+   Returns the length of the string written (not including the '\0').
+
+   Precondition:
+   * oNNode cannot be NULL
+   * pcDest cannot be NULL
+*/
+size_t NodeFT_writePath(NodeFT_T oNNode, char *pcDest);
 
 /*
    Retrieves the count of either files or directories under a oNParent
@@ -100,7 +334,7 @@ Path_T NodeFT_getPath(NodeFT_T oNNode);
    * Number of children that are FILES under oNParent has when bIsFile
      is TRUE
    * Number of children that are DIRECTORIES under oNParent has when
-     bIsFile is TRUE
+     bIsFile is FALSE
 
    Precondition:
    * oNParent cannot be NULL
@@ -112,6 +346,9 @@ size_t NodeFT_getNumChildren(NodeFT_T oNParent, boolean bIsFile);
    Retrieves the child under oNParent with identifier ulChildId based on
    the value of bIsFile. If bIsFile is TRUE, retrieves a child that is
    a FILE. If bIsFile is FALSE, retrieves a child that is a DIRECTORY.
+   Children of each type are numbered in name order from 0. Takes time
+   logarithmic in the number of children once the directory is wide;
+   to visit every child of a type, use NodeFT_nextChild instead.
 
    Returns:
    * SUCCESS status and sets *poNResult to be the retrieved child node
@@ -126,7 +363,61 @@ int NodeFT_getChild(NodeFT_T oNParent, size_t ulChildId,
                     boolean bIsFile, NodeFT_T *poNResult);
 
 /*
-   Retrieves the parent node of oNNode.
+   Retrieves the child under oNParent with identifier ulChildId, as
+   given by NodeFT_hasFile or NodeFT_hasDir. Children of both types are numbered
+   together in name order from 0, up to the sum of the two
+   NodeFT_getNumChildren counts.
+
+   Returns:
+   * SUCCESS status and sets *poNResult to be the retrieved child node
+   * NO_SUCH_PATH and sets *poNResult to NULL if ulChildID is not a
+                  valid identifier for a child
+
+   Precondition:
+   * oNParent cannot be NULL
+   * oNParent is a directory node
+   * poNResult cannot be NULL
+*/
+int NodeFT_getChildAt(NodeFT_T oNParent, size_t ulChildId,
+                      NodeFT_T *poNResult);
+
+/*
+   Sets *psCursor, for NodeFT_nextChild, to the first child of oNParent
+   whose name is not less than the ulNameLength characters at pcName
+   (which need not be '\0'-terminated), or to the first child of all if
+   pcName is NULL. Takes time logarithmic in the number of children
+   once the directory is wide.
+
+   Precondition:
+   * oNParent cannot be NULL
+   * oNParent is a directory node
+   * psCursor cannot be NULL
+*/
+void NodeFT_seekChild(NodeFT_T oNParent, const char *pcName,
+                      size_t ulNameLength,
+                      struct DirIndexCursor *psCursor);
+
+/*
+   Iterates over the children of oNParent of one type in name order,
+   from the position *psCursor given by NodeFT_seekChild: FILES if
+   bIsFile is TRUE, DIRECTORIES otherwise. *psCursor is advanced past
+   each child returned.
+
+   Returns the next child of that type, or NULL once there are none
+   left.
+
+   Precondition:
+   * oNParent cannot be NULL
+   * oNParent is a directory node
+   * psCursor cannot be NULL
+   * oNParent's children are not changed during the iteration
+*/
+NodeFT_T NodeFT_nextChild(NodeFT_T oNParent, boolean bIsFile,
+                          struct DirIndexCursor *psCursor);
+
+/*
+   Retrieves the parent node of oNNode in the latest version of its
+   tree (see NodeFT_share).
 
    Returns:
    * The parent node of oNNode if it exists
@@ -137,6 +428,48 @@ int NodeFT_getChild(NodeFT_T oNParent, size_t ulChildId,
  */
 NodeFT_T NodeFT_getParent(NodeFT_T oNNode);
 
+/*
+   Sets *psTotals to the totals over the subtree rooted at oNNode.
+   Every change through this interface, NodeFT_setContents included,
+   keeps them up to date in oNNode and its ancestors, in time
+   proportional to the depth of the change, except below a directory
+   with a lock (see NodeFT_setLock), where they are not kept.
+
+   Precondition:
+   * oNNode cannot be NULL
+   * psTotals cannot be NULL
+*/
+void NodeFT_getTotals(NodeFT_T oNNode, struct NodeFTTotals *psTotals);
+
+/*
+   Returns the number of nodes in the subtree rooted at oNNode, itself
+   included, from its totals (see NodeFT_getTotals).
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+size_t NodeFT_getSubtreeSize(NodeFT_T oNNode);
+
+/*
+   Gives DIRECTORY node oNNode oLock to guard its children. The lock
+   then belongs to oNNode, and NodeFT_free frees it with the node.
+
+   Precondition:
+   * oNNode cannot be NULL
+   * oNNode is a directory node without a lock
+   * oLock cannot be NULL, and is from the arena of oNNode's tree
+*/
+void NodeFT_setLock(NodeFT_T oNNode, DirLock_T oLock);
+
+/*
+   Returns the lock guarding the children of oNNode, or NULL if
+   oNNode is a file or a directory without one.
+
+   Precondition:
+   * oNNode cannot be NULL
+*/
+DirLock_T NodeFT_getLock(NodeFT_T oNNode);
+
 /*
    Returns the file contents of FILE node oNNode.
 
@@ -148,7 +481,8 @@ void *NodeFT_getContents(NodeFT_T oNNode);
 
 /*
    Sets the contents of a file node oNNode with new data pvContents and
-   updates the length of the contents with the value ulNewLength.
+   updates the length of the contents with the value ulNewLength, in
+   its totals and its ancestors' too.
 
    Returns the previous contents of oNNode
 
@@ -179,7 +513,8 @@ size_t NodeFT_getFileSize(NodeFT_T oNNode);
 boolean NodeFT_isFile(NodeFT_T oNNode);
 
 /*
-   Compares the two nodes oNFirst and oNSecond.
+   Compares the two nodes oNFirst and oNSecond by name. This is the
+   order of their absolute paths when they are siblings.
 
    Returns:
    * <0 if oNFirst is "less than" oNSecond
@@ -194,7 +529,8 @@ int NodeFT_compare(NodeFT_T oNFirst, NodeFT_T oNSecond);
 
 /*
    Returns:
-   * A string representation for oNNode
+   * A string representation for oNNode: its absolute path, rebuilt
+     from the names of oNNode and its ancestors
    * NULL if there is an allocation error.
 
    Allocates memory for the returned string, which is then OWNED BY
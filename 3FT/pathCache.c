@@ -0,0 +1,193 @@
+/*--------------------------------------------------------------------*/
+/* pathCache.c                                                        */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pathCache.h"
+
+/*--------------------------------------------------------------------*/
+
+/* One slot of a cache, remembering at most one path */
+struct PathCacheSlot {
+    /* the generation in which the slot was filled; the slot is empty
+       unless this equals its cache's current generation */
+    size_t ulGeneration;
+    /* the hash of the path */
+    unsigned long ulHash;
+    /* the value of the path */
+    void *pvValue;
+    /* the number of characters in the path */
+    size_t ulLength;
+    /* a copy of the path's characters, owned by the slot and kept
+       across evictions for reuse */
+    char *pcKey;
+    /* the number of bytes allocated for pcKey */
+    size_t ulKeyCapacity;
+};
+
+/* A path cache */
+struct PathCache {
+    /* the slots, a power of two of them, or NULL if there are none */
+    struct PathCacheSlot *psSlots;
+    /* the number of slots */
+    size_t ulCapacity;
+    /* the current generation, never 0; bumping it empties every slot */
+    size_t ulGeneration;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+   Returns the slot of oCache for the path given by the ulLength
+   characters at pcPath, whose hash is ulHash, if the slot currently
+   holds that path, or NULL otherwise.
+*/
+static struct PathCacheSlot *PathCache_lookup(PathCache_T oCache,
+                                              const char *pcPath,
+                                              size_t ulLength,
+                                              unsigned long ulHash) {
+    struct PathCacheSlot *psSlot;
+
+    assert(oCache != NULL);
+    assert(pcPath != NULL);
+
+    if (oCache->ulCapacity == 0)
+        return NULL;
+
+    psSlot = &oCache->psSlots[ulHash & (oCache->ulCapacity - 1)];
+    if (psSlot->ulGeneration != oCache->ulGeneration
+        || psSlot->ulHash != ulHash || psSlot->ulLength != ulLength
+        || memcmp(psSlot->pcKey, pcPath, ulLength) != 0)
+        return NULL;
+    return psSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+PathCache_T PathCache_new(size_t ulCapacity) {
+    PathCache_T oCache;
+    size_t ulSlots = 0;
+
+    oCache = malloc(sizeof(struct PathCache));
+    if (oCache == NULL)
+        return NULL;
+
+    /* round down to a power of two so a hash picks a slot by masking */
+    if (ulCapacity > 0) {
+        ulSlots = 1;
+        while (ulSlots <= ulCapacity / 2)
+            ulSlots *= 2;
+    }
+
+    oCache->psSlots = NULL;
+    if (ulSlots > 0) {
+        /* all-zero slots are empty: no generation is 0 */
+        oCache->psSlots = calloc(ulSlots, sizeof(struct PathCacheSlot));
+        if (oCache->psSlots == NULL) {
+            free(oCache);
+            return NULL;
+        }
+    }
+    oCache->ulCapacity = ulSlots;
+    oCache->ulGeneration = 1;
+
+    return oCache;
+}
+
+void PathCache_free(PathCache_T oCache) {
+    size_t i;
+
+    assert(oCache != NULL);
+
+    for (i = 0; i < oCache->ulCapacity; i++)
+        free(oCache->psSlots[i].pcKey);
+    free(oCache->psSlots);
+    free(oCache);
+}
+
+size_t PathCache_getCapacity(PathCache_T oCache) {
+    assert(oCache != NULL);
+
+    return oCache->ulCapacity;
+}
+
+void *PathCache_get(PathCache_T oCache, const char *pcPath,
+                    size_t ulLength, unsigned long ulHash) {
+    struct PathCacheSlot *psSlot;
+
+    assert(oCache != NULL);
+    assert(pcPath != NULL);
+
+    if (oCache->ulCapacity == 0)
+        return NULL;
+
+    psSlot = PathCache_lookup(oCache, pcPath, ulLength, ulHash);
+    if (psSlot == NULL)
+        return NULL;
+    return psSlot->pvValue;
+}
+
+void PathCache_put(PathCache_T oCache, const char *pcPath,
+                   size_t ulLength, unsigned long ulHash,
+                   void *pvValue) {
+    struct PathCacheSlot *psSlot;
+
+    assert(oCache != NULL);
+    assert(pcPath != NULL);
+    assert(pvValue != NULL);
+
+    if (oCache->ulCapacity == 0)
+        return;
+
+    psSlot = &oCache->psSlots[ulHash & (oCache->ulCapacity - 1)];
+
+    /* evict the slot's path, growing its key buffer if needed */
+    if (psSlot->ulKeyCapacity < ulLength) {
+        char *pcKey = realloc(psSlot->pcKey, ulLength);
+        if (pcKey == NULL) {
+            psSlot->ulGeneration = 0;
+            return;
+        }
+        psSlot->pcKey = pcKey;
+        psSlot->ulKeyCapacity = ulLength;
+    }
+
+    memcpy(psSlot->pcKey, pcPath, ulLength);
+    psSlot->ulLength = ulLength;
+    psSlot->ulHash = ulHash;
+    psSlot->pvValue = pvValue;
+    psSlot->ulGeneration = oCache->ulGeneration;
+}
+
+void PathCache_remove(PathCache_T oCache, const char *pcPath,
+                      size_t ulLength, unsigned long ulHash) {
+    struct PathCacheSlot *psSlot;
+
+    assert(oCache != NULL);
+    assert(pcPath != NULL);
+
+    if (oCache->ulCapacity == 0)
+        return;
+
+    psSlot = PathCache_lookup(oCache, pcPath, ulLength, ulHash);
+    if (psSlot != NULL)
+        psSlot->ulGeneration = 0;
+}
+
+void PathCache_clear(PathCache_T oCache) {
+    size_t i;
+
+    assert(oCache != NULL);
+
+    oCache->ulGeneration++;
+
+    /* the generation wrapped around: empty the slots the slow way */
+    if (oCache->ulGeneration == 0) {
+        for (i = 0; i < oCache->ulCapacity; i++)
+            oCache->psSlots[i].ulGeneration = 0;
+        oCache->ulGeneration = 1;
+    }
+}
@@ -0,0 +1,99 @@
+/*--------------------------------------------------------------------*/
+/* pathCache.h                                                        */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATHCACHE_INCLUDED
+#define PATHCACHE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+   A PathCache_T remembers, for a bounded number of absolute paths, the
+   value (typically a node) each path was last found to name, so that a
+   repeated lookup of a hot path costs one hash probe instead of a walk
+   down the hierarchy. It is direct-mapped: each path hashes to exactly
+   one slot, and a newly remembered path evicts whatever that slot held.
+   A cache only ever holds hints; the owner must forget or invalidate a
+   path whenever the value it names goes away.
+
+   The owner also supplies each path's hash, so that a hash it needs
+   for other purposes too is computed only once. Any function of a
+   path's characters will do, provided it is the same for every call
+   on one cache.
+*/
+typedef struct PathCache *PathCache_T;
+
+/*
+   Returns a new, empty cache of at most ulCapacity paths (rounded down
+   to a power of two), or NULL if memory could not be allocated. A
+   capacity of 0 gives a cache that never remembers anything.
+*/
+PathCache_T PathCache_new(size_t ulCapacity);
+
+/*
+   Frees oCache and the copies of the paths it holds. The values
+   themselves are not freed.
+
+   Precondition:
+   * oCache cannot be NULL
+*/
+void PathCache_free(PathCache_T oCache);
+
+/*
+   Returns the number of paths oCache can hold at once.
+
+   Precondition:
+   * oCache cannot be NULL
+*/
+size_t PathCache_getCapacity(PathCache_T oCache);
+
+/*
+   Returns the value oCache holds for the path given by the ulLength
+   characters at pcPath, which need not be '\0'-terminated, and whose
+   hash is ulHash, or NULL if it holds none.
+
+   Precondition:
+   * oCache cannot be NULL
+   * pcPath cannot be NULL
+*/
+void *PathCache_get(PathCache_T oCache, const char *pcPath,
+                    size_t ulLength, unsigned long ulHash);
+
+/*
+   Remembers pvValue as the value of the path given by the ulLength
+   characters at pcPath, which need not be '\0'-terminated, and whose
+   hash is ulHash. The characters are copied. If memory for the copy
+   could not be allocated the path is simply not remembered.
+
+   Precondition:
+   * oCache cannot be NULL
+   * pcPath cannot be NULL
+   * pvValue cannot be NULL
+*/
+void PathCache_put(PathCache_T oCache, const char *pcPath,
+                   size_t ulLength, unsigned long ulHash,
+                   void *pvValue);
+
+/*
+   Forgets the path given by the ulLength characters at pcPath, which
+   need not be '\0'-terminated, and whose hash is ulHash, if oCache
+   holds it.
+
+   Precondition:
+   * oCache cannot be NULL
+   * pcPath cannot be NULL
+*/
+void PathCache_remove(PathCache_T oCache, const char *pcPath,
+                      size_t ulLength, unsigned long ulHash);
+
+/*
+   Forgets every path oCache holds, in constant time.
+
+   Precondition:
+   * oCache cannot be NULL
+*/
+void PathCache_clear(PathCache_T oCache);
+
+#endif
@@ -0,0 +1,203 @@
+/*--------------------------------------------------------------------*/
+/* pathFilter.c                                                       */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "pathFilter.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The number of bits in one word of a filter's bit array */
+enum { PATHFILTER_WORD_BITS = CHAR_BIT * sizeof(unsigned long) };
+
+/* The number of bits in one block, a cache line's worth */
+enum { PATHFILTER_BLOCK_BITS = 512 };
+
+/* The number of bits of seed that pick one probe's bit in a block */
+enum { PATHFILTER_PROBE_SHIFT = 9 };
+
+/* A Bloom filter */
+struct PathFilter {
+    /* the bit array, ulNumBits / PATHFILTER_WORD_BITS words of it */
+    unsigned long *pulBits;
+    /* the number of bits, a power of two no smaller than one block */
+    size_t ulNumBits;
+    /* the number of bits that are set */
+    size_t ulNumSet;
+    /* the number of paths the filter was sized for */
+    size_t ulCapacity;
+    /* the number of paths added */
+    size_t ulLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+   Returns the index in the bit array of oFilter of the first word of
+   the block that holds every bit probed for the path whose hash is
+   ulHash. Keeping all of a path's probes within one block of a cache
+   line means a query touches one line of memory, not one per probe.
+*/
+static size_t PathFilter_block(PathFilter_T oFilter,
+                               unsigned long ulHash) {
+    size_t ulNumBlocks;
+
+    assert(oFilter != NULL);
+
+    ulNumBlocks = oFilter->ulNumBits / PATHFILTER_BLOCK_BITS;
+    return (size_t) (ulHash & (ulNumBlocks - 1))
+           * (PATHFILTER_BLOCK_BITS / PATHFILTER_WORD_BITS);
+}
+
+/*
+   Returns the seed from which the bits probed within a block for the
+   path whose hash is ulHash are drawn: bits the block index does not
+   use, mixed so that each probe gets a fresh few of them.
+*/
+static unsigned long PathFilter_seed(unsigned long ulHash) {
+    ulHash ^= ulHash >> 15;
+    ulHash *= 2654435761UL;
+    return ulHash ^ (ulHash >> 13);
+}
+
+/*--------------------------------------------------------------------*/
+
+PathFilter_T PathFilter_new(size_t ulPaths) {
+    PathFilter_T oFilter;
+    size_t ulNumBits = PATHFILTER_BLOCK_BITS;
+
+    oFilter = malloc(sizeof(struct PathFilter));
+    if (oFilter == NULL)
+        return NULL;
+
+    /* round up to a power of two so a probe picks a bit by masking */
+    while (ulNumBits / PATHFILTER_BITS < ulPaths)
+        ulNumBits *= 2;
+
+    oFilter->pulBits = calloc(ulNumBits / PATHFILTER_WORD_BITS,
+                              sizeof(unsigned long));
+    if (oFilter->pulBits == NULL) {
+        free(oFilter);
+        return NULL;
+    }
+    oFilter->ulNumBits = ulNumBits;
+    oFilter->ulNumSet = 0;
+    oFilter->ulCapacity = ulPaths;
+    oFilter->ulLength = 0;
+
+    return oFilter;
+}
+
+void PathFilter_free(PathFilter_T oFilter) {
+    assert(oFilter != NULL);
+
+    free(oFilter->pulBits);
+    free(oFilter);
+}
+
+unsigned long PathFilter_hash(const char *pcPath, size_t ulLength) {
+    assert(pcPath != NULL);
+
+    /* FNV-1a, which can be continued piecewise */
+    return PathFilter_extendHash(2166136261UL, pcPath, ulLength);
+}
+
+unsigned long PathFilter_extendHash(unsigned long ulHash,
+                                    const char *pcMore,
+                                    size_t ulLength) {
+    size_t i;
+
+    assert(pcMore != NULL);
+
+    for (i = 0; i < ulLength; i++) {
+        ulHash ^= (unsigned char) pcMore[i];
+        ulHash *= 16777619UL;
+    }
+    return ulHash;
+}
+
+void PathFilter_add(PathFilter_T oFilter, unsigned long ulHash) {
+    unsigned long *pulBlock;
+    unsigned long ulSeed;
+    unsigned long ulMask;
+    size_t ulBit;
+    int i;
+
+    assert(oFilter != NULL);
+
+    pulBlock = &oFilter->pulBits[PathFilter_block(oFilter, ulHash)];
+    ulSeed = PathFilter_seed(ulHash);
+    for (i = 0; i < PATHFILTER_PROBES; i++) {
+        ulBit = (size_t) (ulSeed & (PATHFILTER_BLOCK_BITS - 1));
+        ulMask = 1UL << (ulBit % PATHFILTER_WORD_BITS);
+        if ((pulBlock[ulBit / PATHFILTER_WORD_BITS] & ulMask) == 0) {
+            pulBlock[ulBit / PATHFILTER_WORD_BITS] |= ulMask;
+            oFilter->ulNumSet++;
+        }
+        ulSeed = (ulSeed >> PATHFILTER_PROBE_SHIFT)
+                 | (ulSeed << (PATHFILTER_WORD_BITS
+                               - PATHFILTER_PROBE_SHIFT));
+        ulSeed *= 2654435761UL;
+    }
+    oFilter->ulLength++;
+}
+
+boolean PathFilter_mayContain(PathFilter_T oFilter,
+                              unsigned long ulHash) {
+    const unsigned long *pulBlock;
+    unsigned long ulSeed;
+    size_t ulBit;
+    int i;
+
+    assert(oFilter != NULL);
+
+    pulBlock = &oFilter->pulBits[PathFilter_block(oFilter, ulHash)];
+    ulSeed = PathFilter_seed(ulHash);
+    for (i = 0; i < PATHFILTER_PROBES; i++) {
+        ulBit = (size_t) (ulSeed & (PATHFILTER_BLOCK_BITS - 1));
+        if ((pulBlock[ulBit / PATHFILTER_WORD_BITS]
+             & (1UL << (ulBit % PATHFILTER_WORD_BITS))) == 0)
+            return FALSE;
+        ulSeed = (ulSeed >> PATHFILTER_PROBE_SHIFT)
+                 | (ulSeed << (PATHFILTER_WORD_BITS
+                               - PATHFILTER_PROBE_SHIFT));
+        ulSeed *= 2654435761UL;
+    }
+    return TRUE;
+}
+
+size_t PathFilter_getLength(PathFilter_T oFilter) {
+    assert(oFilter != NULL);
+
+    return oFilter->ulLength;
+}
+
+size_t PathFilter_getCapacity(PathFilter_T oFilter) {
+    assert(oFilter != NULL);
+
+    return oFilter->ulCapacity;
+}
+
+size_t PathFilter_getNumBits(PathFilter_T oFilter) {
+    assert(oFilter != NULL);
+
+    return oFilter->ulNumBits;
+}
+
+double PathFilter_getFalsePositiveRate(PathFilter_T oFilter) {
+    double dFill;
+    double dRate = 1.0;
+    int i;
+
+    assert(oFilter != NULL);
+
+    /* an absent path passes only if every one of its probes lands on
+       a set bit */
+    dFill = (double) oFilter->ulNumSet / (double) oFilter->ulNumBits;
+    for (i = 0; i < PATHFILTER_PROBES; i++)
+        dRate *= dFill;
+    return dRate;
+}
@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* pathFilter.h                                                       */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATHFILTER_INCLUDED
+#define PATHFILTER_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+   A PathFilter_T is a Bloom filter over a set of absolute paths: it
+   answers whether a path may be in the set, with no false negatives
+   and a small rate of false positives, using about PATHFILTER_BITS
+   bits per path it was sized for. The filter is blocked: all the bits
+   of one path lie in the same cache line, so a query costs at most one
+   cache miss. Paths cannot be taken out of a filter; a set that
+   shrinks must be rebuilt into a new filter.
+
+   Paths are given to a filter by hash, as computed by PathFilter_hash
+   and PathFilter_extendHash, so a caller may hash a path piecewise,
+   e.g. a parent's path once and then each child's name after it.
+*/
+typedef struct PathFilter *PathFilter_T;
+
+/* The number of bits a filter devotes to each path it is sized for */
+enum { PATHFILTER_BITS = 10 };
+
+/* The number of bits a filter sets for each path */
+enum { PATHFILTER_PROBES = 7 };
+
+/*
+   Returns a new, empty filter sized for ulPaths paths, or NULL if
+   memory could not be allocated.
+*/
+PathFilter_T PathFilter_new(size_t ulPaths);
+
+/*
+   Frees oFilter.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+void PathFilter_free(PathFilter_T oFilter);
+
+/*
+   Returns the hash of the ulLength characters at pcPath, which need
+   not be '\0'-terminated.
+
+   Precondition:
+   * pcPath cannot be NULL
+*/
+unsigned long PathFilter_hash(const char *pcPath, size_t ulLength);
+
+/*
+   Returns the hash of the characters whose hash is ulHash followed by
+   the ulLength characters at pcMore, which need not be '\0'-terminated.
+
+   Precondition:
+   * pcMore cannot be NULL
+*/
+unsigned long PathFilter_extendHash(unsigned long ulHash,
+                                    const char *pcMore,
+                                    size_t ulLength);
+
+/*
+   Adds the path whose hash is ulHash to oFilter.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+void PathFilter_add(PathFilter_T oFilter, unsigned long ulHash);
+
+/*
+   Returns FALSE if the path whose hash is ulHash was certainly never
+   added to oFilter, and TRUE if it may have been.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+boolean PathFilter_mayContain(PathFilter_T oFilter,
+                              unsigned long ulHash);
+
+/*
+   Returns the number of paths added to oFilter, counting repeats.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+size_t PathFilter_getLength(PathFilter_T oFilter);
+
+/*
+   Returns the number of paths oFilter was sized for.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+size_t PathFilter_getCapacity(PathFilter_T oFilter);
+
+/*
+   Returns the number of bits in oFilter.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+size_t PathFilter_getNumBits(PathFilter_T oFilter);
+
+/*
+   Returns the probability that oFilter answers TRUE for a path that
+   was never added to it, estimated from the fraction of its bits that
+   are set.
+
+   Precondition:
+   * oFilter cannot be NULL
+*/
+double PathFilter_getFalsePositiveRate(PathFilter_T oFilter);
+
+#endif
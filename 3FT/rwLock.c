@@ -0,0 +1,256 @@
+/*--------------------------------------------------------------------*/
+/* rwLock.c                                                           */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "rwLock.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Slots are laid out in multiples of this many bytes, and start on
+   such a boundary, so no two share a cache line */
+enum { RWLOCK_CACHE_LINE = 64 };
+
+/* A slot's private data starts this many bytes into the slot, past
+   the mutex, suitably aligned for any type */
+enum {
+    RWLOCK_DATA_OFFSET = (sizeof(pthread_mutex_t) + 15) / 16 * 16
+};
+
+/* A reader-writer lock */
+struct RWLock {
+    /* the slots, each a mutex followed by its private data */
+    char *pcSlots;
+    /* the block pcSlots was carved from, to be freed */
+    void *pvBlock;
+    /* the number of bytes from one slot to the next */
+    size_t ulStride;
+    /* the number of slots */
+    size_t ulNumSlots;
+    /* the mutex a writer holds throughout, keeping other writers out
+       even while it lets readers in */
+    pthread_mutex_t sWriterMutex;
+    /* whether the writer holding sWriterMutex has let readers in,
+       guarded by sWriterMutex */
+    int iShared;
+};
+
+/* The key under which each thread keeps its number plus one; 0 (a NULL
+   value) means the thread has not been numbered yet */
+static pthread_key_t sThreadKey;
+
+/* Makes sThreadKey exactly once */
+static pthread_once_t sThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+/* The number given to the most recently numbered thread, and the mutex
+   guarding it */
+static size_t ulLastThread;
+static pthread_mutex_t sLastThreadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------*/
+
+/*
+   Makes sThreadKey.
+*/
+static void RWLock_makeThreadKey(void) {
+    (void) pthread_key_create(&sThreadKey, NULL);
+}
+
+/*
+   Returns the number of the calling thread, numbering it on its first
+   call. Threads are numbered 0, 1, 2, ... in order of first call, so
+   consecutive threads land on different slots.
+*/
+static size_t RWLock_getThreadNumber(void) {
+    void *pvNumber;
+    size_t ulNumber;
+
+    (void) pthread_once(&sThreadKeyOnce, RWLock_makeThreadKey);
+    pvNumber = pthread_getspecific(sThreadKey);
+    if (pvNumber != NULL)
+        return (size_t) pvNumber - 1;
+
+    (void) pthread_mutex_lock(&sLastThreadMutex);
+    ulNumber = ulLastThread++;
+    (void) pthread_mutex_unlock(&sLastThreadMutex);
+
+    (void) pthread_setspecific(sThreadKey, (void *) (ulNumber + 1));
+    return ulNumber;
+}
+
+/*
+   Returns the mutex of slot ulSlot of oLock.
+*/
+static pthread_mutex_t *RWLock_getMutex(RWLock_T oLock, size_t ulSlot) {
+    assert(oLock != NULL);
+    assert(ulSlot < oLock->ulNumSlots);
+
+    return (pthread_mutex_t *) (oLock->pcSlots
+                                + ulSlot * oLock->ulStride);
+}
+
+/*--------------------------------------------------------------------*/
+
+RWLock_T RWLock_new(size_t ulSlots, size_t ulDataSize) {
+    RWLock_T oLock;
+    size_t ulMisalignment;
+    size_t i;
+
+    if (ulSlots == 0) {
+        long lProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+        ulSlots = (lProcessors > 0) ? (size_t) lProcessors : 1;
+    }
+
+    oLock = malloc(sizeof(struct RWLock));
+    if (oLock == NULL)
+        return NULL;
+
+    oLock->ulStride = (RWLOCK_DATA_OFFSET + ulDataSize
+                       + RWLOCK_CACHE_LINE - 1)
+                      / RWLOCK_CACHE_LINE * RWLOCK_CACHE_LINE;
+    oLock->ulNumSlots = ulSlots;
+    oLock->pvBlock = calloc(ulSlots * oLock->ulStride
+                            + RWLOCK_CACHE_LINE, 1);
+    if (oLock->pvBlock == NULL) {
+        free(oLock);
+        return NULL;
+    }
+
+    /* start the first slot on a cache line boundary */
+    oLock->pcSlots = oLock->pvBlock;
+    ulMisalignment = (size_t) oLock->pcSlots % RWLOCK_CACHE_LINE;
+    if (ulMisalignment != 0)
+        oLock->pcSlots += RWLOCK_CACHE_LINE - ulMisalignment;
+
+    if (pthread_mutex_init(&oLock->sWriterMutex, NULL) != 0) {
+        free(oLock->pvBlock);
+        free(oLock);
+        return NULL;
+    }
+    oLock->iShared = 0;
+
+    for (i = 0; i < ulSlots; i++) {
+        if (pthread_mutex_init(RWLock_getMutex(oLock, i), NULL) != 0) {
+            while (i > 0)
+                (void) pthread_mutex_destroy(RWLock_getMutex(oLock,
+                                                             --i));
+            (void) pthread_mutex_destroy(&oLock->sWriterMutex);
+            free(oLock->pvBlock);
+            free(oLock);
+            return NULL;
+        }
+    }
+
+    return oLock;
+}
+
+void RWLock_free(RWLock_T oLock) {
+    size_t i;
+
+    assert(oLock != NULL);
+
+    for (i = 0; i < oLock->ulNumSlots; i++)
+        (void) pthread_mutex_destroy(RWLock_getMutex(oLock, i));
+    (void) pthread_mutex_destroy(&oLock->sWriterMutex);
+    free(oLock->pvBlock);
+    free(oLock);
+}
+
+size_t RWLock_getNumSlots(RWLock_T oLock) {
+    assert(oLock != NULL);
+
+    return oLock->ulNumSlots;
+}
+
+void *RWLock_getSlotData(RWLock_T oLock, size_t ulSlot) {
+    assert(oLock != NULL);
+    assert(ulSlot < oLock->ulNumSlots);
+
+    return oLock->pcSlots + ulSlot * oLock->ulStride
+           + RWLOCK_DATA_OFFSET;
+}
+
+void *RWLock_readLock(RWLock_T oLock) {
+    size_t ulSlot;
+
+    assert(oLock != NULL);
+
+    ulSlot = RWLock_getThreadNumber() % oLock->ulNumSlots;
+    (void) pthread_mutex_lock(RWLock_getMutex(oLock, ulSlot));
+    return RWLock_getSlotData(oLock, ulSlot);
+}
+
+void RWLock_readUnlock(RWLock_T oLock, void *pvData) {
+    size_t ulSlot;
+
+    assert(oLock != NULL);
+    assert(pvData != NULL);
+
+    ulSlot = (size_t) ((char *) pvData - oLock->pcSlots)
+             / oLock->ulStride;
+    (void) pthread_mutex_unlock(RWLock_getMutex(oLock, ulSlot));
+}
+
+/*
+   Locks every slot of oLock, in order, so that two writers could not
+   deadlock even without sWriterMutex.
+*/
+static void RWLock_lockSlots(RWLock_T oLock) {
+    size_t i;
+
+    assert(oLock != NULL);
+
+    for (i = 0; i < oLock->ulNumSlots; i++)
+        (void) pthread_mutex_lock(RWLock_getMutex(oLock, i));
+}
+
+/*
+   Unlocks every slot of oLock.
+*/
+static void RWLock_unlockSlots(RWLock_T oLock) {
+    size_t i;
+
+    assert(oLock != NULL);
+
+    for (i = oLock->ulNumSlots; i > 0; i--)
+        (void) pthread_mutex_unlock(RWLock_getMutex(oLock, i - 1));
+}
+
+void RWLock_writeLock(RWLock_T oLock) {
+    assert(oLock != NULL);
+
+    (void) pthread_mutex_lock(&oLock->sWriterMutex);
+    RWLock_lockSlots(oLock);
+    oLock->iShared = 0;
+}
+
+void RWLock_writeShare(RWLock_T oLock) {
+    assert(oLock != NULL);
+    assert(!oLock->iShared);
+
+    oLock->iShared = 1;
+    RWLock_unlockSlots(oLock);
+}
+
+void RWLock_writeExclude(RWLock_T oLock) {
+    assert(oLock != NULL);
+    assert(oLock->iShared);
+
+    RWLock_lockSlots(oLock);
+    oLock->iShared = 0;
+}
+
+void RWLock_writeUnlock(RWLock_T oLock) {
+    assert(oLock != NULL);
+
+    if (!oLock->iShared)
+        RWLock_unlockSlots(oLock);
+    oLock->iShared = 0;
+    (void) pthread_mutex_unlock(&oLock->sWriterMutex);
+}
@@ -0,0 +1,125 @@
+/*--------------------------------------------------------------------*/
+/* rwLock.h                                                           */
+/* Author: Praneeth Bhandaru                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef RWLOCK_INCLUDED
+#define RWLOCK_INCLUDED
+
+#include <stddef.h>
+
+/*
+   An RWLock_T is a reader-writer lock built to let many reader threads
+   in at once without contending with each other: it is split into
+   slots, about one per core, each a mutex on its own cache line. A
+   reader locks just the slot of its thread, so readers on different
+   slots share no memory; a writer locks every slot, in order.
+
+   Each slot also carries a block of private data of a size fixed when
+   the lock is made. A reader has the block of its slot to itself for
+   as long as it holds the slot, which makes it a place for per-reader
+   state such as caches and counters; a writer, holding every slot,
+   may touch every block.
+
+   A writer may also let readers back in part-way through, while still
+   keeping other writers out, to do slow work that only reads what the
+   lock guards (or touches what readers can no longer reach) without
+   stalling them.
+*/
+typedef struct RWLock *RWLock_T;
+
+/*
+   Returns a new, unlocked lock with ulSlots slots (or one slot per
+   online processor if ulSlots is 0), each with ulDataSize bytes of
+   zero-filled private data, or NULL if memory or mutexes could not be
+   allocated.
+*/
+RWLock_T RWLock_new(size_t ulSlots, size_t ulDataSize);
+
+/*
+   Frees oLock, which must be unlocked, with the private data of its
+   slots.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void RWLock_free(RWLock_T oLock);
+
+/*
+   Returns the number of slots of oLock.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+size_t RWLock_getNumSlots(RWLock_T oLock);
+
+/*
+   Returns the private data of slot ulSlot of oLock. The caller must
+   hold that slot, or all of them, to touch the data.
+
+   Precondition:
+   * oLock cannot be NULL
+   * ulSlot is less than the number of slots of oLock
+*/
+void *RWLock_getSlotData(RWLock_T oLock, size_t ulSlot);
+
+/*
+   Locks oLock for reading by the calling thread, waiting for any
+   writer to finish first, and returns the private data of the slot it
+   holds. The thread must pass the data to RWLock_readUnlock to unlock.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void *RWLock_readLock(RWLock_T oLock);
+
+/*
+   Unlocks oLock for reading by the calling thread. pvData must be what
+   the matching RWLock_readLock returned.
+
+   Precondition:
+   * oLock cannot be NULL
+   * pvData cannot be NULL
+*/
+void RWLock_readUnlock(RWLock_T oLock, void *pvData);
+
+/*
+   Locks oLock for writing, waiting for all readers and any writer to
+   finish first.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void RWLock_writeLock(RWLock_T oLock);
+
+/*
+   Lets readers back into oLock, which the calling thread holds for
+   writing, while still keeping other writers out. Until it calls
+   RWLock_writeExclude, the caller may only read what the lock guards,
+   or change what no reader can reach.
+
+   Precondition:
+   * oLock cannot be NULL
+   * oLock is locked for writing, and readers are shut out
+*/
+void RWLock_writeShare(RWLock_T oLock);
+
+/*
+   Undoes RWLock_writeShare, waiting for the readers let in meanwhile
+   to finish.
+
+   Precondition:
+   * oLock cannot be NULL
+   * oLock is locked for writing, and readers are let in
+*/
+void RWLock_writeExclude(RWLock_T oLock);
+
+/*
+   Unlocks oLock for writing, whether or not readers are let in.
+
+   Precondition:
+   * oLock cannot be NULL
+*/
+void RWLock_writeUnlock(RWLock_T oLock);
+
+#endif